@@ -38,6 +38,7 @@
 #include "task/task.h"
 #include "measurement/btc/btc_definition.h"
 #include "measurement/http/httpdownload_definition.h"
+#include "measurement/http/httpupload_definition.h"
 #include "measurement/dnslookup/dnslookup_definition.h"
 #include "measurement/reverse_dnslookup/reverseDnslookup_definition.h"
 #include "measurement/packettrains/packettrainsdefinition.h"
@@ -62,6 +63,7 @@ public:
         scheduler.setExecutor(&executor);
 
         connect(&executor, SIGNAL(finished(ScheduleDefinition, Result)), this, SLOT(taskFinished(ScheduleDefinition, Result)));
+        connect(&executor, SIGNAL(resultReady(ScheduleDefinition, Result)), this, SLOT(taskFinished(ScheduleDefinition, Result)));
         connect(&loginController, SIGNAL(finished()), this, SLOT(loginStatusChanged()));
     }
 
@@ -364,7 +366,7 @@ bool Client::init()
     tests.append(ScheduleDefinition(ScheduleId(2), TaskId(2), "btc_ma", timing, BulkTransportCapacityDefinition("141.82.57.241", 5106, 1048576,
                                                                                      10).toVariant(), precondition));
     tests.append(ScheduleDefinition(ScheduleId(3), TaskId(3), "btc_ma", timing, BulkTransportCapacityDefinition("141.82.57.241", 5106, 1048576,
-                                                                                     10).toVariant(), precondition)); // this is for btc upload which is not implemented yet
+                                                                                     10, 0, 1, btc::Up, btc::uploadProtocol).toVariant(), precondition));
     tests.append(ScheduleDefinition(ScheduleId(4), TaskId(4), "ping", timing, PingDefinition("measure-it.net", 4, 200, 1000, 64, 33434, 33434, 74,
                                                                   ping::Udp).toVariant(), precondition));
     tests.append(ScheduleDefinition(ScheduleId(5), TaskId(5), "ping", timing, PingDefinition("measure-it.net", 4, 200, 1000, 64, 33434, 33434, 74,
@@ -434,6 +436,15 @@ void Client::http(const QString &url, bool avoidCaches, int threads, int targetT
     d->scheduler.enqueue(testDefinition);
 }
 
+void Client::httpUpload(const QString &url, int threads, int targetTime, int rampUpTime, int slotLength)
+{
+    HTTPUploadDefinition httpDef(url, threads, targetTime, rampUpTime, slotLength);
+    TimingPtr timing(new ImmediateTiming());
+    ScheduleDefinition testDefinition(ScheduleId(14), TaskId(14), "httpupload", timing,
+                                  httpDef.toVariant(), Precondition());
+    d->scheduler.enqueue(testDefinition);
+}
+
 void Client::upnp()
 {
     d->scheduler.executeOnDemandTest(ScheduleId(11));
@@ -98,6 +98,7 @@ public slots:
     void http();
     void http(const QString &url, bool avoidCaches, int threads, int targetTime,
               int rampUpTime, int slotLength);
+    void httpUpload(const QString &url, int threads, int targetTime, int rampUpTime, int slotLength);
     void upnp();
     void packetTrains();
     void packetTrains(const QString host,
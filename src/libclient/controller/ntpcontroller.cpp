@@ -77,6 +77,9 @@ public:
 
 NtpController::NtpController(QObject *parent)
 : Controller(parent)
+, m_socket(NULL)
+, m_offsetMsecs(0)
+, m_synchronized(false)
 , d(new Private(this))
 {
 }
@@ -125,8 +128,8 @@ bool NtpController::sync(QHostAddress &host)
     memset(&packet, 0, sizeof(packet));
     packet.flags.mode = 3;
     packet.flags.versionNumber = 4;
-    packet.transmitTimestamp = NtpTimestamp::fromDateTime(
-                                   QDateTime::currentDateTimeUtc());
+    m_requestTime = QDateTime::currentDateTimeUtc();
+    packet.transmitTimestamp = NtpTimestamp::fromDateTime(m_requestTime);
 
     m_socket = new QUdpSocket(this);
     connect(m_socket, SIGNAL(readyRead()), this, SLOT(readResponse()));
@@ -159,6 +162,14 @@ void NtpController::readResponse()
         if (bytes == 48 && packet.receiveTimestamp.seconds > 0)
         {
             m_networkTime = NtpTimestamp::toDateTime(packet.receiveTimestamp);
+
+            // ((T2 - T1) + (T3 - T4)) / 2, the path delay cancels out
+            if (packet.transmitTimestamp.seconds > 0)
+            {
+                QDateTime transmitTime = NtpTimestamp::toDateTime(packet.transmitTimestamp);
+                m_offsetMsecs = (m_requestTime.msecsTo(m_networkTime) + m_localTime.msecsTo(transmitTime)) / 2;
+                m_synchronized = true;
+            }
         }
     }
 
@@ -176,6 +187,16 @@ QDateTime NtpController::networkTime() const
     return m_networkTime;
 }
 
+qint64 NtpController::offsetMsecs() const
+{
+    return m_offsetMsecs;
+}
+
+bool NtpController::isSynchronized() const
+{
+    return m_synchronized;
+}
+
 QDateTime NtpController::currentDateTime() const
 {
     return QDateTime::currentDateTime().addSecs(this->offset());
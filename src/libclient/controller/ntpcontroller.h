@@ -26,6 +26,9 @@ public:
     QDateTime networkTime() const;
     QDateTime currentDateTime() const;
     quint64 offset() const;
+    // local clock + offsetMsecs() = network time, 0 until synchronized
+    qint64 offsetMsecs() const;
+    bool isSynchronized() const;
 
 signals:
     void error(QString message);
@@ -34,6 +37,9 @@ private:
     QUdpSocket *m_socket;
     QDateTime m_localTime;
     QDateTime m_networkTime;
+    QDateTime m_requestTime;
+    qint64 m_offsetMsecs;
+    bool m_synchronized;
 
 private slots:
     void readResponse();
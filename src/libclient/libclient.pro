@@ -120,8 +120,12 @@ SOURCES +=  \
     measurement/btc/btc_mp.cpp \
     measurement/btc/btc_ma.cpp \
     measurement/btc/btc_definition.cpp \
+    measurement/btc/btc_stream.cpp \
     network/udpsocket.cpp \
     network/tcpsocket.cpp \
+    network/tcpinfo.cpp \
+    network/randomdata.cpp \
+    network/socketutil.cpp \
     controller/logincontroller.cpp \
     measurement/btc/btc_plugin.cpp \
     measurement/upnp/upnp.cpp \
@@ -139,10 +143,32 @@ SOURCES +=  \
     measurement/packettrains/packettrains_ma.cpp \
     measurement/packettrains/packettrains_mp.cpp \
     measurement/packettrains/packettrainsplugin.cpp \
+    measurement/packettrains/pacer.cpp \
+    measurement/packettrains/receiver.cpp \
+    measurement/abw/abw_definition.cpp \
+    measurement/abw/abw_ma.cpp \
+    measurement/abw/abw_mp.cpp \
+    measurement/abw/abw_plugin.cpp \
+    measurement/abw/abw_trend.cpp \
+    measurement/owd/owd_definition.cpp \
+    measurement/owd/owd_ma.cpp \
+    measurement/owd/owd_mp.cpp \
+    measurement/owd/owd_packet.cpp \
+    measurement/owd/owd_plugin.cpp \
+    measurement/cbr/cbr_definition.cpp \
+    measurement/cbr/cbr_ma.cpp \
+    measurement/cbr/cbr_mp.cpp \
+    measurement/cbr/cbr_plugin.cpp \
+    measurement/cbr/cbr_stats.cpp \
     controller/crashcontroller.cpp \
     measurement/http/httpdownload.cpp \
     measurement/http/httpdownload_definition.cpp \
     measurement/http/httpdownload_plugin.cpp \
+    measurement/http/samplering.cpp \
+    measurement/http/httpresponseparser.cpp \
+    measurement/http/httpupload.cpp \
+    measurement/http/httpupload_definition.cpp \
+    measurement/http/httpupload_plugin.cpp \
     timing/ondemandtiming.cpp \
     log/filelogger.cpp \
     measurement/ping/ping_definition.cpp \
@@ -150,6 +176,13 @@ SOURCES +=  \
     measurement/traceroute/traceroute.cpp \
     measurement/traceroute/traceroute_definition.cpp \
     measurement/traceroute/traceroute_plugin.cpp \
+    measurement/traceroute/topologycache.cpp \
+    measurement/ping_sweep/ping_sweep.cpp \
+    measurement/ping_sweep/ping_sweep_definition.cpp \
+    measurement/ping_sweep/ping_sweep_plugin.cpp \
+    measurement/multipath_traceroute/multipath_traceroute.cpp \
+    measurement/multipath_traceroute/multipath_traceroute_definition.cpp \
+    measurement/multipath_traceroute/multipath_traceroute_plugin.cpp \
     measurement/dnslookup/dnslookup_definition.cpp \
     measurement/dnslookup/dnslookup_plugin.cpp \
     measurement/dnslookup/dnslookup.cpp \
@@ -211,11 +244,16 @@ HEADERS += \
     measurement/measurementfactory.h \
     measurement/measurement.h \
     measurement/measurementdefinition.h \
+    measurement/statistics.h \
     measurement/btc/btc_mp.h \
     measurement/btc/btc_ma.h \
     measurement/btc/btc_definition.h \
+    measurement/btc/btc_stream.h \
     network/udpsocket.h \
     network/tcpsocket.h \
+    network/tcpinfo.h \
+    network/randomdata.h \
+    network/socketutil.h \
     controller/logincontroller.h \
     log/logger.h \
     measurement/measurementplugin.h \
@@ -234,10 +272,32 @@ HEADERS += \
     measurement/packettrains/packettrains_mp.h \
     measurement/packettrains/packettrains_ma.h \
     measurement/packettrains/packettrainsplugin.h \
+    measurement/packettrains/pacer.h \
+    measurement/packettrains/receiver.h \
+    measurement/abw/abw_definition.h \
+    measurement/abw/abw_ma.h \
+    measurement/abw/abw_mp.h \
+    measurement/abw/abw_plugin.h \
+    measurement/abw/abw_trend.h \
+    measurement/owd/owd_definition.h \
+    measurement/owd/owd_ma.h \
+    measurement/owd/owd_mp.h \
+    measurement/owd/owd_packet.h \
+    measurement/owd/owd_plugin.h \
+    measurement/cbr/cbr_definition.h \
+    measurement/cbr/cbr_ma.h \
+    measurement/cbr/cbr_mp.h \
+    measurement/cbr/cbr_plugin.h \
+    measurement/cbr/cbr_stats.h \
     controller/crashcontroller.h \
     measurement/http/httpdownload.h \
     measurement/http/httpdownload_definition.h \
     measurement/http/httpdownload_plugin.h \
+    measurement/http/samplering.h \
+    measurement/http/httpresponseparser.h \
+    measurement/http/httpupload.h \
+    measurement/http/httpupload_definition.h \
+    measurement/http/httpupload_plugin.h \
     timing/ondemandtiming.h \
     log/filelogger.h \
     measurement/ping/ping.h \
@@ -246,6 +306,13 @@ HEADERS += \
     measurement/traceroute/traceroute.h \
     measurement/traceroute/traceroute_definition.h \
     measurement/traceroute/traceroute_plugin.h \
+    measurement/traceroute/topologycache.h \
+    measurement/ping_sweep/ping_sweep.h \
+    measurement/ping_sweep/ping_sweep_definition.h \
+    measurement/ping_sweep/ping_sweep_plugin.h \
+    measurement/multipath_traceroute/multipath_traceroute.h \
+    measurement/multipath_traceroute/multipath_traceroute_definition.h \
+    measurement/multipath_traceroute/multipath_traceroute_plugin.h \
     measurement/dnslookup/dnslookup_definition.h \
     measurement/dnslookup/dnslookup_plugin.h \
     measurement/dnslookup/dnslookup.h \
@@ -0,0 +1,50 @@
+#include "abw_definition.h"
+
+AvailableBandwidthDefinition::AvailableBandwidthDefinition(const QString &host, quint16 port, quint16 packetSize,
+                                                           quint16 streamLength, quint8 fleetSize, quint64 rateMin,
+                                                           quint64 rateMax, quint64 resolution, quint8 maxFleets)
+: host(host)
+, port(port)
+, packetSize(packetSize)
+, streamLength(streamLength)
+, fleetSize(fleetSize)
+, rateMin(rateMin)
+, rateMax(rateMax)
+, resolution(resolution)
+, maxFleets(maxFleets)
+{
+}
+
+AvailableBandwidthDefinition::~AvailableBandwidthDefinition()
+{
+}
+
+QVariant AvailableBandwidthDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("host", host);
+    map.insert("port", port);
+    map.insert("packet_size", packetSize);
+    map.insert("stream_length", streamLength);
+    map.insert("fleet_size", fleetSize);
+    map.insert("rate_min", rateMin);
+    map.insert("rate_max", rateMax);
+    map.insert("resolution", resolution);
+    map.insert("max_fleets", maxFleets);
+    return map;
+}
+
+AvailableBandwidthDefinitionPtr AvailableBandwidthDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+
+    return AvailableBandwidthDefinitionPtr(new AvailableBandwidthDefinition(map.value("host", "").toString(),
+                                                                            map.value("port", 5106).toUInt(),
+                                                                            map.value("packet_size", 800).toUInt(),
+                                                                            map.value("stream_length", 100).toUInt(),
+                                                                            map.value("fleet_size", 6).toUInt(),
+                                                                            map.value("rate_min", 125000).toULongLong(),
+                                                                            map.value("rate_max", 125000000).toULongLong(),
+                                                                            map.value("resolution", 250000).toULongLong(),
+                                                                            map.value("max_fleets", 20).toUInt()));
+}
@@ -0,0 +1,77 @@
+#ifndef ABW_DEFINITION_H
+#define ABW_DEFINITION_H
+
+#include "../measurementdefinition.h"
+
+namespace abw
+{
+    enum MessageType
+    {
+        ProbeMessage = 1,
+        ReportMessage,
+        DoneMessage
+    };
+
+    // start of every probe packet, the rest is padding; big endian
+    struct Probe
+    {
+        quint8 type;
+        quint8 reserved;
+        quint16 seq;
+        quint32 stream;
+        qint64 sendTime;
+    };
+
+    // trend of a stream as seen by the MP; big endian
+    struct Report
+    {
+        quint8 type;
+        quint8 trend;
+        quint16 received;
+        quint32 stream;
+        // permille
+        qint16 pct;
+        qint16 pdt;
+    };
+
+    // the MP keeps a delay per packet of a stream
+    const quint16 maxStreamLength = 1000;
+}
+
+class AvailableBandwidthDefinition;
+
+typedef QSharedPointer<AvailableBandwidthDefinition> AvailableBandwidthDefinitionPtr;
+typedef QList<AvailableBandwidthDefinitionPtr> AvailableBandwidthDefinitionList;
+
+class AvailableBandwidthDefinition : public MeasurementDefinition
+{
+public:
+    AvailableBandwidthDefinition(const QString &host, quint16 port, quint16 packetSize, quint16 streamLength,
+                                 quint8 fleetSize, quint64 rateMin, quint64 rateMax, quint64 resolution,
+                                 quint8 maxFleets);
+    ~AvailableBandwidthDefinition();
+
+    // Storage
+    static AvailableBandwidthDefinitionPtr fromVariant(const QVariant &variant);
+
+    // Getters
+    QString host;
+    quint16 port;
+    quint16 packetSize;
+    // packets per stream
+    quint16 streamLength;
+    // streams sent at the same rate before deciding about it
+    quint8 fleetSize;
+    // range searched in bytes/s
+    quint64 rateMin;
+    quint64 rateMax;
+    // bytes/s, the search stops once the range is narrower
+    quint64 resolution;
+    // the search stops after this many fleets in any case
+    quint8 maxFleets;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // ABW_DEFINITION_H
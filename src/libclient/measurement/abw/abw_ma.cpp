@@ -0,0 +1,272 @@
+#include "abw_ma.h"
+#include "../../log/logger.h"
+#include "../../network/networkmanager.h"
+#include "../../client.h"
+#include "../../trafficbudgetmanager.h"
+#include "../packettrains/receiver.h"
+
+#include <QtEndian>
+
+#include <string.h>
+
+LOGGER(AvailableBandwidthMA);
+
+namespace
+{
+    // ms to wait for the MP to report on a stream
+    const int reportTimeout = 1000;
+
+    // the trend test needs at least four groups of four packets
+    const int minStreamLength = 16;
+}
+
+AvailableBandwidthMA::AvailableBandwidthMA()
+: m_udpSocket(NULL)
+, m_bytesSent(0)
+, m_streams(0)
+, m_lostReports(0)
+, m_converged(false)
+, m_low(0)
+, m_high(0)
+, m_greyLow(0)
+, m_greyHigh(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status AvailableBandwidthMA::status() const
+{
+    return Unknown;
+}
+
+bool AvailableBandwidthMA::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    definition = measurementDefinition.dynamicCast<AvailableBandwidthDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    if (definition->packetSize < sizeof(abw::Probe) || definition->streamLength < minStreamLength ||
+        definition->streamLength > abw::maxStreamLength ||
+        definition->fleetSize == 0 || definition->rateMin == 0 || definition->rateMin >= definition->rateMax)
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
+    QString hostname = QString("%1:%2").arg(definition->host).arg(definition->port);
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(networkManager->establishConnection(hostname, taskId(), "abw_mp",
+                                                                                 definition, NetworkManager::UdpSocket));
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+
+    if (!m_pacer.setDestination(m_udpSocket->socketDescriptor(), definition->host, definition->port))
+    {
+        setErrorString(QString("Unable to resolve %1").arg(definition->host));
+        return false;
+    }
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    // the search usually stops long before maxFleets
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(definition->maxFleets * definition->fleetSize *
+                                                                    definition->streamLength * definition->packetSize))
+    {
+        setErrorString("not enough traffic available");
+        return false;
+    }
+
+    return true;
+}
+
+bool AvailableBandwidthMA::start()
+{
+    abw::RateSearch search(definition->rateMin, definition->rateMax, definition->resolution);
+    QByteArray buffer(definition->packetSize, 0);
+    quint32 stream = 0;
+
+    m_fleets.clear();
+    m_bytesSent = 0;
+    m_lostReports = 0;
+
+    m_pacer.calibrate();
+
+    while (!search.isConverged() && m_fleets.size() < definition->maxFleets)
+    {
+        quint64 rate = search.rate();
+        qint64 gap = qMax((qint64)(definition->packetSize * 1000000000.0 / rate), (qint64)1);
+        int trends[abw::Lossy + 1] = {0};
+        int lost = 0;
+
+        for (int i = 0; i < definition->fleetSize; i++)
+        {
+            qint64 duration = sendStream(buffer, stream, gap);
+            abw::Trend trend;
+
+            if (waitForReport(stream, &trend))
+            {
+                trends[trend]++;
+            }
+            else
+            {
+                lost++;
+            }
+
+            stream++;
+
+            // idle as long as the stream lasted, the path is loaded only half
+            // of the time
+            m_pacer.waitUntil(Pacer::now() + duration);
+        }
+
+        m_lostReports += lost;
+
+        // an unreachable MP must not look like a congested path
+        if (lost * 2 > definition->fleetSize)
+        {
+            char done = abw::DoneMessage;
+            m_pacer.sendUnacknowledged(&done, sizeof(done));
+
+            setErrorString(QString("The MP did not report on %1 of %2 streams").arg(lost).arg(definition->fleetSize));
+            return false;
+        }
+
+        // lost reports count for neither side
+        abw::RateSearch::Verdict verdict = abw::RateSearch::verdict(trends[abw::Increasing] + trends[abw::Lossy],
+                                                                    trends[abw::NonIncreasing],
+                                                                    definition->fleetSize - lost);
+
+        QVariantMap fleet;
+        fleet.insert("rate", rate);
+        fleet.insert("increasing", trends[abw::Increasing]);
+        fleet.insert("non_increasing", trends[abw::NonIncreasing]);
+        fleet.insert("grey", trends[abw::Grey]);
+        fleet.insert("lossy", trends[abw::Lossy]);
+        fleet.insert("lost_reports", lost);
+        fleet.insert("verdict", abw::RateSearch::verdictToString(verdict));
+        m_fleets.append(fleet);
+
+        LOG_DEBUG(QString("Fleet at %1 bytes/s is %2").arg(rate).arg(abw::RateSearch::verdictToString(verdict)));
+
+        search.update(verdict);
+    }
+
+    char done = abw::DoneMessage;
+    m_pacer.sendUnacknowledged(&done, sizeof(done));
+
+    m_streams = stream;
+    m_converged = search.isConverged();
+    m_low = search.low();
+    m_high = search.high();
+    m_greyLow = search.greyLow();
+    m_greyHigh = search.greyHigh();
+
+    emit finished();
+    return true;
+}
+
+qint64 AvailableBandwidthMA::sendStream(QByteArray &buffer, quint32 stream, qint64 gap)
+{
+    abw::Probe probe;
+    probe.type = abw::ProbeMessage;
+    probe.reserved = 0;
+    probe.stream = qToBigEndian(stream);
+
+    qint64 start = Pacer::now() + m_pacer.spinThreshold();
+    qint64 deadline = start;
+
+    for (int i = 0; i < definition->streamLength; i++)
+    {
+        qint64 time = m_pacer.waitUntil(deadline);
+
+        probe.seq = qToBigEndian((quint16)i);
+        probe.sendTime = qToBigEndian(time);
+        memcpy(buffer.data(), &probe, sizeof(probe));
+
+        if (m_pacer.send(buffer.constData(), buffer.size()))
+        {
+            m_bytesSent += buffer.size();
+        }
+
+        deadline += gap;
+    }
+
+    return deadline - start;
+}
+
+bool AvailableBandwidthMA::waitForReport(quint32 stream, abw::Trend *trend)
+{
+    qint64 deadline = Pacer::now() + reportTimeout * 1000000LL;
+    QByteArray datagram;
+
+    while (Receiver::waitForDatagram(m_udpSocket, deadline, &datagram))
+    {
+        if (datagram.size() < (int)sizeof(abw::Report) || datagram.at(0) != abw::ReportMessage)
+        {
+            continue;
+        }
+
+        abw::Report report;
+        memcpy(&report, datagram.constData(), sizeof(report));
+
+        // reports on earlier streams came too late
+        if (qFromBigEndian(report.stream) == stream && report.trend <= abw::Lossy)
+        {
+            *trend = (abw::Trend)report.trend;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AvailableBandwidthMA::stop()
+{
+    return true;
+}
+
+void AvailableBandwidthMA::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+// rates are in bytes/s like in the definition
+Result AvailableBandwidthMA::result() const
+{
+    QVariantMap map;
+    map.insert("abw_min", m_low);
+    map.insert("abw_max", m_high);
+
+    if (m_greyHigh > 0)
+    {
+        map.insert("grey_min", m_greyLow);
+        map.insert("grey_max", m_greyHigh);
+    }
+
+    map.insert("converged", m_converged);
+    map.insert("iterations", m_fleets.size());
+    map.insert("streams", m_streams);
+    map.insert("bytes_sent", m_bytesSent);
+    map.insert("lost_reports", m_lostReports);
+    map.insert("fleets", m_fleets);
+
+    return Result(map, definition->measurementUuid);
+}
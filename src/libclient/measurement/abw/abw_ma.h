@@ -0,0 +1,56 @@
+#ifndef ABW_MA_H
+#define ABW_MA_H
+
+#include <QUdpSocket>
+
+#include "../measurement.h"
+#include "../packettrains/pacer.h"
+#include "abw_definition.h"
+#include "abw_trend.h"
+
+/*
+ * Estimates the available bandwidth to the MP with self-loading periodic
+ * streams (pathload). Each fleet of streams at one rate tells whether the
+ * one-way delays increased, i.e. whether the rate was above the available
+ * bandwidth, and the rate of the next fleet is chosen accordingly.
+ */
+class AvailableBandwidthMA : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit AvailableBandwidthMA();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    // returns how long sending took in ns
+    qint64 sendStream(QByteArray &buffer, quint32 stream, qint64 gap);
+    // false if the MP did not report on the stream in time
+    bool waitForReport(quint32 stream, abw::Trend *trend);
+
+    AvailableBandwidthDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Pacer m_pacer;
+
+    QVariantList m_fleets;
+    quint64 m_bytesSent;
+    int m_streams;
+    int m_lostReports;
+
+    bool m_converged;
+    quint64 m_low;
+    quint64 m_high;
+    quint64 m_greyLow;
+    quint64 m_greyHigh;
+};
+
+#endif // ABW_MA_H
@@ -0,0 +1,242 @@
+#include "abw_mp.h"
+#include "abw_trend.h"
+#include "../../log/logger.h"
+
+#include <QtEndian>
+
+#include <string.h>
+
+LOGGER(AvailableBandwidthMP);
+
+namespace
+{
+    // the MA waits for a report for a second only
+    const int minStreamTimeout = 200;
+
+    const int receiveBufferSize = 4 * 1024 * 1024;
+}
+
+AvailableBandwidthMP::AvailableBandwidthMP()
+: m_udpSocket(NULL)
+, m_stream(0)
+, m_streamActive(false)
+, m_lastReported(-1)
+, m_peerPort(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status AvailableBandwidthMP::status() const
+{
+    return Unknown;
+}
+
+bool AvailableBandwidthMP::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager);
+
+    definition = measurementDefinition.dynamicCast<AvailableBandwidthDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    // the definition comes from the peer, it sizes the buffers below
+    if (definition->streamLength == 0 || definition->streamLength > abw::maxStreamLength)
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(peerSocket());
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+    m_udpSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, receiveBufferSize);
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    m_receiver.setSocket(m_udpSocket);
+
+    m_delays.fill(0, definition->streamLength);
+    m_received.fill(false, definition->streamLength);
+    m_streams.clear();
+    m_lastReported = -1;
+
+    // ten gaps at the lowest rate
+    qint64 gap = definition->rateMin ? definition->packetSize * 1000 / definition->rateMin : 0;
+    m_streamTimer.setInterval(qMax((qint64)minStreamTimeout, 10 * gap));
+    m_streamTimer.setSingleShot(true);
+    connect(&m_streamTimer, SIGNAL(timeout()), this, SLOT(evaluateStream()));
+
+    return true;
+}
+
+bool AvailableBandwidthMP::start()
+{
+    // Timeout for "nothing happens"
+    connect(&m_timeout, SIGNAL(timeout()), this, SIGNAL(finished()));
+    m_timeout.setInterval(5000);
+    m_timeout.setSingleShot(true);
+    m_timeout.start();
+
+    m_receiver.notify(this, SLOT(readPendingDatagrams()));
+
+    return true;
+}
+
+bool AvailableBandwidthMP::stop()
+{
+    m_timeout.stop();
+    m_streamTimer.stop();
+
+    m_receiver.stopNotifying();
+
+    return true;
+}
+
+void AvailableBandwidthMP::readPendingDatagrams()
+{
+    m_timeout.start();
+
+    int count;
+
+    while ((count = m_receiver.receive()) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (m_receiver.size(i) < 1)
+            {
+                continue;
+            }
+
+            quint8 type = m_receiver.data(i)[0];
+
+            if (type == abw::DoneMessage)
+            {
+                evaluateStream();
+                stop();
+                emit finished();
+                return;
+            }
+
+            if (type != abw::ProbeMessage || m_receiver.size(i) < (int)sizeof(abw::Probe))
+            {
+                continue;
+            }
+
+            abw::Probe probe;
+            memcpy(&probe, m_receiver.data(i), sizeof(probe));
+
+            quint32 stream = qFromBigEndian(probe.stream);
+            quint16 seq = qFromBigEndian(probe.seq);
+
+            // late packets of a stream already reported
+            if ((qint64)stream <= m_lastReported || (m_streamActive && stream < m_stream) ||
+                seq >= definition->streamLength)
+            {
+                continue;
+            }
+
+            if (stream != m_stream || !m_streamActive)
+            {
+                evaluateStream();
+
+                m_stream = stream;
+                m_streamActive = true;
+                m_received.fill(false);
+            }
+
+            m_delays[seq] = m_receiver.timestamp(i) - qFromBigEndian(probe.sendTime);
+            m_received[seq] = true;
+            m_peer = m_receiver.sender(i);
+            m_peerPort = m_receiver.senderPort(i);
+
+            if (seq == definition->streamLength - 1)
+            {
+                evaluateStream();
+            }
+            else
+            {
+                m_streamTimer.start();
+            }
+        }
+    }
+}
+
+void AvailableBandwidthMP::evaluateStream()
+{
+    m_streamTimer.stop();
+
+    if (!m_streamActive)
+    {
+        return;
+    }
+
+    m_streamActive = false;
+    m_lastReported = m_stream;
+
+    // the clocks of MA and MP are not synchronized, their offset does not
+    // change the trend though
+    QVector<qint64> delays;
+
+    for (int i = 0; i < m_delays.size(); i++)
+    {
+        if (m_received.at(i))
+        {
+            delays.append(m_delays.at(i));
+        }
+    }
+
+    QVector<qreal> medians = abw::groupMedians(delays);
+    abw::Trend trend = abw::trend(delays, definition->streamLength);
+    qreal pct = abw::pct(medians);
+    qreal pdt = abw::pdt(medians);
+
+    abw::Report report;
+    report.type = abw::ReportMessage;
+    report.trend = trend;
+    report.received = qToBigEndian((quint16)delays.size());
+    report.stream = qToBigEndian(m_stream);
+    report.pct = qToBigEndian((qint16)qRound(pct * 1000));
+    report.pdt = qToBigEndian((qint16)qRound(pdt * 1000));
+
+    m_udpSocket->writeDatagram(reinterpret_cast<const char *>(&report), sizeof(report), m_peer, m_peerPort);
+
+    QVariantMap map;
+    map.insert("stream", m_stream);
+    map.insert("received", delays.size());
+    map.insert("pct", pct);
+    map.insert("pdt", pdt);
+    map.insert("trend", abw::trendToString(trend));
+    m_streams.append(map);
+}
+
+void AvailableBandwidthMP::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+Result AvailableBandwidthMP::result() const
+{
+    QVariantMap map;
+    map.insert("streams", m_streams);
+    map.insert("kernel_timestamps", m_receiver.kernelTimestamps());
+
+    return Result(map, getMeasurementUuid());
+}
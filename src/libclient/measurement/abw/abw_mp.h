@@ -0,0 +1,55 @@
+#ifndef ABW_MP_H
+#define ABW_MP_H
+
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "../measurement.h"
+#include "../packettrains/receiver.h"
+#include "abw_definition.h"
+
+class AvailableBandwidthMP : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit AvailableBandwidthMP();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void readPendingDatagrams();
+    void evaluateStream();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    AvailableBandwidthDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Receiver m_receiver;
+
+    // the stream being received
+    quint32 m_stream;
+    bool m_streamActive;
+    qint64 m_lastReported;
+    // one-way delays indexed by sequence number
+    QVector<qint64> m_delays;
+    QVector<bool> m_received;
+
+    // reports go back to where the probes came from
+    QHostAddress m_peer;
+    quint16 m_peerPort;
+
+    QVariantList m_streams;
+
+    // evaluates a stream whose last packets got lost
+    QTimer m_streamTimer;
+    QTimer m_timeout;
+};
+
+#endif // ABW_MP_H
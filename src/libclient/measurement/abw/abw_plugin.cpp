@@ -0,0 +1,33 @@
+#include "abw_plugin.h"
+#include "abw_ma.h"
+#include "abw_mp.h"
+#include "abw_definition.h"
+
+QStringList AvailableBandwidthPlugin::measurements() const
+{
+    return QStringList()
+           << "abw_ma"
+           << "abw_mp";
+}
+
+MeasurementPtr AvailableBandwidthPlugin::createMeasurement(const QString &name)
+{
+    if (name == "abw_ma")
+    {
+        return MeasurementPtr(new AvailableBandwidthMA);
+    }
+
+    if (name == "abw_mp")
+    {
+        return MeasurementPtr(new AvailableBandwidthMP);
+    }
+
+    return MeasurementPtr();
+}
+
+MeasurementDefinitionPtr AvailableBandwidthPlugin::createMeasurementDefinition(const QString &name,
+                                                                               const QVariant &data)
+{
+    Q_UNUSED(name);
+    return AvailableBandwidthDefinition::fromVariant(data);
+}
@@ -0,0 +1,16 @@
+#ifndef ABW_PLUGIN_H
+#define ABW_PLUGIN_H
+
+#include "../measurementplugin.h"
+
+class AvailableBandwidthPlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // ABW_PLUGIN_H
@@ -0,0 +1,270 @@
+#include "abw_trend.h"
+
+#include <QtMath>
+
+namespace
+{
+    // thresholds from the pathload paper
+    const qreal pctIncreasing = 0.66;
+    const qreal pctNonIncreasing = 0.54;
+    const qreal pdtIncreasing = 0.55;
+    const qreal pdtNonIncreasing = 0.45;
+
+    // share of the streams of a fleet which have to agree (percent)
+    const int fleetAgreement = 70;
+
+    // streams missing more packets are lossy (percent)
+    const int maxLoss = 10;
+
+    // fewer medians do not tell a trend
+    const int minGroups = 4;
+
+    abw::Trend classify(qreal value, qreal increasing, qreal nonIncreasing)
+    {
+        if (value > increasing)
+        {
+            return abw::Increasing;
+        }
+        else if (value < nonIncreasing)
+        {
+            return abw::NonIncreasing;
+        }
+
+        return abw::Grey;
+    }
+}
+
+QString abw::trendToString(abw::Trend trend)
+{
+    switch (trend)
+    {
+    case NonIncreasing:
+        return "non_increasing";
+    case Increasing:
+        return "increasing";
+    case Lossy:
+        return "lossy";
+    default:
+        return "grey";
+    }
+}
+
+QVector<qreal> abw::groupMedians(const QVector<qint64> &delays)
+{
+    QVector<qreal> medians;
+    int groups = qFloor(qSqrt(delays.size()));
+
+    if (groups == 0)
+    {
+        return medians;
+    }
+
+    int groupSize = delays.size() / groups;
+
+    for (int i = 0; i < groups; i++)
+    {
+        QVector<qint64> group = delays.mid(i * groupSize, groupSize);
+        qSort(group);
+
+        if (group.size() % 2)
+        {
+            medians.append(group.at(group.size() / 2));
+        }
+        else
+        {
+            medians.append((group.at(group.size() / 2 - 1) + group.at(group.size() / 2)) / 2.0);
+        }
+    }
+
+    return medians;
+}
+
+qreal abw::pct(const QVector<qreal> &medians)
+{
+    if (medians.size() < 2)
+    {
+        return 0;
+    }
+
+    int increases = 0;
+
+    for (int i = 1; i < medians.size(); i++)
+    {
+        if (medians.at(i) > medians.at(i - 1))
+        {
+            increases++;
+        }
+    }
+
+    return (qreal)increases / (medians.size() - 1);
+}
+
+qreal abw::pdt(const QVector<qreal> &medians)
+{
+    qreal changes = 0;
+
+    for (int i = 1; i < medians.size(); i++)
+    {
+        changes += qAbs(medians.at(i) - medians.at(i - 1));
+    }
+
+    if (changes == 0)
+    {
+        return 0;
+    }
+
+    return (medians.last() - medians.first()) / changes;
+}
+
+abw::Trend abw::trend(const QVector<qint64> &delays, int expected)
+{
+    if ((expected - delays.size()) * 100 > expected * maxLoss)
+    {
+        return Lossy;
+    }
+
+    QVector<qreal> medians = groupMedians(delays);
+
+    if (medians.size() < minGroups)
+    {
+        return Grey;
+    }
+
+    Trend byPct = classify(pct(medians), pctIncreasing, pctNonIncreasing);
+    Trend byPdt = classify(pdt(medians), pdtIncreasing, pdtNonIncreasing);
+
+    // one test being undecided leaves it to the other one, contradicting
+    // tests make the stream grey
+    if (byPct == byPdt || byPdt == Grey)
+    {
+        return byPct;
+    }
+    else if (byPct == Grey)
+    {
+        return byPdt;
+    }
+
+    return Grey;
+}
+
+abw::RateSearch::RateSearch(quint64 rateMin, quint64 rateMax, quint64 resolution)
+: m_resolution(qMax(resolution, (quint64)1))
+, m_rate((rateMin + rateMax) / 2)
+, m_low(rateMin)
+, m_high(rateMax)
+, m_greyLow(0)
+, m_greyHigh(0)
+{
+}
+
+abw::RateSearch::Verdict abw::RateSearch::verdict(int increasing, int nonIncreasing, int streams)
+{
+    if (increasing * 100 > streams * fleetAgreement)
+    {
+        return Above;
+    }
+    else if (nonIncreasing * 100 > streams * fleetAgreement)
+    {
+        return Below;
+    }
+
+    return Ambiguous;
+}
+
+QString abw::RateSearch::verdictToString(abw::RateSearch::Verdict verdict)
+{
+    switch (verdict)
+    {
+    case Below:
+        return "below";
+    case Above:
+        return "above";
+    default:
+        return "ambiguous";
+    }
+}
+
+quint64 abw::RateSearch::rate() const
+{
+    return m_rate;
+}
+
+void abw::RateSearch::update(abw::RateSearch::Verdict verdict)
+{
+    switch (verdict)
+    {
+    case Above:
+        m_high = m_rate;
+        break;
+
+    case Below:
+        m_low = m_rate;
+        break;
+
+    case Ambiguous:
+        if (!hasGrey())
+        {
+            m_greyLow = m_greyHigh = m_rate;
+        }
+        else
+        {
+            m_greyLow = qMin(m_greyLow, m_rate);
+            m_greyHigh = qMax(m_greyHigh, m_rate);
+        }
+        break;
+    }
+
+    // the available bandwidth moved away from the grey region found before
+    if (hasGrey() && (m_greyLow >= m_high || m_greyHigh <= m_low))
+    {
+        m_greyLow = m_greyHigh = 0;
+    }
+
+    if (!hasGrey())
+    {
+        m_rate = (m_low + m_high) / 2;
+    }
+    else if (m_greyLow - m_low > m_resolution)
+    {
+        m_rate = (m_low + m_greyLow) / 2;
+    }
+    else if (m_high - m_greyHigh > m_resolution)
+    {
+        m_rate = (m_greyHigh + m_high) / 2;
+    }
+}
+
+bool abw::RateSearch::isConverged() const
+{
+    if (!hasGrey())
+    {
+        return m_high - m_low <= m_resolution;
+    }
+
+    return m_greyLow - m_low <= m_resolution && m_high - m_greyHigh <= m_resolution;
+}
+
+quint64 abw::RateSearch::low() const
+{
+    return m_low;
+}
+
+quint64 abw::RateSearch::high() const
+{
+    return m_high;
+}
+
+bool abw::RateSearch::hasGrey() const
+{
+    return m_greyHigh > 0;
+}
+
+quint64 abw::RateSearch::greyLow() const
+{
+    return m_greyLow;
+}
+
+quint64 abw::RateSearch::greyHigh() const
+{
+    return m_greyHigh;
+}
@@ -0,0 +1,81 @@
+#ifndef ABW_TREND_H
+#define ABW_TREND_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+
+namespace abw
+{
+    // one-way delay trend of a stream
+    enum Trend
+    {
+        NonIncreasing,
+        Increasing,
+        Grey,
+        // too many packets were lost to tell, counts as increasing
+        Lossy
+    };
+
+    QString trendToString(Trend trend);
+
+    // medians of the sqrt(n) groups the delays are split into
+    QVector<qreal> groupMedians(const QVector<qint64> &delays);
+
+    // pairwise comparison test: share of the medians larger than the one
+    // before, 1 for a strictly increasing sequence
+    qreal pct(const QVector<qreal> &medians);
+
+    // pairwise difference test: overall increase relative to the sum of all
+    // changes, between -1 and 1
+    qreal pdt(const QVector<qreal> &medians);
+
+    // delays of the received packets in the order they were sent
+    Trend trend(const QVector<qint64> &delays, int expected);
+
+    /*
+     * Binary search for the available bandwidth as in pathload: every
+     * fleet of streams either shows that the rate was above or below it,
+     * or that the rate lies in the grey region where the available
+     * bandwidth varied during the fleet. The search narrows [low, high]
+     * and the grey region until both are within the resolution.
+     */
+    class RateSearch
+    {
+    public:
+        enum Verdict
+        {
+            Below,
+            Above,
+            Ambiguous
+        };
+
+        RateSearch(quint64 rateMin, quint64 rateMax, quint64 resolution);
+
+        static Verdict verdict(int increasing, int nonIncreasing, int streams);
+        static QString verdictToString(Verdict verdict);
+
+        // the rate to probe next
+        quint64 rate() const;
+        // the result of probing rate()
+        void update(Verdict verdict);
+        bool isConverged() const;
+
+        quint64 low() const;
+        quint64 high() const;
+
+        bool hasGrey() const;
+        quint64 greyLow() const;
+        quint64 greyHigh() const;
+
+    private:
+        quint64 m_resolution;
+        quint64 m_rate;
+        quint64 m_low;
+        quint64 m_high;
+        quint64 m_greyLow;
+        quint64 m_greyHigh;
+    };
+}
+
+#endif // ABW_TREND_H
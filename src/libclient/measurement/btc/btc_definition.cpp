@@ -1,11 +1,17 @@
 #include "btc_definition.h"
 
 BulkTransportCapacityDefinition::BulkTransportCapacityDefinition(const QString &host, quint16 port,
-                                                                 quint64 initialDataSize, quint16 slices)
+                                                                 quint64 initialDataSize, quint16 slices,
+                                                                 quint32 tcpInfoInterval, quint16 streams,
+                                                                 btc::Direction direction, quint16 protocol)
 : host(host)
 , port(port)
 , initialDataSize(initialDataSize)
 , slices(slices)
+, tcpInfoInterval(tcpInfoInterval)
+, streams(streams)
+, direction(direction)
+, protocol(protocol)
 {
 }
 
@@ -13,6 +19,33 @@ BulkTransportCapacityDefinition::~BulkTransportCapacityDefinition()
 {
 }
 
+QString BulkTransportCapacityDefinition::directionToString(btc::Direction direction)
+{
+    switch (direction)
+    {
+    case btc::Up:
+        return "up";
+    case btc::Both:
+        return "both";
+    default:
+        return "down";
+    }
+}
+
+btc::Direction BulkTransportCapacityDefinition::directionFromString(const QString &direction)
+{
+    if (direction == "up")
+    {
+        return btc::Up;
+    }
+    else if (direction == "both")
+    {
+        return btc::Both;
+    }
+
+    return btc::Down;
+}
+
 QVariant BulkTransportCapacityDefinition::toVariant() const
 {
     QVariantMap map;
@@ -20,6 +53,10 @@ QVariant BulkTransportCapacityDefinition::toVariant() const
     map.insert("port", port);
     map.insert("initial_data_size", initialDataSize);
     map.insert("slices", slices);
+    map.insert("tcp_info_interval", tcpInfoInterval);
+    map.insert("streams", streams);
+    map.insert("direction", directionToString(direction));
+    map.insert("protocol", protocol);
     return map;
 }
 
@@ -30,5 +67,9 @@ BulkTransportCapacityDefinitionPtr BulkTransportCapacityDefinition::fromVariant(
     return BulkTransportCapacityDefinitionPtr(new BulkTransportCapacityDefinition(map.value("host", "").toString(),
                                                                                   map.value("port", 0).toUInt(),
                                                                                   map.value("initial_data_size", 1024 * 1024).toUInt(),
-                                                                                  map.value("slices", 10).toUInt()));
+                                                                                  map.value("slices", 10).toUInt(),
+                                                                                  map.value("tcp_info_interval", 0).toUInt(),
+                                                                                  map.value("streams", 1).toUInt(),
+                                                                                  directionFromString(map.value("direction", "down").toString()),
+                                                                                  map.value("protocol", btc::downloadProtocol).toUInt()));
 }
@@ -3,6 +3,21 @@
 
 #include "../measurementdefinition.h"
 
+namespace btc
+{
+    enum Direction
+    {
+        Down,
+        Up,
+        Both
+    };
+
+    // an MP that does not know the protocol of the definition only answers
+    // downloads, it would take the data of an upload for requests
+    const quint16 downloadProtocol = 1;
+    const quint16 uploadProtocol = 2;
+}
+
 class BulkTransportCapacityDefinition;
 
 typedef QSharedPointer<BulkTransportCapacityDefinition> BulkTransportCapacityDefinitionPtr;
@@ -11,17 +26,32 @@ typedef QList<BulkTransportCapacityDefinitionPtr> BulkTransportCapacityDefinitio
 class BulkTransportCapacityDefinition : public MeasurementDefinition
 {
 public:
-    BulkTransportCapacityDefinition(const QString &host, quint16 port, quint64 initialDataSize, quint16 slices);
+    BulkTransportCapacityDefinition(const QString &host, quint16 port, quint64 initialDataSize, quint16 slices,
+                                    quint32 tcpInfoInterval = 0, quint16 streams = 1,
+                                    btc::Direction direction = btc::Down,
+                                    quint16 protocol = btc::downloadProtocol);
     ~BulkTransportCapacityDefinition();
 
     // Storage
     static BulkTransportCapacityDefinitionPtr fromVariant(const QVariant &variant);
 
+    static QString directionToString(btc::Direction direction);
+    static btc::Direction directionFromString(const QString &direction);
+
     // Getters
     QString host;
     quint16 port;
     quint64 initialDataSize;
+    // slices each stream's throughput is reported in
     quint16 slices;
+    // ms between two TCP_INFO samples, 0 to not sample
+    quint32 tcpInfoInterval;
+    // parallel TCP connections to the MP
+    quint16 streams;
+    // Both measures the download first, then the upload
+    btc::Direction direction;
+    // the MP has to speak it, uploads need btc::uploadProtocol
+    quint16 protocol;
 
     // Serializable interface
     QVariant toVariant() const;
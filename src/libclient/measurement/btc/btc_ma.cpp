@@ -3,182 +3,204 @@
 #include "../../network/networkmanager.h"
 #include "../../client.h"
 #include "../../trafficbudgetmanager.h"
-
-#include <QDataStream>
-#include <numeric>
-#include <QtCore/QtMath>
+#include "../../types.h"
+#include "../statistics.h"
 
 LOGGER(BulkTransportCapacityMA);
 
 BulkTransportCapacityMA::BulkTransportCapacityMA(QObject *parent)
 : Measurement(parent)
+, m_direction(btc::Down)
 , m_preTest(true)
-, m_tcpSocket(NULL)
-, m_lasttime(-1)
+, m_runningStreams(0)
 , m_status(Unknown)
 {
     connect(this, SIGNAL(error(const QString &)), this,
             SLOT(setErrorString(const QString &)));
+    connect(&m_tcpInfoTimer, SIGNAL(timeout()), this, SLOT(sampleTcpInfo()));
 }
 
 bool BulkTransportCapacityMA::start()
 {
     m_status = BulkTransportCapacityMA::Running;
 
-    LOG_INFO("Sending initial data size to server");
-    sendRequest(definition->initialDataSize);
+    m_directions.clear();
+
+    if (definition->direction != btc::Up)
+    {
+        m_directions << btc::Down;
+    }
+
+    if (definition->direction != btc::Down)
+    {
+        m_directions << btc::Up;
+    }
+
+    nextDirection();
 
     return true;
 }
 
-void BulkTransportCapacityMA::sendRequest(quint64 bytes)
+void BulkTransportCapacityMA::nextDirection()
 {
-    // invalidate timer
-    m_time.invalidate();
+    if (m_directions.isEmpty())
+    {
+        m_status = BulkTransportCapacityMA::Finished;
+        emit finished();
+        return;
+    }
+
+    m_direction = m_directions.takeFirst();
+    m_preTest = true;
+    m_runningStreams = 1;
+
+    // the pretest only needs one stream
+    LOG_INFO("Sending initial data size to server");
+    transfer(m_streams.first(), definition->initialDataSize);
+}
 
-    m_bytesExpected = bytes;
-    QDataStream out(m_tcpSocket);
-    out << bytes;
+void BulkTransportCapacityMA::transfer(BulkTransportCapacityStream *stream, quint64 bytes)
+{
+    if (m_direction == btc::Down)
+    {
+        stream->download(bytes, definition->slices);
+    }
+    else
+    {
+        stream->upload(bytes, definition->slices);
+    }
 }
 
-void BulkTransportCapacityMA::calculateResult()
+void BulkTransportCapacityMA::streamFinished()
 {
+    if (--m_runningStreams > 0)
+    {
+        return;
+    }
+
     // if we are in pretest-phase we need to calculate the bytes for the big test
     if (m_preTest)
     {
-        // get the download speed in kbyte
-        qreal downloadSpeed = (m_bytesReceived / 1024.0) / (((m_lasttime / 1000.0) / 1000) / 1000);
+        qreal speed = m_streams.first()->speed();
 
-        LOG_INFO(QString("Speed (pretest): %1 KByte/s").arg(downloadSpeed, 0, 'f', 0));
+        LOG_INFO(QString("Speed (pretest): %1 KByte/s").arg(speed, 0, 'f', 0));
 
-        // Calculate new test size
-        m_bytesExpected = downloadSpeed * 1024 * 3; // should be <3 seconds if the calculated speed was correct
-
-        // Request high amount of data
-        LOG_INFO("Sending test data size to server");
-        m_preTest = false;
+        // should be <3 seconds if the calculated speed was correct, a
+        // stream of several only if they do not share a bottleneck
+        quint64 bytes = speed * 1024 * 3;
 
-        if (Client::instance()->trafficBudgetManager()->addUsedTraffic(m_bytesExpected))
+        if (bytes == 0)
         {
-            sendRequest(m_bytesExpected);
+            emit error("pretest did not measure anything");
+            return;
         }
-        else
+
+        if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(bytes * m_streams.size()))
         {
             LOG_ERROR("not enough traffic available");
             emit error("not enough traffic available");
             return;
         }
-    }
-    else
-    {
-        // calculate download speed for n slices
-        int slices = 10; // TODO 10 slices, as parameter?
-        int slice_size = ceil((double)m_times.size() / slices); // round up to get the correct number of slices
 
-        // counters
-        qint64 bytes = 0;
-        qint64 time = 0;
+        // Request high amount of data
+        LOG_INFO(QString("Sending test data size to server on %1 streams").arg(m_streams.size()));
+        m_preTest = false;
+        m_runningStreams = m_streams.size();
 
-        // calculate slices
-        for (int i = 0; i < m_times.size(); i++)
+        foreach (BulkTransportCapacityStream *stream, m_streams)
         {
-            bytes += m_bytesReceivedList.at(i);
-            time += m_times.at(i);
-
-            // calculate a slice if enough samples are added up or if this is the last iteration
-            if (((i + 1) % slice_size) == 0 || i == m_times.size() - 1) // calculate a slice
-            {
-                qreal speed = (bytes / 1024.0) / (((time / 1000.0) / 1000) / 1000);
-                m_downloadSpeeds << speed;
-
-                // reset counters
-                bytes = 0;
-                time = 0;
-            }
+            transfer(stream, bytes);
         }
 
-        // calculate mean speed
-        qreal sum = std::accumulate(m_downloadSpeeds.begin(), m_downloadSpeeds.end(), 0.0);
-        qreal mean = sum / m_downloadSpeeds.size();
-        LOG_INFO(QString("Speed (mean): %1 KByte/s").arg(mean, 0, 'f', 0));
-
-        /* At the moment deactivated
-        // calculate standard deviation
-        qreal sq_sum = std::inner_product(speeds.begin(), speeds.end(), speeds.begin(), 0.0);
-        qreal stdev = qSqrt(sq_sum / speeds.size() - mean * mean);
-        LOG_INFO(QString("Standard deviation: %1").arg(stdev, 0, 'f', 0));
-        */
-
-        /* At the moment deactivated to get all results
-        // get ride of the lower and upper 20%
-        qSort(speeds);
-        int percentil = slices * 0.2;
-        sum = std::accumulate(speeds.begin()+percentil, speeds.end()-percentil, 0.0);
-        mean = sum / (speeds.size() - 2 * percentil);
-        LOG_INFO(QString("Speed (60 percentil mean): %1 KByte/s").arg(mean, 0, 'f', 0));
-        */
-
-        m_status = BulkTransportCapacityMA::Finished;
+        if (definition->tcpInfoInterval > 0 && TcpInfoSeries::isSupported())
+        {
+            m_tcpInfoTimer.start(definition->tcpInfoInterval);
+        }
 
-        emit finished();
+        return;
     }
+
+    m_tcpInfoTimer.stop();
+
+    QVariantMap result = directionResult();
+    LOG_INFO(QString("Speed (aggregate): %1 KByte/s").arg(result.value("kBs_avg").toDouble(), 0, 'f', 0));
+
+    m_results.insert(m_direction == btc::Down ? "download" : "upload", result);
+    nextDirection();
 }
 
-void BulkTransportCapacityMA::receiveResponse()
+// the slices of a stream are cut by its sample count, so slice i of
+// different streams covers different times; the streams are only added up
+// by their means, the slices are reported for a single stream
+QVariantMap BulkTransportCapacityMA::directionResult() const
 {
-    qint64 time = m_time.nsecsElapsed();
+    QVariantList streams;
+    qreal total = 0;
+    Statistics statistics;
+    QList<qreal> speeds;
 
-    // if the timer is not valid this is the first response packet
-    if (!m_time.isValid())
+    foreach (BulkTransportCapacityStream *stream, m_streams)
     {
-        // reset variables
-        m_bytesReceived = 0;
-        m_lasttime = 0;
+        speeds = stream->sliceSpeeds();
+        statistics.clear();
+
+        foreach (qreal speed, speeds)
+        {
+            statistics.add(speed);
+        }
 
-        // this packet counts to the total bytes, but not to the measurement bytes in m_bytesReceived
-        m_totalBytesReceived = m_tcpSocket->bytesAvailable();
+        total += statistics.mean();
 
-        // ignor the first data received
-        m_tcpSocket->readAll();
+        QVariantMap map;
+        map.insert("kBs_avg", statistics.mean());
+        map.insert("kBs_min", statistics.min());
+        map.insert("kBs_max", statistics.max());
+        map.insert("kBs_stddev", statistics.stdev());
+        map.insert("kBs", listToVariant(speeds));
 
-        m_time.restart();
-    }
-    else // this is a response within an active measurement
-    {
-        qint64 bytes = m_tcpSocket->bytesAvailable();
-        m_bytesReceivedList << bytes;
-        m_times << time - m_lasttime;
-        m_bytesReceived += bytes;
-        m_totalBytesReceived += bytes;
-        m_tcpSocket->readAll(); // we don't care for the data-content
-        m_lasttime = time;
+        if (!stream->tcpInfo().isEmpty())
+        {
+            map.insert("tcp_info", stream->tcpInfo().toVariant());
+        }
+
+        streams.append(map);
     }
 
-    // check if all measurement data was received
-    if (m_totalBytesReceived >= m_bytesExpected)
+    QVariantMap result;
+    result.insert("kBs_avg", total);
+
+    if (m_streams.size() == 1)
     {
-        calculateResult();
+        result.insert("kBs_min", statistics.min());
+        result.insert("kBs_max", statistics.max());
+        result.insert("kBs_stddev", statistics.stdev());
+        result.insert("kBs_p50", statistics.quantile(0.5));
+        result.insert("kBs_p90", statistics.quantile(0.9));
+        result.insert("kBs_p99", statistics.quantile(0.99));
+        result.insert("kBs", listToVariant(speeds));
     }
+
+    result.insert("streams", streams);
+    return result;
 }
 
-void BulkTransportCapacityMA::serverDisconnected()
+void BulkTransportCapacityMA::sampleTcpInfo()
 {
-    if (m_status != BulkTransportCapacityMA::Finished)
+    foreach (BulkTransportCapacityStream *stream, m_streams)
     {
-        LOG_WARNING("Server closed connection, this should not happen");
+        stream->sampleTcpInfo();
     }
 }
 
-void BulkTransportCapacityMA::handleError(QAbstractSocket::SocketError socketError)
+void BulkTransportCapacityMA::handleError(const QString &message)
 {
-    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    if (m_status == BulkTransportCapacityMA::Finished)
     {
         return;
     }
 
-    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
-    LOG_ERROR(QString("Socket Error: %1").arg(socket->errorString()));
-    emit error(socket->errorString());
+    m_tcpInfoTimer.stop();
+    emit error(message);
 }
 
 Measurement::Status BulkTransportCapacityMA::status() const
@@ -197,48 +219,98 @@ bool BulkTransportCapacityMA::prepare(NetworkManager *networkManager,
         return false;
     }
 
+    if (definition->tcpInfoInterval > 0 && definition->tcpInfoInterval < TcpInfoSeries::minInterval)
+    {
+        setErrorString("TCP_INFO interval too short");
+        return false;
+    }
+
+    if (definition->streams < 1 || definition->streams > maxStreams)
+    {
+        setErrorString("requested number of streams wrong");
+        return false;
+    }
+
+    if (definition->slices < 1)
+    {
+        setErrorString("requested number of slices wrong");
+        return false;
+    }
+
+    if (definition->protocol < btc::downloadProtocol || definition->protocol > btc::uploadProtocol)
+    {
+        setErrorString("Unknown protocol");
+        return false;
+    }
+
+    if (definition->direction != btc::Down && definition->protocol < btc::uploadProtocol)
+    {
+        setErrorString("The MP does not support uploads");
+        return false;
+    }
+
     QString hostname = QString("%1:%2").arg(definition->host).arg(definition->port);
 
-    m_tcpSocket = qobject_cast<QTcpSocket *>(networkManager->establishConnection(hostname, taskId(), "btc_mp", definition,
-                                                                                 NetworkManager::TcpSocket));
+    // the test offer goes with the first connection only, the MP accepts
+    // the others as further sessions
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(networkManager->establishConnection(hostname, taskId(), "btc_mp",
+                                                                                        definition,
+                                                                                        NetworkManager::TcpSocket));
 
-    if (!m_tcpSocket)
+    if (!socket)
     {
         setErrorString("Preparation failed");
         return false;
     }
 
-    m_tcpSocket->setParent(this);
-    m_bytesExpected = 0;
-    m_preTest = true;
+    m_streams.append(new BulkTransportCapacityStream(socket, this));
 
-    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(definition->initialDataSize))
+    while (m_streams.size() < definition->streams)
     {
-        setErrorString("not enough traffic available");
-        return false;
+        socket = qobject_cast<QTcpSocket *>(networkManager->createConnection(NetworkManager::TcpSocket));
+        socket->connectToHost(definition->host, definition->port);
+
+        if (!socket->waitForConnected(5000))
+        {
+            setErrorString(QString("Unable to connect stream %1: %2").arg(m_streams.size() + 1).arg(socket->errorString()));
+            delete socket;
+            return false;
+        }
+
+        m_streams.append(new BulkTransportCapacityStream(socket, this));
     }
 
-    // Signal for new data
-    connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(receiveResponse()));
+    foreach (BulkTransportCapacityStream *stream, m_streams)
+    {
+        connect(stream, SIGNAL(finished()), this, SLOT(streamFinished()));
+        connect(stream, SIGNAL(error(const QString &)), this, SLOT(handleError(const QString &)));
+    }
 
-    // Signal for errors
-    connect(m_tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
-            SLOT(handleError(QAbstractSocket::SocketError)));
+    m_preTest = true;
+
+    // a pretest for every direction
+    int pretests = definition->direction == btc::Both ? 2 : 1;
 
-    // Signal for end of data transmission
-    connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(serverDisconnected()));
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(definition->initialDataSize * pretests))
+    {
+        setErrorString("not enough traffic available");
+        return false;
+    }
 
     return true;
 }
 
 bool BulkTransportCapacityMA::stop()
 {
-    if (m_tcpSocket)
+    m_tcpInfoTimer.stop();
+
+    foreach (BulkTransportCapacityStream *stream, m_streams)
     {
-        m_tcpSocket->disconnectFromHost();
+        QTcpSocket *socket = stream->socket();
+        socket->disconnectFromHost();
 
-        if (m_tcpSocket->state() != QTcpSocket::UnconnectedState &&
-            !m_tcpSocket->waitForDisconnected(1000))
+        if (socket->state() != QTcpSocket::UnconnectedState &&
+            !socket->waitForDisconnected(1000))
         {
             return false;
         }
@@ -249,34 +321,18 @@ bool BulkTransportCapacityMA::stop()
 
 Result BulkTransportCapacityMA::result() const
 {
-    QVariantMap res;
-    QVariantList downSpeeds;
-    float avg = 0.0;
-
-    // get max and min
-    QList<qreal>::const_iterator it = std::max_element(m_downloadSpeeds.begin(), m_downloadSpeeds.end());
-    float max = *it;
-    it = std::min_element(m_downloadSpeeds.begin(), m_downloadSpeeds.end());
-    float min = *it;
-
-    // calculate average and fill downspeeds
-    foreach (qreal val, m_downloadSpeeds)
-    {
-        downSpeeds << val;
-        avg += val;
-    }
+    // the first direction measured keeps the keys of the download only
+    // times, with one stream they are what they always were
+    QVariantMap res = m_results.value(m_results.contains("download") ? "download" : "upload").toMap();
+    res.remove("streams");
 
-    avg /= m_downloadSpeeds.size();
+    res.insert("direction", BulkTransportCapacityDefinition::directionToString(definition->direction));
+    res.insert("streams", definition->streams);
 
-    // calculate standard deviation
-    qreal sq_sum = std::inner_product(m_downloadSpeeds.begin(), m_downloadSpeeds.end(), m_downloadSpeeds.begin(), 0.0);
-    qreal stdev = qSqrt(sq_sum / m_downloadSpeeds.size() - avg * avg);
-
-    res.insert("kBs_avg", avg);
-    res.insert("kBs_min", min);
-    res.insert("kBs_max", max);
-    res.insert("kBs_stddev", stdev);
-    res.insert("kBs", downSpeeds);
+    for (QVariantMap::const_iterator it = m_results.constBegin(); it != m_results.constEnd(); ++it)
+    {
+        res.insert(it.key(), it.value());
+    }
 
     return Result(res, definition->measurementUuid);
 }
@@ -3,10 +3,11 @@
 
 #include "../measurement.h"
 #include "btc_definition.h"
+#include "btc_stream.h"
 
 #include <QObject>
 #include <QTcpSocket>
-#include <QElapsedTimer>
+#include <QTimer>
 
 class BulkTransportCapacityMA : public Measurement
 {
@@ -23,26 +24,28 @@ public:
     Result result() const;
 
 private:
-    void sendRequest(quint64 bytes);
-    void calculateResult();
+    void nextDirection();
+    void transfer(BulkTransportCapacityStream *stream, quint64 bytes);
+    QVariantMap directionResult() const;
 
     BulkTransportCapacityDefinitionPtr definition;
+    QList<BulkTransportCapacityStream *> m_streams;
+    // directions still to measure after the current one
+    QList<btc::Direction> m_directions;
+    btc::Direction m_direction;
     bool m_preTest;
-    QTcpSocket *m_tcpSocket;
-    QElapsedTimer m_time;
-    qint64 m_bytesReceived; // without first packets
-    qint64 m_totalBytesReceived; // with first packets
-    qint64 m_bytesExpected;
-    qint64 m_lasttime;
-    QList<qreal> m_downloadSpeeds;
+    int m_runningStreams;
     Status m_status;
-    QVector<qint64> m_bytesReceivedList;
-    QVector<qint64> m_times;
+    QVariantMap m_results;
+    // TCP_INFO of the streams after the pretest
+    QTimer m_tcpInfoTimer;
+
+    static const int maxStreams = 16;
 
 private slots:
-    void receiveResponse();
-    void serverDisconnected();
-    void handleError(QAbstractSocket::SocketError socketError);
+    void streamFinished();
+    void sampleTcpInfo();
+    void handleError(const QString &message);
 };
 
 #endif // BTC_MA_H
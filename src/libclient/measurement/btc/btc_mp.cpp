@@ -1,4 +1,5 @@
 #include "btc_mp.h"
+#include "btc_stream.h"
 #include "../../log/logger.h"
 #include "../../network/networkmanager.h"
 
@@ -6,89 +7,222 @@
 
 LOGGER(BulkTransportCapacityMP);
 
-BulkTransportCapacityMP::BulkTransportCapacityMP(QObject *parent)
-: Measurement(parent)
-, m_tcpServer(NULL)
+namespace
 {
-    connect(this, SIGNAL(error(const QString &)), this,
-            SLOT(setErrorString(const QString &)));
-    resetServer();
+    // uploaded data is not needed
+    char readBuffer[65536];
 }
 
-bool BulkTransportCapacityMP::start()
+BulkTransportCapacitySession::BulkTransportCapacitySession(QTcpSocket *socket, bool uploads, QObject *parent)
+: QObject(parent)
+, m_socket(socket)
+, m_uploads(uploads)
+, m_remaining(0)
+, m_position(0)
+, m_uploadRemaining(0)
+, m_uploadSlices(0)
+, m_lastTime(0)
 {
-    // Start listening
-    bool ret = m_tcpServer->listen(QHostAddress::Any, definition->port);
-    LOG_DEBUG(QString("Listening on port %1: %2").arg(definition->port).arg(ret));
-    return ret;
-}
+    m_socket->setParent(this);
 
-qint64 BulkTransportCapacityMP::sendResponse(quint64 bytes)
-{
-    // send data back
-    QByteArray data;
-    data.resize(bytes);
-    data.fill('X'); // TODO: do we need to randomize this to prevent compression on the path?
-    return m_tcpSocket->write(data);
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(receiveRequest()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(sendMore()));
+    connect(m_socket, SIGNAL(disconnected()), this, SIGNAL(finished()));
+    connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
 }
 
-void BulkTransportCapacityMP::resetServer()
+void BulkTransportCapacitySession::receiveRequest()
 {
-    m_tcpSocket = 0;
+    // a request may arrive in pieces or together with the next one
+    while (m_socket->bytesAvailable() > 0)
+    {
+        if (m_uploadRemaining > 0)
+        {
+            receiveUpload();
+            continue;
+        }
+
+        QByteArray head = m_socket->peek(sizeof(quint64) + sizeof(quint16));
+
+        if (head.size() < (int)sizeof(quint64))
+        {
+            break;
+        }
+
+        QDataStream in(head);
+        quint64 request;
+        in >> request;
+
+        if (!(request & btc::uploadFlag))
+        {
+            m_socket->read(sizeof(quint64));
+            m_remaining += request;
+
+            LOG_INFO(QString("Client requested %1 bytes").arg(request));
+            continue;
+        }
+
+        if (!m_uploads)
+        {
+            LOG_WARNING("Client requested an upload, which was not offered");
+            m_socket->abort();
+            emit finished();
+            return;
+        }
+
+        if (head.size() < (int)(sizeof(quint64) + sizeof(quint16)))
+        {
+            break;
+        }
+
+        in >> m_uploadSlices;
+        m_socket->read(head.size());
+
+        m_uploadRemaining = request & ~btc::uploadFlag;
+        m_uploadTime.invalidate();
+        m_lastTime = 0;
+        m_sampleBytes.clear();
+        m_sampleTimes.clear();
+
+        LOG_INFO(QString("Client uploads %1 bytes").arg(m_uploadRemaining));
+
+        if (m_uploadRemaining == 0)
+        {
+            sendReport();
+        }
+    }
+
+    sendMore();
 }
 
-void BulkTransportCapacityMP::newClientConnection()
+void BulkTransportCapacitySession::receiveUpload()
 {
-    LOG_INFO("New client connection");
+    qint64 time = m_uploadTime.nsecsElapsed();
+    qint64 n = m_socket->read(readBuffer, qMin((quint64)sizeof(readBuffer), m_uploadRemaining));
 
-    if (!m_tcpSocket)
+    if (n <= 0)
     {
-        m_tcpSocket = m_tcpServer->nextPendingConnection();
+        return;
+    }
 
-        connect(m_tcpSocket, SIGNAL(disconnected()), this, SIGNAL(finished()));
-        connect(m_tcpSocket, SIGNAL(disconnected()), m_tcpSocket, SLOT(deleteLater()));
-        connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(receiveRequest()));
-        connect(m_tcpSocket, SIGNAL(destroyed()), this, SLOT(resetServer()));
+    // like for a download the first packet only starts the clock
+    if (!m_uploadTime.isValid())
+    {
+        m_uploadTime.start();
     }
     else
     {
-        LOG_WARNING("There is already a client connected, abort");
-        QTcpSocket *next = m_tcpServer->nextPendingConnection();
-        next->abort();
-        delete next;
+        m_sampleBytes.append(n);
+        m_sampleTimes.append(time - m_lastTime);
+        m_lastTime = time;
+    }
+
+    m_uploadRemaining -= n;
+
+    if (m_uploadRemaining == 0)
+    {
+        sendReport();
     }
 }
 
-void BulkTransportCapacityMP::receiveRequest()
+void BulkTransportCapacitySession::sendReport()
 {
-    LOG_INFO("New client request");
+    QList<btc::Slice> slices = btc::slices(m_sampleBytes, m_sampleTimes, m_uploadSlices);
+    QDataStream out(m_socket);
+
+    out << (quint16)slices.size();
 
-    // abort if received data is not what we expected
-    if (m_tcpSocket->bytesAvailable() < (int)sizeof(quint64))
+    foreach (const btc::Slice &slice, slices)
     {
-        LOG_DEBUG("Data length is not what we expected");
-        return;
+        out << (quint64)slice.bytes << (quint64)slice.time;
     }
+}
 
-    // get bytes from message
-    QDataStream in(m_tcpSocket);
+void BulkTransportCapacitySession::sendMore()
+{
+    const QByteArray &data = btc::randomBlock();
+
+    while (m_remaining > 0 && m_socket->bytesToWrite() < maxQueued)
+    {
+        qint64 size = qMin((qint64)qMin((quint64)chunkSize, m_remaining), (qint64)(data.size() - m_position));
+        qint64 written = m_socket->write(data.constData() + m_position, size);
 
-    quint64 bytes;
-    in >> bytes;
-    sendResponse(bytes);
+        if (written <= 0)
+        {
+            return;
+        }
+
+        m_remaining -= written;
+        m_position = (m_position + written) % data.size();
+    }
 }
 
-void BulkTransportCapacityMP::handleError(QAbstractSocket::SocketError socketError)
+void BulkTransportCapacitySession::handleError(QAbstractSocket::SocketError socketError)
 {
     if (socketError == QAbstractSocket::RemoteHostClosedError)
     {
         return;
     }
 
-    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
-    emit error(QString("Socket Error: %1").arg(socket->errorString()));
+    // only this client is affected, the others go on
+    LOG_WARNING(QString("Socket Error: %1").arg(m_socket->errorString()));
+    emit finished();
+}
+
+BulkTransportCapacityMP::BulkTransportCapacityMP(QObject *parent)
+: Measurement(parent)
+, m_tcpServer(NULL)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+bool BulkTransportCapacityMP::start()
+{
+    // Start listening
+    bool ret = m_tcpServer->listen(QHostAddress::Any, definition->port);
+    LOG_DEBUG(QString("Listening on port %1: %2").arg(definition->port).arg(ret));
+    return ret;
+}
+
+void BulkTransportCapacityMP::newClientConnection()
+{
+    while (m_tcpServer->hasPendingConnections())
+    {
+        BulkTransportCapacitySession *session = new BulkTransportCapacitySession(m_tcpServer->nextPendingConnection(),
+                                                                                  definition->protocol >= btc::uploadProtocol,
+                                                                                  this);
+        connect(session, SIGNAL(finished()), this, SLOT(sessionFinished()));
+        m_sessions.append(session);
+
+        LOG_INFO(QString("New client connection, %1 connected").arg(m_sessions.size()));
+    }
+}
+
+void BulkTransportCapacityMP::sessionFinished()
+{
+    BulkTransportCapacitySession *session = qobject_cast<BulkTransportCapacitySession *>(sender());
+
+    if (!m_sessions.removeOne(session))
+    {
+        return;
+    }
+
+    session->deleteLater();
 
-    emit error(socket->errorString());
+    // like with a single client the MP is done once nobody is connected
+    if (m_sessions.isEmpty())
+    {
+        emit finished();
+    }
+}
+
+void BulkTransportCapacityMP::handleError(QAbstractSocket::SocketError socketError)
+{
+    Q_UNUSED(socketError);
+
+    emit error(QString("Socket Error: %1").arg(m_tcpServer->errorString()));
 }
 
 Measurement::Status BulkTransportCapacityMP::status() const
@@ -104,9 +238,15 @@ bool BulkTransportCapacityMP::prepare(NetworkManager *networkManager,
     if (definition.isNull())
     {
         setErrorString("Definition is empty");
+        return false;
+    }
+
+    if (definition->protocol > btc::uploadProtocol)
+    {
+        setErrorString("Unknown protocol");
+        return false;
     }
 
-    m_tcpSocket = 0;
     m_tcpServer = networkManager->createServerSocket();
     m_tcpServer->setParent(this);
 
@@ -122,7 +262,8 @@ bool BulkTransportCapacityMP::prepare(NetworkManager *networkManager,
 
 bool BulkTransportCapacityMP::stop()
 {
-    delete m_tcpSocket;
+    qDeleteAll(m_sessions);
+    m_sessions.clear();
     return true;
 }
 
@@ -7,6 +7,51 @@
 #include <QObject>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QVector>
+
+// one MA connected to the MP, its download requests are answered from a
+// shared block in chunks whenever the socket drained enough. Uploads are
+// timed like the MA times downloads and answered with their slices.
+class BulkTransportCapacitySession : public QObject
+{
+    Q_OBJECT
+
+public:
+    // without uploads the session speaks the download only protocol
+    BulkTransportCapacitySession(QTcpSocket *socket, bool uploads, QObject *parent = 0);
+
+private:
+    void receiveUpload();
+    void sendReport();
+
+    QTcpSocket *m_socket;
+    bool m_uploads;
+    // bytes requested but not yet handed to the socket
+    quint64 m_remaining;
+    // where in the block the next chunk starts
+    int m_position;
+
+    // bytes of the current upload still to come
+    quint64 m_uploadRemaining;
+    quint16 m_uploadSlices;
+    QElapsedTimer m_uploadTime;
+    qint64 m_lastTime;
+    QVector<qint64> m_sampleBytes;
+    QVector<qint64> m_sampleTimes;
+
+    // queued in the socket at most, this bounds the memory of a session
+    static const qint64 maxQueued = 1 << 20;
+    static const int chunkSize = 65536;
+
+private slots:
+    void receiveRequest();
+    void sendMore();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+signals:
+    void finished();
+};
 
 class BulkTransportCapacityMP : public Measurement
 {
@@ -23,16 +68,13 @@ public:
     Result result() const;
 
 private:
-    qint64 sendResponse(quint64 bytes);
-
     BulkTransportCapacityDefinitionPtr definition;
     QTcpServer *m_tcpServer;
-    QTcpSocket *m_tcpSocket;
+    QList<BulkTransportCapacitySession *> m_sessions;
 
 private slots:
-    void resetServer();
     void newClientConnection();
-    void receiveRequest();
+    void sessionFinished();
     void handleError(QAbstractSocket::SocketError socketError);
 };
 
@@ -0,0 +1,302 @@
+#include "btc_stream.h"
+#include "../../log/logger.h"
+#include "../../network/randomdata.h"
+
+#include <QDataStream>
+#include <QtCore/QtMath>
+
+LOGGER(BulkTransportCapacityStream);
+
+namespace
+{
+    // the data read is not needed
+    char readBuffer[65536];
+}
+
+QList<btc::Slice> btc::slices(const QVector<qint64> &bytes, const QVector<qint64> &times, int count)
+{
+    QList<Slice> list;
+
+    if (times.isEmpty() || count < 1)
+    {
+        return list;
+    }
+
+    // round up to get the correct number of slices
+    int sliceSize = qCeil((qreal)times.size() / count);
+    Slice slice = { 0, 0 };
+
+    for (int i = 0; i < times.size(); i++)
+    {
+        slice.bytes += bytes.at(i);
+        slice.time += times.at(i);
+
+        // calculate a slice if enough samples are added up or if this is the last iteration
+        if (((i + 1) % sliceSize) == 0 || i == times.size() - 1)
+        {
+            list.append(slice);
+            slice.bytes = 0;
+            slice.time = 0;
+        }
+    }
+
+    return list;
+}
+
+qreal btc::speed(qint64 bytes, qint64 time)
+{
+    if (time <= 0)
+    {
+        return 0.0;
+    }
+
+    return (bytes / 1024.0) / (time / 1000000000.0);
+}
+
+const QByteArray &btc::randomBlock()
+{
+    static const QByteArray data = randomData(1 << 20);
+    return data;
+}
+
+BulkTransportCapacityStream::BulkTransportCapacityStream(QTcpSocket *socket, QObject *parent)
+: QObject(parent)
+, m_socket(socket)
+, m_state(Idle)
+, m_bytes(0)
+, m_remaining(0)
+, m_slices(0)
+, m_position(0)
+, m_lastTime(0)
+, m_speed(0.0)
+{
+    m_socket->setParent(this);
+
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(sendMore()));
+    connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+}
+
+QTcpSocket *BulkTransportCapacityStream::socket() const
+{
+    return m_socket;
+}
+
+void BulkTransportCapacityStream::download(quint64 bytes, int slices)
+{
+    start(Downloading, bytes, slices);
+
+    QDataStream out(m_socket);
+    out << bytes;
+}
+
+void BulkTransportCapacityStream::upload(quint64 bytes, int slices)
+{
+    start(Uploading, bytes, slices);
+
+    QDataStream out(m_socket);
+    out << (bytes | btc::uploadFlag) << (quint16)slices;
+
+    m_time.start();
+    sendMore();
+}
+
+void BulkTransportCapacityStream::start(State state, quint64 bytes, int slices)
+{
+    m_state = state;
+    m_bytes = bytes & ~btc::uploadFlag;
+    m_remaining = m_bytes;
+    m_slices = slices;
+    m_lastTime = 0;
+    m_sampleBytes.clear();
+    m_sampleTimes.clear();
+    m_speed = 0.0;
+    m_sliceSpeeds.clear();
+    m_tcpInfo.clear();
+
+    m_time.invalidate();
+    m_requestTime.start();
+}
+
+qreal BulkTransportCapacityStream::speed() const
+{
+    return m_speed;
+}
+
+QList<qreal> BulkTransportCapacityStream::sliceSpeeds() const
+{
+    return m_sliceSpeeds;
+}
+
+void BulkTransportCapacityStream::sampleTcpInfo()
+{
+    if (m_state != Idle && m_time.isValid())
+    {
+        m_tcpInfo.sample(m_socket, m_time.nsecsElapsed());
+    }
+}
+
+const TcpInfoSeries &BulkTransportCapacityStream::tcpInfo() const
+{
+    return m_tcpInfo;
+}
+
+void BulkTransportCapacityStream::readyRead()
+{
+    switch (m_state)
+    {
+    case Downloading:
+        readDownload();
+        break;
+
+    case AwaitingReport:
+        readReport();
+        break;
+
+    default:
+        // nothing is expected
+        m_socket->readAll();
+        break;
+    }
+}
+
+void BulkTransportCapacityStream::readDownload()
+{
+    qint64 time = m_time.nsecsElapsed();
+    qint64 bytes = 0;
+    qint64 n;
+
+    while ((n = m_socket->read(readBuffer, sizeof(readBuffer))) > 0)
+    {
+        bytes += n;
+    }
+
+    // the first packet only starts the clock, it includes the round trip of
+    // the request
+    if (!m_time.isValid())
+    {
+        m_time.start();
+    }
+    else
+    {
+        m_sampleBytes.append(bytes);
+        m_sampleTimes.append(time - m_lastTime);
+        m_lastTime = time;
+    }
+
+    m_remaining -= qMin((quint64)bytes, m_remaining);
+
+    if (m_remaining == 0)
+    {
+        finish(btc::slices(m_sampleBytes, m_sampleTimes, m_slices));
+    }
+}
+
+void BulkTransportCapacityStream::readReport()
+{
+    if (m_socket->bytesAvailable() < (qint64)sizeof(quint16))
+    {
+        return;
+    }
+
+    QByteArray count = m_socket->peek(sizeof(quint16));
+    quint16 slices;
+    QDataStream(count) >> slices;
+
+    if (m_socket->bytesAvailable() < (qint64)(sizeof(quint16) + slices * 2 * sizeof(quint64)))
+    {
+        return;
+    }
+
+    QDataStream in(m_socket);
+    QList<btc::Slice> report;
+
+    in >> slices;
+
+    for (int i = 0; i < slices; i++)
+    {
+        quint64 bytes;
+        quint64 time;
+        in >> bytes >> time;
+
+        btc::Slice slice = { (qint64)bytes, (qint64)time };
+        report.append(slice);
+    }
+
+    finish(report);
+}
+
+void BulkTransportCapacityStream::finish(QList<btc::Slice> slices)
+{
+    qint64 bytes = 0;
+    qint64 time = 0;
+
+    foreach (const btc::Slice &slice, slices)
+    {
+        bytes += slice.bytes;
+        time += slice.time;
+    }
+
+    // everything came at once, so the time since the request is all there is
+    if (time == 0)
+    {
+        btc::Slice slice = { (qint64)m_bytes, m_requestTime.nsecsElapsed() };
+        slices = QList<btc::Slice>() << slice;
+        bytes = slice.bytes;
+        time = slice.time;
+
+        LOG_DEBUG("Transfer too short to measure, using the time since the request");
+    }
+
+    m_speed = btc::speed(bytes, time);
+
+    foreach (const btc::Slice &slice, slices)
+    {
+        m_sliceSpeeds.append(btc::speed(slice.bytes, slice.time));
+    }
+
+    m_state = Idle;
+    emit finished();
+}
+
+void BulkTransportCapacityStream::sendMore()
+{
+    if (m_state != Uploading)
+    {
+        return;
+    }
+
+    const QByteArray &data = btc::randomBlock();
+
+    while (m_remaining > 0 && m_socket->bytesToWrite() < maxQueued)
+    {
+        qint64 size = qMin((qint64)qMin((quint64)chunkSize, m_remaining), (qint64)(data.size() - m_position));
+        qint64 written = m_socket->write(data.constData() + m_position, size);
+
+        if (written <= 0)
+        {
+            return;
+        }
+
+        m_remaining -= written;
+        m_position = (m_position + written) % data.size();
+    }
+
+    if (m_remaining == 0)
+    {
+        m_state = AwaitingReport;
+        readReport();
+    }
+}
+
+void BulkTransportCapacityStream::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError && m_state == Idle)
+    {
+        return;
+    }
+
+    LOG_ERROR(QString("Socket Error: %1").arg(m_socket->errorString()));
+    emit error(m_socket->errorString());
+}
@@ -0,0 +1,109 @@
+#ifndef BTC_STREAM_H
+#define BTC_STREAM_H
+
+#include "../../network/tcpinfo.h"
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QVector>
+
+namespace btc
+{
+    // with btc::uploadProtocol the top bit of a request marks an upload of
+    // the remaining bits' bytes, followed by the number of slices (quint16)
+    // the MP reports
+    const quint64 uploadFlag = Q_UINT64_C(1) << 63;
+
+    struct Slice
+    {
+        qint64 bytes;
+        // ns
+        qint64 time;
+    };
+
+    // groups samples of the bytes read at once and the ns since the
+    // previous read into count slices of about the same number of samples
+    QList<Slice> slices(const QVector<qint64> &bytes, const QVector<qint64> &times, int count);
+
+    // KiB/s
+    qreal speed(qint64 bytes, qint64 time);
+
+    // random data for uploads and downloads, so that no compression on the
+    // path makes the link look faster
+    const QByteArray &randomBlock();
+}
+
+// one TCP connection of the MA to the MP, measures one transfer at a time
+// in either direction. The first read of a download only starts the clock,
+// the MP does the same for an upload and reports its slices back.
+class BulkTransportCapacityStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BulkTransportCapacityStream(QTcpSocket *socket, QObject *parent = 0);
+
+    QTcpSocket *socket() const;
+
+    // finished() or error() tell how it went
+    void download(quint64 bytes, int slices);
+    void upload(quint64 bytes, int slices);
+
+    // of the last transfer, in KiB/s
+    qreal speed() const;
+    QList<qreal> sliceSpeeds() const;
+
+    // times are ns since the clock of the transfer started
+    void sampleTcpInfo();
+    const TcpInfoSeries &tcpInfo() const;
+
+private:
+    enum State
+    {
+        Idle,
+        Downloading,
+        Uploading,
+        AwaitingReport
+    };
+
+    void start(State state, quint64 bytes, int slices);
+    void readDownload();
+    void readReport();
+    void finish(QList<btc::Slice> slices);
+
+    QTcpSocket *m_socket;
+    State m_state;
+    quint64 m_bytes;
+    // download: still to receive, upload: still to write
+    quint64 m_remaining;
+    int m_slices;
+    int m_position;
+
+    // runs from the request, used if a transfer was too short to measure
+    QElapsedTimer m_requestTime;
+    // runs from the first read of a download, from the request of an upload
+    QElapsedTimer m_time;
+    qint64 m_lastTime;
+    QVector<qint64> m_sampleBytes;
+    QVector<qint64> m_sampleTimes;
+
+    qreal m_speed;
+    QList<qreal> m_sliceSpeeds;
+    TcpInfoSeries m_tcpInfo;
+
+    // queued in the socket at most while uploading
+    static const qint64 maxQueued = 1 << 20;
+    static const int chunkSize = 65536;
+
+private slots:
+    void readyRead();
+    void sendMore();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+signals:
+    void finished();
+    void error(const QString &message);
+};
+
+#endif // BTC_STREAM_H
@@ -0,0 +1,45 @@
+#include "cbr_definition.h"
+
+ConstantBitrateDefinition::ConstantBitrateDefinition(const QString &host, quint16 port, quint16 rate,
+                                                     quint16 payloadSize, quint32 duration, quint16 playoutDelay)
+: host(host)
+, port(port)
+, rate(rate)
+, payloadSize(payloadSize)
+, duration(duration)
+, playoutDelay(playoutDelay)
+{
+}
+
+ConstantBitrateDefinition::~ConstantBitrateDefinition()
+{
+}
+
+quint64 ConstantBitrateDefinition::count() const
+{
+    return (quint64)rate * duration / 1000;
+}
+
+QVariant ConstantBitrateDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("host", host);
+    map.insert("port", port);
+    map.insert("rate", rate);
+    map.insert("payload_size", payloadSize);
+    map.insert("duration", duration);
+    map.insert("playout_delay", playoutDelay);
+    return map;
+}
+
+ConstantBitrateDefinitionPtr ConstantBitrateDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+
+    return ConstantBitrateDefinitionPtr(new ConstantBitrateDefinition(map.value("host", "").toString(),
+                                                                      map.value("port", 5106).toUInt(),
+                                                                      map.value("rate", 50).toUInt(),
+                                                                      map.value("payload_size", 160).toUInt(),
+                                                                      map.value("duration", 30000).toUInt(),
+                                                                      map.value("playout_delay", 60).toUInt()));
+}
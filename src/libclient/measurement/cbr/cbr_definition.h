@@ -0,0 +1,64 @@
+#ifndef CBR_DEFINITION_H
+#define CBR_DEFINITION_H
+
+#include "../measurementdefinition.h"
+
+namespace cbr
+{
+    enum MessageType
+    {
+        DataMessage = 1,
+        DoneMessage,
+        // JSON with the statistics of the MP follows the type
+        SummaryMessage
+    };
+
+    // start of every data packet, the rest is padding; big endian
+    struct Packet
+    {
+        quint8 type;
+        quint8 reserved[3];
+        quint32 seq;
+        qint64 sendTime;
+    };
+
+    // the MP keeps a flag and a transit time per packet, ten minutes at
+    // 1000 packets/s
+    const quint64 maxPackets = 600000;
+}
+
+class ConstantBitrateDefinition;
+
+typedef QSharedPointer<ConstantBitrateDefinition> ConstantBitrateDefinitionPtr;
+typedef QList<ConstantBitrateDefinitionPtr> ConstantBitrateDefinitionList;
+
+class ConstantBitrateDefinition : public MeasurementDefinition
+{
+public:
+    ConstantBitrateDefinition(const QString &host, quint16 port, quint16 rate, quint16 payloadSize,
+                              quint32 duration, quint16 playoutDelay);
+    ~ConstantBitrateDefinition();
+
+    // Storage
+    static ConstantBitrateDefinitionPtr fromVariant(const QVariant &variant);
+
+    // packets of the whole stream
+    quint64 count() const;
+
+    // Getters
+    QString host;
+    quint16 port;
+    // packets per second
+    quint16 rate;
+    // UDP payload
+    quint16 payloadSize;
+    // ms
+    quint32 duration;
+    // ms a packet may be later than the fastest one and still be played
+    quint16 playoutDelay;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // CBR_DEFINITION_H
@@ -0,0 +1,187 @@
+#include "cbr_ma.h"
+#include "../../log/logger.h"
+#include "../../network/networkmanager.h"
+#include "../../client.h"
+#include "../../trafficbudgetmanager.h"
+#include "../packettrains/receiver.h"
+
+#include <QJsonDocument>
+#include <QtEndian>
+
+#include <string.h>
+
+LOGGER(ConstantBitrateMA);
+
+namespace
+{
+    // the MP sends its summary at the latest 5 s after the last packet
+    const int summaryTimeout = 7000;
+}
+
+ConstantBitrateMA::ConstantBitrateMA()
+: m_udpSocket(NULL)
+, m_sent(0)
+, m_sendErrors(0)
+, m_duration(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status ConstantBitrateMA::status() const
+{
+    return Unknown;
+}
+
+bool ConstantBitrateMA::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    definition = measurementDefinition.dynamicCast<ConstantBitrateDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    if (definition->rate == 0 || definition->count() == 0 || definition->count() > cbr::maxPackets ||
+        definition->payloadSize < sizeof(cbr::Packet))
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
+    QString hostname = QString("%1:%2").arg(definition->host).arg(definition->port);
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(networkManager->establishConnection(hostname, taskId(), "cbr_mp",
+                                                                                 definition, NetworkManager::UdpSocket));
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+
+    if (!m_pacer.setDestination(m_udpSocket->socketDescriptor(), definition->host, definition->port))
+    {
+        setErrorString(QString("Unable to resolve %1").arg(definition->host));
+        return false;
+    }
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(definition->count() * definition->payloadSize))
+    {
+        setErrorString("not enough traffic available");
+        return false;
+    }
+
+    return true;
+}
+
+bool ConstantBitrateMA::start()
+{
+    QByteArray buffer(definition->payloadSize, 0);
+
+    cbr::Packet packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.type = cbr::DataMessage;
+
+    m_sent = 0;
+    m_sendErrors = 0;
+    m_summary.clear();
+
+    m_pacer.calibrate();
+
+    qint64 interval = 1000000000LL / definition->rate;
+    qint64 start = Pacer::now() + m_pacer.spinThreshold();
+    qint64 deadline = start;
+
+    for (quint32 i = 0; i < definition->count(); i++)
+    {
+        qint64 time = m_pacer.waitUntil(deadline);
+
+        packet.seq = qToBigEndian(i);
+        packet.sendTime = qToBigEndian(time);
+        memcpy(buffer.data(), &packet, sizeof(packet));
+
+        if (m_pacer.send(buffer.constData(), buffer.size()))
+        {
+            m_sent++;
+        }
+        else
+        {
+            m_sendErrors++;
+        }
+
+        deadline += interval;
+    }
+
+    m_duration = Pacer::now() - start;
+
+    char done = cbr::DoneMessage;
+    m_pacer.sendUnacknowledged(&done, sizeof(done));
+
+    if (!waitForSummary())
+    {
+        LOG_WARNING("No summary from the MP");
+    }
+
+    emit finished();
+    return true;
+}
+
+bool ConstantBitrateMA::waitForSummary()
+{
+    qint64 deadline = Pacer::now() + summaryTimeout * 1000000LL;
+    QByteArray datagram;
+
+    while (Receiver::waitForDatagram(m_udpSocket, deadline, &datagram))
+    {
+        if (datagram.isEmpty() || datagram.at(0) != cbr::SummaryMessage)
+        {
+            continue;
+        }
+
+        QJsonParseError error;
+        QJsonDocument document = QJsonDocument::fromJson(datagram.mid(1), &error);
+
+        if (error.error == QJsonParseError::NoError)
+        {
+            m_summary = document.toVariant().toMap();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ConstantBitrateMA::stop()
+{
+    return true;
+}
+
+void ConstantBitrateMA::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+// the statistics of the receiving MP plus the sender side
+Result ConstantBitrateMA::result() const
+{
+    QVariantMap map = m_summary;
+    map.insert("sent", m_sent);
+    map.insert("send_errors", m_sendErrors);
+    map.insert("duration_ns", m_duration);
+    map.insert("summary_received", !m_summary.isEmpty());
+
+    return Result(map, definition->measurementUuid);
+}
@@ -0,0 +1,44 @@
+#ifndef CBR_MA_H
+#define CBR_MA_H
+
+#include <QUdpSocket>
+
+#include "../measurement.h"
+#include "../packettrains/pacer.h"
+#include "cbr_definition.h"
+
+/*
+ * Sends a constant bitrate UDP stream like a VoIP call to the MP and
+ * reports the jitter, loss, late packets and MOS the MP saw.
+ */
+class ConstantBitrateMA : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit ConstantBitrateMA();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    bool waitForSummary();
+
+    ConstantBitrateDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Pacer m_pacer;
+
+    quint32 m_sent;
+    int m_sendErrors;
+    qint64 m_duration;
+    QVariantMap m_summary;
+};
+
+#endif // CBR_MA_H
@@ -0,0 +1,286 @@
+#include "cbr_mp.h"
+#include "../../log/logger.h"
+
+#include <QJsonDocument>
+#include <QtEndian>
+
+#include <string.h>
+
+LOGGER(ConstantBitrateMP);
+
+namespace
+{
+    // ms without packets before the stream is evaluated anyway
+    const int minTimeout = 5000;
+
+    // the summary is not acknowledged
+    const int summaryMessages = 3;
+}
+
+ConstantBitrateMP::ConstantBitrateMP()
+: m_udpSocket(NULL)
+, m_highestSeq(-1)
+, m_receivedCount(0)
+, m_duplicates(0)
+, m_reordered(0)
+, m_unexpected(0)
+, m_peerPort(0)
+, m_finished(false)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status ConstantBitrateMP::status() const
+{
+    return Unknown;
+}
+
+bool ConstantBitrateMP::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager);
+
+    definition = measurementDefinition.dynamicCast<ConstantBitrateDefinition>();
+
+    if (definition.isNull() || definition->rate == 0)
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    // the definition comes from the peer, it sizes the buffers below
+    if (definition->count() == 0 || definition->count() > cbr::maxPackets)
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(peerSocket());
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    m_receiver.setSocket(m_udpSocket);
+
+    m_received.fill(false, definition->count());
+    m_transits.fill(0, definition->count());
+
+    return true;
+}
+
+bool ConstantBitrateMP::start()
+{
+    // Timeout for "nothing happens"
+    connect(&m_timeout, SIGNAL(timeout()), this, SLOT(finish()));
+    m_timeout.setInterval(qMax(minTimeout, 3000 / definition->rate));
+    m_timeout.setSingleShot(true);
+    m_timeout.start();
+
+    m_receiver.notify(this, SLOT(readPendingDatagrams()));
+
+    return true;
+}
+
+bool ConstantBitrateMP::stop()
+{
+    m_timeout.stop();
+
+    m_receiver.stopNotifying();
+
+    return true;
+}
+
+void ConstantBitrateMP::readPendingDatagrams()
+{
+    m_timeout.start();
+
+    int count;
+
+    while ((count = m_receiver.receive()) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (m_receiver.size(i) < 1)
+            {
+                continue;
+            }
+
+            quint8 type = m_receiver.data(i)[0];
+
+            if (type == cbr::DoneMessage)
+            {
+                m_peer = m_receiver.sender(i);
+                m_peerPort = m_receiver.senderPort(i);
+                finish();
+                return;
+            }
+
+            if (type != cbr::DataMessage || m_receiver.size(i) < (int)sizeof(cbr::Packet))
+            {
+                m_unexpected++;
+                continue;
+            }
+
+            cbr::Packet packet;
+            memcpy(&packet, m_receiver.data(i), sizeof(packet));
+
+            quint32 seq = qFromBigEndian(packet.seq);
+
+            if (seq >= (quint32)m_received.size())
+            {
+                m_unexpected++;
+                continue;
+            }
+
+            if (m_received.at(seq))
+            {
+                m_duplicates++;
+                continue;
+            }
+
+            qint64 transit = m_receiver.timestamp(i) - qFromBigEndian(packet.sendTime);
+
+            m_received[seq] = true;
+            m_transits[seq] = transit;
+            m_receivedCount++;
+            m_jitter.add(transit);
+
+            if ((qint64)seq < m_highestSeq)
+            {
+                m_reordered++;
+            }
+            else
+            {
+                m_highestSeq = seq;
+            }
+
+            m_peer = m_receiver.sender(i);
+            m_peerPort = m_receiver.senderPort(i);
+        }
+    }
+}
+
+void ConstantBitrateMP::finish()
+{
+    if (m_finished)
+    {
+        return;
+    }
+
+    m_finished = true;
+    stop();
+    evaluate();
+
+    if (!m_peer.isNull())
+    {
+        QByteArray summary;
+        summary.append((char)cbr::SummaryMessage);
+        summary.append(QJsonDocument::fromVariant(m_result).toJson(QJsonDocument::Compact));
+
+        for (int i = 0; i < summaryMessages; i++)
+        {
+            m_udpSocket->writeDatagram(summary, m_peer, m_peerPort);
+        }
+    }
+
+    emit finished();
+}
+
+void ConstantBitrateMP::evaluate()
+{
+    quint32 expected = m_received.size();
+    quint32 lost = expected - m_receivedCount;
+
+    // the fastest packet sets the playout schedule, the clock offset
+    // between MA and MP cancels out
+    qint64 minTransit = 0;
+    bool first = true;
+
+    for (int i = 0; i < m_transits.size(); i++)
+    {
+        if (m_received.at(i) && (first || m_transits.at(i) < minTransit))
+        {
+            minTransit = m_transits.at(i);
+            first = false;
+        }
+    }
+
+    quint32 late = 0;
+    qint64 playoutDelay = definition->playoutDelay * 1000000LL;
+
+    for (int i = 0; i < m_transits.size(); i++)
+    {
+        if (m_received.at(i) && m_transits.at(i) - minTransit > playoutDelay)
+        {
+            late++;
+        }
+    }
+
+    QVector<int> bursts = cbr::burstLengths(m_received);
+    QVariantMap histogram;
+    int maxBurst = 0;
+    qreal meanBurst = 0;
+
+    foreach (int burst, bursts)
+    {
+        histogram.insert(QString::number(burst), histogram.value(QString::number(burst), 0).toInt() + 1);
+        maxBurst = qMax(maxBurst, burst);
+        meanBurst += (qreal)burst / bursts.size();
+    }
+
+    qreal loss = expected > 0 ? (qreal)lost / expected : 0;
+    qreal effectiveLoss = expected > 0 ? (qreal)(lost + late) / expected : 0;
+
+    // 1 if the loss is random, mean bursts are 1 / (1 - loss) long then
+    qreal burstRatio = bursts.isEmpty() ? 1 : meanBurst * (1 - loss);
+
+    // without synchronized clocks only the jitter buffer and the
+    // packetization are known of the mouth-to-ear delay
+    qreal delay = definition->playoutDelay + 1000.0 / definition->rate;
+    qreal rFactor = cbr::rFactor(delay, effectiveLoss, burstRatio);
+
+    m_result.clear();
+    m_result.insert("expected", expected);
+    m_result.insert("received", m_receivedCount);
+    m_result.insert("lost", lost);
+    m_result.insert("loss", loss);
+    m_result.insert("duplicates", m_duplicates);
+    m_result.insert("reordered", m_reordered);
+    m_result.insert("unexpected", m_unexpected);
+    m_result.insert("late", late);
+    m_result.insert("jitter_ns", m_jitter.jitter());
+    m_result.insert("jitter_max_ns", m_jitter.maxJitter());
+    m_result.insert("burst_count", bursts.size());
+    m_result.insert("burst_max", maxBurst);
+    m_result.insert("burst_avg", meanBurst);
+    m_result.insert("burst_histogram", histogram);
+    m_result.insert("r_factor", rFactor);
+    m_result.insert("mos", cbr::mos(rFactor));
+    m_result.insert("kernel_timestamps", m_receiver.kernelTimestamps());
+
+    LOG_DEBUG(QString("Received %1 of %2 packets, MOS %3").arg(m_receivedCount).arg(expected).arg(cbr::mos(rFactor)));
+}
+
+void ConstantBitrateMP::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+Result ConstantBitrateMP::result() const
+{
+    return Result(m_result, getMeasurementUuid());
+}
@@ -0,0 +1,65 @@
+#ifndef CBR_MP_H
+#define CBR_MP_H
+
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "../measurement.h"
+#include "../packettrains/receiver.h"
+#include "cbr_definition.h"
+#include "cbr_stats.h"
+
+/*
+ * Receives the stream of the MA, evaluates it once the MA is done and sends
+ * the statistics back. Nothing is allocated per packet, the datagrams are
+ * read in batches into the ring of the Receiver.
+ */
+class ConstantBitrateMP : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit ConstantBitrateMP();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void readPendingDatagrams();
+    void finish();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    void evaluate();
+
+    ConstantBitrateDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Receiver m_receiver;
+
+    // indexed by sequence number
+    QVector<bool> m_received;
+    QVector<qint64> m_transits;
+
+    cbr::JitterEstimator m_jitter;
+    qint64 m_highestSeq;
+    quint32 m_receivedCount;
+    int m_duplicates;
+    int m_reordered;
+    int m_unexpected;
+
+    // the summary goes back to where the stream came from
+    QHostAddress m_peer;
+    quint16 m_peerPort;
+
+    bool m_finished;
+    QVariantMap m_result;
+
+    QTimer m_timeout;
+};
+
+#endif // CBR_MP_H
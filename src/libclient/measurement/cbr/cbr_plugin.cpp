@@ -0,0 +1,33 @@
+#include "cbr_plugin.h"
+#include "cbr_ma.h"
+#include "cbr_mp.h"
+#include "cbr_definition.h"
+
+QStringList ConstantBitratePlugin::measurements() const
+{
+    return QStringList()
+           << "cbr_ma"
+           << "cbr_mp";
+}
+
+MeasurementPtr ConstantBitratePlugin::createMeasurement(const QString &name)
+{
+    if (name == "cbr_ma")
+    {
+        return MeasurementPtr(new ConstantBitrateMA);
+    }
+
+    if (name == "cbr_mp")
+    {
+        return MeasurementPtr(new ConstantBitrateMP);
+    }
+
+    return MeasurementPtr();
+}
+
+MeasurementDefinitionPtr ConstantBitratePlugin::createMeasurementDefinition(const QString &name,
+                                                                            const QVariant &data)
+{
+    Q_UNUSED(name);
+    return ConstantBitrateDefinition::fromVariant(data);
+}
@@ -0,0 +1,16 @@
+#ifndef CBR_PLUGIN_H
+#define CBR_PLUGIN_H
+
+#include "../measurementplugin.h"
+
+class ConstantBitratePlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // CBR_PLUGIN_H
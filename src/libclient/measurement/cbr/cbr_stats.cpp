@@ -0,0 +1,99 @@
+#include "cbr_stats.h"
+
+namespace
+{
+    // G.711 has no equipment impairment, Bpl with PLC (ITU-T G.113)
+    const qreal equipmentImpairment = 0;
+    const qreal packetLossRobustness = 25.1;
+
+    // default R without any delay or loss
+    const qreal maxRFactor = 93.2;
+}
+
+cbr::JitterEstimator::JitterEstimator()
+: m_first(true)
+, m_lastTransit(0)
+, m_jitter(0)
+, m_maxJitter(0)
+{
+}
+
+void cbr::JitterEstimator::add(qint64 transit)
+{
+    if (!m_first)
+    {
+        qint64 difference = qAbs(transit - m_lastTransit);
+        m_jitter += (difference - m_jitter) / 16;
+        m_maxJitter = qMax(m_maxJitter, m_jitter);
+    }
+
+    m_first = false;
+    m_lastTransit = transit;
+}
+
+qreal cbr::JitterEstimator::jitter() const
+{
+    return m_jitter;
+}
+
+qreal cbr::JitterEstimator::maxJitter() const
+{
+    return m_maxJitter;
+}
+
+QVector<int> cbr::burstLengths(const QVector<bool> &received)
+{
+    QVector<int> bursts;
+    int length = 0;
+
+    foreach (bool packet, received)
+    {
+        if (!packet)
+        {
+            length++;
+        }
+        else if (length > 0)
+        {
+            bursts.append(length);
+            length = 0;
+        }
+    }
+
+    if (length > 0)
+    {
+        bursts.append(length);
+    }
+
+    return bursts;
+}
+
+qreal cbr::rFactor(qreal delay, qreal lossRatio, qreal burstRatio)
+{
+    // delay impairment as simplified by Cole and Rosenbluth
+    qreal delayImpairment = 0.024 * delay;
+
+    if (delay > 177.3)
+    {
+        delayImpairment += 0.11 * (delay - 177.3);
+    }
+
+    qreal loss = lossRatio * 100;
+    qreal effectiveImpairment = equipmentImpairment + (95 - equipmentImpairment) * loss /
+                                (loss / qMax(burstRatio, (qreal)1) + packetLossRobustness);
+
+    return maxRFactor - delayImpairment - effectiveImpairment;
+}
+
+qreal cbr::mos(qreal rFactor)
+{
+    if (rFactor <= 0)
+    {
+        return 1;
+    }
+    else if (rFactor >= 100)
+    {
+        return 4.5;
+    }
+
+    return 1 + 0.035 * rFactor + rFactor * (rFactor - 60) * (100 - rFactor) * 0.000007;
+}
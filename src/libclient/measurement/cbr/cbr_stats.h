@@ -0,0 +1,37 @@
+#ifndef CBR_STATS_H
+#define CBR_STATS_H
+
+#include <QtGlobal>
+#include <QVector>
+
+namespace cbr
+{
+    // interarrival jitter estimator of RFC 3550 (A.8)
+    class JitterEstimator
+    {
+    public:
+        JitterEstimator();
+
+        // transit time of a packet in ns: arrival minus send time, the
+        // offset between the clocks does not matter
+        void add(qint64 transit);
+        qreal jitter() const;
+        qreal maxJitter() const;
+
+    private:
+        bool m_first;
+        qint64 m_lastTransit;
+        qreal m_jitter;
+        qreal m_maxJitter;
+    };
+
+    // lengths of the runs of lost packets
+    QVector<int> burstLengths(const QVector<bool> &received);
+
+    // E-model (ITU-T G.107) for G.711 with packet loss concealment; delay
+    // is the one-way delay in ms, burstRatio 1 for random loss
+    qreal rFactor(qreal delay, qreal lossRatio, qreal burstRatio);
+    qreal mos(qreal rFactor);
+}
+
+#endif // CBR_STATS_H
@@ -1,24 +1,54 @@
 #include "httpdownload.h"
 #include "../../log/logger.h"
 #include "types.h"
+#include "../statistics.h"
 
-#include <QtMath>
-#include <numeric>
+#ifndef QT_NO_SSL
+#include <QSslSocket>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/socket.h>
+#endif
 
 LOGGER(HTTPDownload);
 
-DownloadThread::DownloadThread (const QUrl &url, const QHostInfo &server, int targetTimeMs, bool cacheTest, QObject *parent)
+namespace
+{
+    //the received data is not needed, all connections read into this
+    //buffer as they all run in the same thread
+    char readBuffer[65536];
+}
+
+DownloadConnection::DownloadConnection(const QUrl &url, const QHostInfo &server, int targetTimeMs, int rampUpTimeMs,
+                                       int slotLengthMs, bool cacheTest, QObject *parent)
 : QObject(parent)
 , url(url)
 , server(server)
 , targetTime(targetTimeMs)
 , avoidCaches(cacheTest)
 , socket(NULL)
-, tStatus(Inactive)
+, cStatus(Inactive)
+, timeToFirstByte(0)
+, connectedAt(0)
+, encryptedAt(0)
+, requestStartAt(0)
+, requestWrittenAt(0)
+, firstByteAt(0)
+, headersAt(0)
+, bodyEndAt(0)
+, requestBytes(0)
+, receivedBytes(0)
+//the first byte may take until its timeout, the download is stopped
+//ramp-up plus target time after the last connection got its first byte
+, samples((qint64)slotLengthMs * 1000000 / binsPerSlot,
+          (qint64)(2 * firstByteReceivedTimeout + rampUpTimeMs + targetTimeMs) * 1000000)
 {
+    timeoutTimer.setSingleShot(true);
+    connect(&timeoutTimer, &QTimer::timeout, this, &DownloadConnection::timeout);
 }
 
-DownloadThread::~DownloadThread()
+DownloadConnection::~DownloadConnection()
 {
     //socket needs to be deleted
     if (socket != NULL)
@@ -34,87 +64,214 @@ DownloadThread::~DownloadThread()
     }
 }
 
-DownloadThread::DownloadThreadStatus DownloadThread::threadStatus() const
+DownloadConnection::DownloadConnectionStatus DownloadConnection::connectionStatus() const
 {
-    return tStatus;
+    return cStatus;
 }
 
-qint64 DownloadThread::timeToFirstByteInNs() const
+qint64 DownloadConnection::timeToFirstByteInNs() const
 {
     return timeToFirstByte;
 }
 
-qint64 DownloadThread::startTimeInNs() const
+int DownloadConnection::httpStatus() const
+{
+    return response.statusCode();
+}
+
+QVariantMap DownloadConnection::phaseTimes() const
+{
+    QVariantMap phases;
+    phases.insert("connect_ns", connectedAt);
+    phases.insert("tls_ns", encryptedAt ? encryptedAt - connectedAt : 0);
+    phases.insert("request_ns", requestWrittenAt ? requestWrittenAt - requestStartAt : 0);
+    phases.insert("first_byte_ns", firstByteAt && requestWrittenAt ? qMax(firstByteAt - requestWrittenAt, (qint64)0) : 0);
+    phases.insert("headers_ns", headersAt ? headersAt - firstByteAt : 0);
+    //downloads are usually stopped before the body ended
+    phases.insert("body_ns", bodyEndAt ? bodyEndAt - headersAt : 0);
+    return phases;
+}
+
+bool DownloadConnection::isEncrypted() const
+{
+    return url.scheme().compare("https", Qt::CaseInsensitive) == 0;
+}
+
+qint64 DownloadConnection::startTimeInNs() const
 {
     return startTime.toMSecsSinceEpoch() * 1000000;
 }
 
-qint64 DownloadThread::endTimeInNs() const
+qint64 DownloadConnection::endTimeInNs() const
+{
+    return startTime.toMSecsSinceEpoch() * 1000000 + samples.lastTime();
+}
+
+qint64 DownloadConnection::runTimeInNs() const
 {
-    return startTime.toMSecsSinceEpoch() * 1000000 + timeIntervals.last();
+    return samples.lastTime();
 }
 
-qint64 DownloadThread::runTimeInNs() const
+qint64 DownloadConnection::bytesReceived() const
 {
-    return timeIntervals.last();
+    return receivedBytes;
 }
 
-void DownloadThread::startTCPConnection()
+void DownloadConnection::startTCPConnection()
 {
-    //each Thread is supposed to first build up the TCP connection,
-    //emit the connected signal, and only when all threads have connected
+    //each connection is supposed to first build up the TCP connection,
+    //emit the connected signal, and only when all connections are up
     //do the actual download (coordinated by HTTPDownload)
 
     //shouldn't happen, check anyway
     if (server.addresses().isEmpty() || (!url.isValid()))
     {
         //invoke the connection tracking code
-        tStatus = FinishedError;
+        cStatus = FinishedError;
         emit TCPConnected(false);
         return;
     }
 
-    socket = new QTcpSocket();
+#ifndef QT_NO_SSL
+    if (isEncrypted())
+    {
+        QSslSocket *sslSocket = new QSslSocket();
+        sslSocket->setPeerVerifyName(url.host());
+        connect(sslSocket, &QSslSocket::encrypted, this, &DownloadConnection::encrypted);
+        socket = sslSocket;
+    }
+    else
+#endif
+    {
+        socket = new QTcpSocket();
 
-    //so let's connect now (if no port as part of the URL use 80 as default)
-    socket->connectToHost(server.addresses().first(), url.port(defaultPort));
+#if defined(Q_OS_LINUX)
+        //read() discards the body in the kernel, the socket only needs to
+        //buffer the response header
+        socket->setReadBufferSize(4096);
+#endif
+    }
+
+    connect(socket, &QTcpSocket::connected, this, &DownloadConnection::connected);
+    connect(socket, &QTcpSocket::bytesWritten, this, &DownloadConnection::requestWritten);
+    connect(socket, &QTcpSocket::disconnected, this, &DownloadConnection::disconnected);
+    connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError(QAbstractSocket::SocketError)));
+    connect(socket, &QTcpSocket::readyRead, this, &DownloadConnection::read);
 
-    tStatus = ConnectingTCP;
+    cStatus = ConnectingTCP;
+    phaseTimer.start();
 
-    //wait for up to 5 seconds for a successful connection
-    if (socket->waitForConnected(tcpConnectTimeout))
+    //so let's connect now (if no port as part of the URL use 80 or 443)
+    socket->connectToHost(server.addresses().first(), url.port(isEncrypted() ? defaultTlsPort : defaultPort));
+
+    //wait for up to 5 seconds for a successful connection (and handshake)
+    timeoutTimer.start(tcpConnectTimeout);
+}
+
+void DownloadConnection::connected()
+{
+    connectedAt = phaseTimer.nsecsElapsed();
+
+#ifndef QT_NO_SSL
+    if (isEncrypted())
     {
-        //for the successfully connected sockets, we should track the disconnection
-        connect(socket, &QTcpSocket::disconnected, this, &DownloadThread::disconnectionHandling);
-        tStatus = ConnectedTCP;
-        emit TCPConnected(true);
+        //certificate errors fail the handshake and end up in socketError()
+        static_cast<QSslSocket *>(socket)->startClientEncryption();
+        return;
+    }
+#endif
+
+    timeoutTimer.stop();
+    cStatus = ConnectedTCP;
+    emit TCPConnected(true);
+}
+
+void DownloadConnection::encrypted()
+{
+    encryptedAt = phaseTimer.nsecsElapsed();
+    timeoutTimer.stop();
+    cStatus = ConnectedTCP;
+    emit TCPConnected(true);
+}
+
+void DownloadConnection::requestWritten(qint64 bytes)
+{
+    requestBytes -= bytes;
+
+    if (requestBytes <= 0 && requestWrittenAt == 0)
+    {
+        requestWrittenAt = phaseTimer.nsecsElapsed();
+    }
+}
+
+void DownloadConnection::disconnected()
+{
+    // handling premature TCP disconnects, a body without a length ends here
+    if (cStatus == DownloadInProgress)
+    {
+        if (response.state() == HttpResponseParser::Body && response.contentLength() < 0)
+        {
+            bodyEndAt = phaseTimer.nsecsElapsed();
+        }
+
+        cStatus = FinishedSuccess;
+        emit TCPDisconnected();
     }
     else
     {
-        //something went wrong
-        tStatus = FinishedError;
-        emit TCPConnected(false);
-        socket->close();
+        fail();
     }
 }
 
-void DownloadThread::disconnectionHandling()
+void DownloadConnection::socketError(QAbstractSocket::SocketError socketError)
 {
-    // handling premature TCP disconnects
-    if(tStatus == DownloadInProgress)
+    //the server closing the connection is handled by disconnected()
+    if (socketError != QAbstractSocket::RemoteHostClosedError)
     {
-        tStatus = FinishedSuccess;
+        fail();
+    }
+}
+
+void DownloadConnection::timeout()
+{
+    fail();
+}
+
+//reports the failure to whoever waits for this connection
+void DownloadConnection::fail()
+{
+    switch (cStatus)
+    {
+    case ConnectingTCP:
+        cStatus = FinishedError;
+        socket->abort();
+        emit TCPConnected(false);
+        break;
+
+    case AwaitingFirstByte:
+        cStatus = FinishedError;
+        socket->abort();
+        emit firstByteReceived(false);
+        break;
+
+    case DownloadInProgress:
+        //keep what was measured until the error
+        cStatus = FinishedSuccess;
         emit TCPDisconnected();
+        break;
+
+    default:
+        break;
     }
 }
 
-void DownloadThread::startDownload()
+void DownloadConnection::startDownload()
 {
-    //we can only download, if this thread sucessfully established the
-    //TCP connection (all threads will receive the signal)
-    if(socket->state() != QAbstractSocket::ConnectedState)
+    //we can only download, if this connection sucessfully established the
+    //TCP connection (all connections are told to start)
+    if (cStatus != ConnectedTCP)
     {
-        tStatus = FinishedError;
+        cStatus = FinishedError;
         emit firstByteReceived(false);
         return;
     }
@@ -131,152 +288,156 @@ void DownloadThread::startDownload()
                               "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10.9; rv:31.0) Gecko/20100101 Firefox/31.0\r\n"
                               "Referer: http://www.measure-it.net\r\n\r\n").arg(path).arg(url.host());
 
-    qint64 bytesWritten = 0;
-
     //log actual time of start
     startTime = QDateTime::currentDateTime();
+    requestStartAt = phaseTimer.nsecsElapsed();
+    requestBytes = request.length();
 
-    //send the HTTP GET
-    while(bytesWritten < request.length())
+    //send the HTTP GET, the socket buffers what can not be sent right away
+    if (socket->write(request.toLatin1()) < 0)
     {
-        qint64 writeResult = socket->write(request.mid(bytesWritten).toLatin1());
-
-        //on error
-        if(writeResult < 0)
-        {
-            socket->close();
-            tStatus = FinishedError;
-            emit firstByteReceived(false);
-            return;
-        }
-
-        bytesWritten += writeResult;
+        cStatus = FinishedError;
+        socket->abort();
+        emit firstByteReceived(false);
+        return;
     }
 
     //start eplapsed timer for calculating the time slots
     measurementTimer.start();
 
-    tStatus = AwaitingFirstByte;
+    cStatus = AwaitingFirstByte;
+
+    //time-out if the response header is not arriving
+    timeoutTimer.start(firstByteReceivedTimeout);
+}
 
-    //do a blocking read for the first bytes or time-out if nothing is arriving
-    if (socket->waitForReadyRead(firstByteReceivedTimeout))
+void DownloadConnection::read()
+{
+    if (cStatus != AwaitingFirstByte && cStatus != DownloadInProgress)
     {
-        //TODO: check for HTTP status code and act intelligently on it
-        //currently, a 404 etc. is simply to little data
-        //to generate results, but a better checking would be great
+        return;
+    }
+
+    if (firstByteAt == 0)
+    {
+        firstByteAt = phaseTimer.nsecsElapsed();
         timeToFirstByte = measurementTimer.nsecsElapsed();
-        tStatus = DownloadInProgress;
-        //connect readyRead of the socket with read() for further reads
-        connect(socket, &QTcpSocket::readyRead, this, &DownloadThread::read);
-        //call read
-        read();
-        emit firstByteReceived(true);
     }
-    else
+
+    qint64 bytes = 0;
+    qint64 n;
+
+    //the header is parsed, of the body only its framing
+    while ((n = socket->read(readBuffer, sizeof(readBuffer))) > 0)
     {
-        tStatus = FinishedError;
-        socket->close();
-        emit firstByteReceived(false);
+        bytes += n;
+        response.feed(readBuffer, n);
     }
-}
 
-void DownloadThread::read()
-{
-    bytesReceived << socket->bytesAvailable();
-    timeIntervals << measurementTimer.nsecsElapsed();
+#if defined(Q_OS_LINUX)
+    //for TCP MSG_TRUNC drops the body without copying it anywhere, but
+    //never beyond the current chunk whose end has to be parsed
+    qint64 skippable;
+    ssize_t discarded;
 
-    socket->readAll();   //we don't need the actual data but need to free space in the
-                         //socket buffer
-}
+    while (!isEncrypted() && (skippable = response.skippable()) != 0)
+    {
+        discarded = ::recv(socket->socketDescriptor(), NULL, skippable < 0 ? 1 << 20 : qMin(skippable, (qint64)1 << 20),
+                           MSG_TRUNC | MSG_DONTWAIT);
 
-qreal DownloadThread::averageThroughput(qint64 sTime, qint64 eTime) const
-{
-    int i = 0;
+        if (discarded <= 0)
+        {
+            break;
+        }
 
-    qint64 bytes = 0;
+        bytes += discarded;
+        response.skip(discarded);
+    }
+#endif
 
-    qint64 begin = sTime - startTimeInNs();
-    qint64 end = eTime - startTimeInNs();
+    samples.add(measurementTimer.nsecsElapsed(), bytes);
+    receivedBytes += bytes;
 
-    int startSlot = -1;
-    int endSlot = -1;
+    if (headersAt == 0 && response.headersComplete())
+    {
+        headersAt = phaseTimer.nsecsElapsed();
+    }
 
-    for (i = 0; i < timeIntervals.size(); i++)
+    if (response.state() == HttpResponseParser::Error)
     {
-        //start after "begin"
-        if (timeIntervals[i] < begin)
-        {
-            continue;
-        }
+        LOG_WARNING(QString("Malformed HTTP response from %1").arg(url.host()));
+        fail();
+        return;
+    }
 
-        if (startSlot < 0)
+    if (cStatus == AwaitingFirstByte)
+    {
+        if (!response.headersComplete())
         {
-            startSlot = i;
+            return;
         }
 
-        if (timeIntervals[i] > end)
+        timeoutTimer.stop();
+
+        //a 404 or the like is not what we wanted to measure
+        if (response.statusCode() < 200 || response.statusCode() >= 300)
         {
-            break;
+            LOG_WARNING(QString("HTTP status %1 from %2").arg(response.statusCode()).arg(url.host()));
+            cStatus = FinishedError;
+            socket->abort();
+            emit firstByteReceived(false);
+            return;
         }
 
-        endSlot = i;
-
-        bytes += bytesReceived[i];
+        cStatus = DownloadInProgress;
+        emit firstByteReceived(true);
     }
 
-    if (endSlot < 0 || startSlot < 0)
+    if (response.isComplete())
     {
-        //this should only happen is we have a wrong time window
-        return 0.0;
+        bodyEndAt = phaseTimer.nsecsElapsed();
+        cStatus = FinishedSuccess;
+        emit TCPDisconnected();
     }
-
-    return (8.0 * (qreal)bytes)/(((qreal)(timeIntervals[endSlot] - timeIntervals[startSlot]))/1000000000.0);
 }
 
-QList<qreal> DownloadThread::measurementSlots(int slotLength) const
+qreal DownloadConnection::averageThroughput(qint64 sTime, qint64 eTime) const
 {
-    int i = 0;
-
-    QList<qreal> slotList;
+    return samples.averageThroughput(sTime - startTimeInNs(), eTime - startTimeInNs());
+}
 
-    int bytes = 0;
-    qint64 currentSlotTime = slotLength * 1000000;
-    int lastSlot = 0;
+QList<qreal> DownloadConnection::measurementSlots(int slotLength) const
+{
+    return samples.throughputSlots((qint64)slotLength * 1000000);
+}
 
-    for (i = 0; i < timeIntervals.size(); i++)
+void DownloadConnection::sampleTcpInfo()
+{
+    if (cStatus == DownloadInProgress)
     {
-        if (timeIntervals[i] > currentSlotTime && i != 0)
-        {
-            slotList << ((qreal)bytes * 8) / ((timeIntervals[i-1] - timeIntervals[lastSlot])/1000000000.0);
-
-            bytes = bytesReceived[i];
-            currentSlotTime += slotLength * 1000000;
-            if (timeIntervals[i] > currentSlotTime)
-            {
-                currentSlotTime = timeIntervals[i];
-            }
-            lastSlot = i - 1;
-        }
-        else
-        {
-            bytes += bytesReceived[i];
-        }
+        tcpInfo.sample(socket, measurementTimer.nsecsElapsed());
     }
+}
 
-    return slotList;
+const TcpInfoSeries &DownloadConnection::tcpInfoSeries() const
+{
+    return tcpInfo;
 }
 
-void DownloadThread::stopDownload()
+void DownloadConnection::stopDownload()
 {
-    if (tStatus == DownloadInProgress)
+    timeoutTimer.stop();
+
+    if (cStatus == DownloadInProgress)
     {
-        tStatus = FinishedSuccess;
+        cStatus = FinishedSuccess;
     }
 
     //stop download and clean-up
-    if (socket->state() != QAbstractSocket::ConnectedState)
+    if (socket != NULL)
     {
-        socket->close();
+        socket->disconnect(this);
+        socket->abort();
     }
 }
 
@@ -287,6 +448,14 @@ HTTPDownload::HTTPDownload(QObject *parent)
 : Measurement(parent)
 , currentStatus(HTTPDownload::Unknown)
 , overallBandwidth(0.0)
+, rampUpTime(0)
+, measurementTime(0)
+, rampedUp(false)
+, lastSlotTime(0)
+, lastSlotBytes(0)
+, lastSlotThroughput(0.0)
+, steadySlots(0)
+, lookupTime(0)
 , connectedThreads(0)
 , unconnectedThreads(0)
 , downloadingThreads(0)
@@ -295,12 +464,16 @@ HTTPDownload::HTTPDownload(QObject *parent)
 {
     connect(this, SIGNAL(error(const QString &)), this,
             SLOT(setErrorString(const QString &)));
+
+    downloadTimer.setSingleShot(true);
+    connect(&downloadTimer, &QTimer::timeout, this, &HTTPDownload::downloadFinished);
+    connect(&slotTimer, &QTimer::timeout, this, &HTTPDownload::measureSlot);
+    connect(&tcpInfoTimer, &QTimer::timeout, this, &HTTPDownload::sampleTcpInfo);
 }
 
 HTTPDownload::~HTTPDownload()
 {
-    //deleting workers not needed - done by deleteLater already
-    qDeleteAll(threads);
+    qDeleteAll(workers);
 }
 
 Measurement::Status HTTPDownload::status() const
@@ -346,6 +519,19 @@ bool HTTPDownload::prepare(NetworkManager *networkManager,
         return false;
     }
 
+    if (definition->adaptive && (definition->tolerance <= 0.0 || definition->tolerance >= 1.0))
+    {
+        setErrorString("requested tolerance wrong");
+        return false;
+    }
+
+    if (definition->tcpInfoInterval < 0 ||
+        (definition->tcpInfoInterval > 0 && definition->tcpInfoInterval < TcpInfoSeries::minInterval))
+    {
+        setErrorString("requested TCP_INFO interval wrong");
+        return false;
+    }
+
     //set the URL to be used by all threads
     //use a QUrl object to have its convenience functions at hand later
     //do not use setUrl! will not produce proper results e.g. for www.domain-name.tld etc.
@@ -357,6 +543,20 @@ bool HTTPDownload::prepare(NetworkManager *networkManager,
         return false;
     }
 
+    if (requestUrl.scheme().compare("https", Qt::CaseInsensitive) == 0)
+    {
+#ifdef QT_NO_SSL
+        setErrorString("https is not supported");
+        return false;
+#else
+        if (!QSslSocket::supportsSsl())
+        {
+            setErrorString("https is not supported");
+            return false;
+        }
+#endif
+    }
+
     return true;
 }
 
@@ -367,17 +567,20 @@ bool HTTPDownload::start()
 
     //TODO: add a timer to check wheather this has actually gone through or not
 
-    //when the lookup finishes, we want to call the startThreads() function
-    //that starts the actual measurement/threads 
+    //when the lookup finishes, we want to call the startConnections()
+    //function that starts the actual measurement
 
-    QHostInfo::lookupHost(requestUrl.host(), this, SLOT(startThreads(QHostInfo)));
+    lookupTimer.start();
+    QHostInfo::lookupHost(requestUrl.host(), this, SLOT(startConnections(QHostInfo)));
 
     return true;
 }
 
 //this function starts the actual measurement
-bool HTTPDownload::startThreads(const QHostInfo &server)
+bool HTTPDownload::startConnections(const QHostInfo &server)
 {
+    lookupTime = lookupTimer.nsecsElapsed();
+
     //check if the name resolution was actually successful
     if (server.error() != QHostInfo::NoError)
     {
@@ -387,46 +590,30 @@ bool HTTPDownload::startThreads(const QHostInfo &server)
 
     int n = 0;
 
-    //start all threads
     for(n = 0; n < definition->threads; n++)
     {
-        //create a worker thread that starts an actual download
-        DownloadThread *worker = new DownloadThread(requestUrl, server, definition->targetTime, definition->avoidCaches);
-        QThread *workerThread = new QThread();
+        DownloadConnection *worker = new DownloadConnection(requestUrl, server, definition->targetTime, definition->rampUpTime,
+                                                            definition->slotLength, definition->avoidCaches);
 
-        //store the references to the threads/workers
         workers.append(worker);
-        threads.append(workerThread);
 
-        //move the worker to its own thread context
-        worker->moveToThread(workerThread);
+        //this signal is for tracking the TCP connection state of the workers
+        connect(worker, &DownloadConnection::TCPConnected, this, &HTTPDownload::TCPConnectionTracking);
 
-        //when the thread finishes, do some cleanup
-        connect(workerThread, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &DownloadConnection::firstByteReceived, this, &HTTPDownload::downloadStartedTracking);
 
-        //this signal tells a worker thread to initiate the TCP 3-way handshake
-        connect(this, &HTTPDownload::connectTCP, worker, &DownloadThread::startTCPConnection);
-
-        //this signal is for the this thread of execution to track the TCP connection state
-        //of the worker threads
-        connect(worker, &DownloadThread::TCPConnected, this, &HTTPDownload::TCPConnectionTracking);
-
-        //this signal tells the threads to start the actual download
-        connect(this, &HTTPDownload::startDownload, worker, &DownloadThread::startDownload);
-
-        connect(worker, &DownloadThread::firstByteReceived, this, &HTTPDownload::downloadStartedTracking);
-
-        connect(worker, &DownloadThread::TCPDisconnected, this, &HTTPDownload::prematureDisconnectedTracking);
-
-        //start the thread
-        workerThread->start();
+        connect(worker, &DownloadConnection::TCPDisconnected, this, &HTTPDownload::prematureDisconnectedTracking);
     }
 
     //now the actual measurement starts
     setStatus(HTTPDownload::Running);
 
-    //tell the threads to do the 3way-handshake
-    emit connectTCP();
+    //tell the workers to do the 3way-handshake, a worker which fails right
+    //away reports it before the loop is done
+    foreach (DownloadConnection *worker, workers)
+    {
+        worker->startTCPConnection();
+    }
 
     return true;
 }
@@ -438,6 +625,7 @@ void HTTPDownload::prematureDisconnectedTracking()
 
     if (finishedThreads == connectedThreads)
     {
+        stopReason = "connections_closed";
         downloadFinished();
     }
 }
@@ -466,7 +654,10 @@ void HTTPDownload::TCPConnectionTracking(bool success)
             return;
         }
 
-        emit startDownload();
+        foreach (DownloadConnection *worker, workers)
+        {
+            worker->startDownload();
+        }
     }
 }
 
@@ -493,45 +684,169 @@ void HTTPDownload::downloadStartedTracking(bool success)
             return;
         }
 
+        transferTimer.start();
+
+        if (definition->tcpInfoInterval > 0 && TcpInfoSeries::isSupported())
+        {
+            sampleTcpInfo();
+            tcpInfoTimer.start(definition->tcpInfoInterval);
+        }
+
+        if (definition->adaptive)
+        {
+            //measureSlot() decides when the ramp-up is over and when to stop
+            foreach (DownloadConnection *worker, workers)
+            {
+                lastSlotBytes += worker->bytesReceived();
+            }
+
+            slotTimer.start(definition->slotLength);
+            return;
+        }
+
+        rampUpTime = (qint64)definition->rampUpTime * 1000000;
         downloadStartTime = QDateTime::currentDateTime().addMSecs(definition->rampUpTime);
         //when this timer fires we stop all downloads
-        downloadTimer.singleShot(definition->targetTime + definition->rampUpTime, this, SLOT(downloadFinished()));
+        downloadTimer.start(definition->targetTime + definition->rampUpTime);
     }
 }
 
+//one slot of the adaptive mode, first wait for the throughput of all
+//connections together to stop growing, then for its mean to converge
+void HTTPDownload::measureSlot()
+{
+    qint64 now = transferTimer.nsecsElapsed();
+    qint64 bytes = 0;
+
+    foreach (DownloadConnection *worker, workers)
+    {
+        bytes += worker->bytesReceived();
+    }
+
+    if (now <= lastSlotTime)
+    {
+        return;
+    }
+
+    qreal throughput = (bytes - lastSlotBytes) * 8.0 * 1000000000 / (now - lastSlotTime);
+    lastSlotTime = now;
+    lastSlotBytes = bytes;
+
+    if (!rampedUp)
+    {
+        //slow start doubles the window every round trip, once that is over
+        //the throughput only grows slowly if at all
+        if (lastSlotThroughput > 0 && throughput < lastSlotThroughput * (100 + maxRampUpGrowth) / 100)
+        {
+            steadySlots++;
+        }
+        else
+        {
+            steadySlots = 0;
+        }
+
+        lastSlotThroughput = throughput;
+
+        if (steadySlots >= rampUpSlots || now >= (qint64)definition->rampUpTime * 1000000)
+        {
+            rampedUp = true;
+            rampUpTime = now;
+            downloadStartTime = QDateTime::currentDateTime();
+            downloadTimer.start(definition->targetTime);
+
+            LOG_DEBUG(QString("Ramp-up over after %1 ms").arg(rampUpTime / 1000000));
+        }
+
+        return;
+    }
+
+    slotStatistics.add(throughput);
+
+    if (slotStatistics.count() < (quint64)minConvergenceSlots || slotStatistics.mean() <= 0 ||
+        now - rampUpTime < (qint64)minTargetTime * 1000000)
+    {
+        return;
+    }
+
+    //Statistics reports the population deviation, the interval needs the
+    //sample one
+    quint64 n = slotStatistics.count();
+    qreal halfWidth = tQuantile(n - 1) * slotStatistics.stdev() * qSqrt((qreal)n / (n - 1)) / qSqrt(n);
+
+    if (halfWidth <= definition->tolerance * slotStatistics.mean())
+    {
+        measurementTime = now - rampUpTime;
+        stopReason = "converged";
+        downloadFinished();
+    }
+}
+
+void HTTPDownload::sampleTcpInfo()
+{
+    foreach (DownloadConnection *worker, workers)
+    {
+        worker->sampleTcpInfo();
+    }
+}
+
+qreal HTTPDownload::tQuantile(quint64 degreesOfFreedom)
+{
+    static const qreal quantiles[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+    if (degreesOfFreedom == 0)
+    {
+        return quantiles[0];
+    }
+
+    if (degreesOfFreedom > sizeof(quantiles) / sizeof(quantiles[0]))
+    {
+        return 1.96;
+    }
+
+    return quantiles[degreesOfFreedom - 1];
+}
+
 void HTTPDownload::downloadFinished()
 {
     bool resultsOK = false;
 
-    //stop the timer if still running (e.g. the case if all
+    if (currentStatus == HTTPDownload::Finished)
+    {
+        return;
+    }
+
+    //stop the timers if still running (e.g. the case if all
     //threads stop prematurely)
-    if(downloadTimer.isActive())
+    downloadTimer.stop();
+    slotTimer.stop();
+    tcpInfoTimer.stop();
+
+    if (stopReason.isEmpty())
     {
-        downloadTimer.stop();
+        stopReason = "target_time";
+    }
+
+    //only a converged download was measured for less than the target time
+    if (measurementTime == 0)
+    {
+        measurementTime = (qint64)definition->targetTime * 1000000;
     }
 
     setStatus(HTTPDownload::Finished);
 
     int i = 0;
-    //stop all threads downloading data
+    //stop all connections downloading data
     for(i = 0; i < workers.size(); i++)
     {
-        //won't need signals from threads anymore
-        workers[i]->disconnect();
+        //won't need signals from the connections anymore
+        workers[i]->disconnect(this);
         workers[i]->stopDownload();
     }
 
     resultsOK = calculateResults();
 
-    //clean up (threads etc.) before emitting finished,
-    //otherwise this thing can become deleted before the
-    //contained threads
-    for (i = 0; i < threads.size(); i++)
-    {
-        threads[i]->quit();
-        threads[i]->wait();
-    }
-
     if(resultsOK)
     {
         emit finished();
@@ -554,7 +869,7 @@ bool HTTPDownload::resultsTrustable()
 
     for (i = 0; i < workers.size(); i++)
     {
-        if(workers[i]->threadStatus() != DownloadThread::FinishedSuccess)
+        if(workers[i]->connectionStatus() != DownloadConnection::FinishedSuccess)
         {
             unfinishedThreads++;
             continue;
@@ -564,7 +879,7 @@ bool HTTPDownload::resultsTrustable()
         //75% of the target time, we assume the measure
         if(workers[i]->runTimeInNs() - \
                 (downloadStartTime.toMSecsSinceEpoch() * 1000000 - workers[i]->startTimeInNs())
-                < (((double)definition->targetTime * 1000000) * 0.75))
+                < measurementTime * 0.75)
         {
            return false;
         }
@@ -586,12 +901,22 @@ bool HTTPDownload::calculateResults()
 {
     QVariantList threadResults;
     int num_threads = 0;
+    int httpErrors = 0;
+    qint64 bytesReceived = 0;
     bool resultsOK = resultsTrustable();
 
     for(int i = 0; i < workers.size(); i++)
     {
+        int status = workers[i]->httpStatus();
+        bytesReceived += workers[i]->bytesReceived();
+
+        if (status != 0 && (status < 200 || status >= 300))
+        {
+            httpErrors++;
+        }
+
         //only consider threads that finished successfully
-        if(workers[i]->threadStatus() != DownloadThread::FinishedSuccess)
+        if(workers[i]->connectionStatus() != DownloadConnection::FinishedSuccess)
         {
             continue;
         }
@@ -600,32 +925,34 @@ bool HTTPDownload::calculateResults()
 
         QVariantMap thread;
         qreal avg = workers[i]->averageThroughput(downloadStartTime.toMSecsSinceEpoch() * 1000000, \
-                                                  downloadStartTime.toMSecsSinceEpoch() * 1000000 + \
-                                                  ((qint64) (definition->targetTime)) * 1000000);
+                                                  downloadStartTime.toMSecsSinceEpoch() * 1000000 + measurementTime);
         thread.insert("avg", avg);
         overallBandwidth += avg;
 
         QList<qreal> measurementSlots = workers[i]->measurementSlots(definition->slotLength);
 
-        // get max and min
-        QList<qreal>::const_iterator it = std::max_element(measurementSlots.begin(), measurementSlots.end());
-        qreal max = *it;
-        thread.insert("max", max);
-        it = std::min_element(measurementSlots.begin(), measurementSlots.end());
-        qreal min = *it;
-        thread.insert("min", min);
-
-        qreal sq_sum = std::inner_product(measurementSlots.begin(), measurementSlots.end(), measurementSlots.begin(), 0.0);
-        qreal stdev = 0.0;
+        Statistics slotStatistics;
 
-        if (measurementSlots.size() > 0)
+        foreach (qreal slot, measurementSlots)
         {
-            // calculate standard deviation
-            stdev = qSqrt(sq_sum / measurementSlots.size() - avg * avg);
-            thread.insert("stdev", stdev);
+            slotStatistics.add(slot);
         }
 
+        thread.insert("max", slotStatistics.max());
+        thread.insert("min", slotStatistics.min());
+        thread.insert("stdev", slotStatistics.stdev());
+        thread.insert("p50", slotStatistics.quantile(0.5));
+        thread.insert("p90", slotStatistics.quantile(0.9));
+        thread.insert("p99", slotStatistics.quantile(0.99));
+
         thread.insert("slots", listToVariant(measurementSlots));
+        thread.insert("http_status", status);
+        thread.insert("phases", workers[i]->phaseTimes());
+
+        if (!workers[i]->tcpInfoSeries().isEmpty())
+        {
+            thread.insert("tcp_info", workers[i]->tcpInfoSeries().toVariant());
+        }
 
         threadResults.append(thread);
     }
@@ -634,6 +961,25 @@ bool HTTPDownload::calculateResults()
     results.insert("results_ok", resultsOK);
     results.insert("bandwidth_bps_avg", overallBandwidth);
     results.insert("bandwidth_bps_per_thread", threadResults);
+    results.insert("dns_ns", lookupTime);
+    results.insert("http_errors", httpErrors);
+
+    //what stopping early saved compared to a download running for the
+    //whole ramp-up and target time at the measured bandwidth
+    qint64 plannedTime = ((qint64)definition->rampUpTime + definition->targetTime) * 1000000;
+    qint64 bytesSaved = 0;
+
+    if (stopReason == "converged" && transferTimer.isValid())
+    {
+        bytesSaved = qMax(plannedTime - transferTimer.nsecsElapsed(), (qint64)0) / 1000000000.0 * overallBandwidth / 8;
+    }
+
+    results.insert("adaptive", definition->adaptive);
+    results.insert("stop_reason", stopReason);
+    results.insert("ramp_up_ns", rampUpTime);
+    results.insert("measurement_ns", measurementTime);
+    results.insert("bytes_received", bytesReceived);
+    results.insert("bytes_saved", bytesSaved);
 
     return true;
 }
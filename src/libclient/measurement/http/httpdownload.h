@@ -3,22 +3,27 @@
 
 #include "../measurement.h"
 #include "httpdownload_definition.h"
+#include "samplering.h"
+#include "httpresponseparser.h"
+#include "../statistics.h"
+#include "../../network/tcpinfo.h"
 
 #include <QElapsedTimer>
 #include <QHostInfo>
 #include <QUrl>
 #include <QList>
-#include <QThread>
 #include <QTimer>
 #include <QTcpSocket>
 
 
-class DownloadThread : public QObject
+// one HTTP download, driven by the signals of a non-blocking socket so any
+// number of them share the thread of the measurement
+class DownloadConnection : public QObject
 {
     Q_OBJECT
 
 public:
-    enum DownloadThreadStatus
+    enum DownloadConnectionStatus
     {
         Inactive,
         ConnectingTCP,
@@ -29,20 +34,35 @@ public:
         FinishedError
     };
 
-    DownloadThread (const QUrl &url, const QHostInfo &server, int targetTimeMs = 10000, bool avoidCaches = false, QObject *parent = 0);
-    ~DownloadThread();
+    DownloadConnection(const QUrl &url, const QHostInfo &server, int targetTimeMs = 10000, int rampUpTimeMs = 1000,
+                       int slotLengthMs = 250, bool avoidCaches = false, QObject *parent = 0);
+    ~DownloadConnection();
 
-    DownloadThreadStatus threadStatus() const;
+    DownloadConnectionStatus connectionStatus() const;
 
     qint64 timeToFirstByteInNs() const;
+    //0 if no status line was received
+    int httpStatus() const;
+    //duration of each phase of the download in ns, 0 for phases which
+    //were not reached
+    QVariantMap phaseTimes() const;
     qint64 startTimeInNs() const;
     qint64 endTimeInNs() const;
     qint64 runTimeInNs() const;
+    //bytes received since the request was sent, header included
+    qint64 bytesReceived() const;
 
     qreal averageThroughput(qint64 sTime, qint64 eTime) const; //average througput in bps
     QList<qreal> measurementSlots(int slotLength) const; //slotLength in ms
 
+    //takes a TCP_INFO sample while the download is in progress, the times
+    //are on the same clock as the measurement slots
+    void sampleTcpInfo();
+    const TcpInfoSeries &tcpInfoSeries() const;
+
 private:
+    void fail();
+    bool isEncrypted() const;
 
     //url holds the URL to download from (incl. the port number, default 80)
     QUrl url;
@@ -53,40 +73,65 @@ private:
     //testCaches? true: don't randomize URL, false: randomize URL
     bool avoidCaches;
 
-    //the socket from which to read/write, to be created after moved to thread!
-    //that's why we need a pointer here
     QTcpSocket *socket;
 
     //current status...see enum above
-    DownloadThreadStatus tStatus;
+    DownloadConnectionStatus cStatus;
+
+    //times out the 3-way (and TLS) handshake and the wait for the
+    //response header
+    QTimer timeoutTimer;
 
     //absolute start time of the download
     QDateTime startTime;
-    //absolute end time of the download
-    QDateTime endTime;
     //relative time until the first byte was received
     qint64 timeToFirstByte;
 
     //the measurement Timer for tracking the time slots
     QElapsedTimer measurementTimer;
 
-    //list of bytes received
-    QList<qint64> bytesReceived;
-    //list of times in which the bytes above were received
-    QList<qint64> timeIntervals;
+    //when each phase ended, in ns since the TCP connection was started
+    QElapsedTimer phaseTimer;
+    qint64 connectedAt;
+    qint64 encryptedAt;
+    qint64 requestStartAt;
+    qint64 requestWrittenAt;
+    qint64 firstByteAt;
+    qint64 headersAt;
+    qint64 bodyEndAt;
+
+    HttpResponseParser response;
+    qint64 requestBytes;
+    qint64 receivedBytes;
+
+    //bytes received since the request was sent, sized for the whole
+    //download so reads never allocate
+    SampleRing samples;
+
+    TcpInfoSeries tcpInfo;
 
     //some more or less magic constants used
     //TCP timeout on the 3-way handshake in ms
     static const int tcpConnectTimeout = 5000;
     static const int firstByteReceivedTimeout = 5000;
     static const int defaultPort = 80;
+    static const int defaultTlsPort = 443;
+    //resolution of the samples relative to the slot length
+    static const int binsPerSlot = 10;
 
 public slots:
-    //tells the thread to perform the 3-way handshake
+    //starts the 3-way handshake, TCPConnected() tells how it went
     void startTCPConnection();
-    void disconnectionHandling();
     void startDownload();
     void stopDownload();
+
+private slots:
+    void connected();
+    void encrypted();
+    void requestWritten(qint64 bytes);
+    void disconnected();
+    void socketError(QAbstractSocket::SocketError socketError);
+    void timeout();
     //reads data from the socket whenever there's data ready to be read
     void read();
 
@@ -94,7 +139,6 @@ signals:
     void TCPConnected(bool success);
     void TCPDisconnected();
     void firstByteReceived(bool success);
-    void downloadFinished(bool success);
 };
 
 
@@ -120,14 +164,15 @@ private:
     void setStatus(Status status);
     bool resultsTrustable();
     bool calculateResults();
+    //student's t quantile for a two-sided 95% confidence interval
+    static qreal tQuantile(quint64 degreesOfFreedom);
 
     HTTPDownloadDefinitionPtr definition;
 
     Status currentStatus;
     QUrl requestUrl;
 
-    QList <QThread *> threads;
-    QList <DownloadThread *> workers;
+    QList <DownloadConnection *> workers;
 
     QList <qreal> downloadSpeeds;
     qreal overallBandwidth;
@@ -137,6 +182,34 @@ private:
 
     QDateTime downloadStartTime;
 
+    //runs from the moment all connections got their first byte
+    QElapsedTimer transferTimer;
+    //ramp-up and measurement period as they actually were, in ns
+    qint64 rampUpTime;
+    qint64 measurementTime;
+    //why the download was stopped, reported with the results
+    QString stopReason;
+
+    //adaptive mode, the throughput of all connections together is looked
+    //at once per slot to find the end of the ramp-up and then to stop as
+    //soon as the mean is known well enough
+    QTimer slotTimer;
+    bool rampedUp;
+    qint64 lastSlotTime;
+    qint64 lastSlotBytes;
+    qreal lastSlotThroughput;
+    int steadySlots;
+    Statistics slotStatistics;
+
+    //samples the TCP_INFO of all connections
+    QTimer tcpInfoTimer;
+
+    //time the name resolution took
+    QElapsedTimer lookupTimer;
+    qint64 lookupTime;
+
+    //the definition and the results still speak of threads, each of them
+    //is a connection of the same thread now
     int connectedThreads;   //number of threads that have finished the TCP handshake
     int unconnectedThreads; //number of threads that have _not_ finished the TCP handshake
     int downloadingThreads;
@@ -147,15 +220,23 @@ private:
     //some more or less magic constants
     static const int maxRampUpTime = 10000; //max ramp-up time in milli-seconds for TCP to grow the CWND
     static const int minRampUpTime = 1000;
-    static const int maxThreads = 6;
+    static const int maxThreads = 64;
     static const int minThreads = 1;
     static const int maxTargetTime = 45000; //no download should last longer than that (security reasons)
     static const int minTargetTime = 2000; //so download should be shorter than this, really
     static const int minSlotLength = 250;
+    //the ramp-up is over once the throughput grew less than
+    //maxRampUpGrowth percent for rampUpSlots slots in a row
+    static const int rampUpSlots = 3;
+    static const int maxRampUpGrowth = 10;
+    //slots needed before the confidence interval is trusted
+    static const int minConvergenceSlots = 5;
 
 private slots:
-    bool startThreads(const QHostInfo &server);
+    bool startConnections(const QHostInfo &server);
     void downloadFinished();
+    void measureSlot();
+    void sampleTcpInfo();
 
 public slots:
     void TCPConnectionTracking(bool success);
@@ -164,8 +245,6 @@ public slots:
 
 signals:
     void statusChanged(Status status);
-    void connectTCP();
-    void startDownload();
 };
 
 #endif // HTTPGETREQUEST_H
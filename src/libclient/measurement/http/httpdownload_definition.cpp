@@ -1,13 +1,17 @@
 #include "httpdownload_definition.h"
 
 HTTPDownloadDefinition::HTTPDownloadDefinition(const QString &url, const bool cacheTest, const int threads, \
-                                               const int targetTime, const int rampUpTime, const int slotLength)
+                                               const int targetTime, const int rampUpTime, const int slotLength,
+                                               const bool adaptive, const qreal tolerance, const int tcpInfoInterval)
 : url(url)
 , avoidCaches(cacheTest)
 , threads(threads)
 , targetTime(targetTime)
 , rampUpTime(rampUpTime)
 , slotLength(slotLength)
+, adaptive(adaptive)
+, tolerance(tolerance)
+, tcpInfoInterval(tcpInfoInterval)
 
 {
 
@@ -26,7 +30,10 @@ HTTPDownloadDefinitionPtr HTTPDownloadDefinition::fromVariant(const QVariant &va
                                                                 map.value("threads", 1).toInt(),
                                                                 map.value("target_time", 10000).toInt(),
                                                                 map.value("ramp_up_time", 3000).toInt(),
-                                                                map.value("slot_length", 1000).toInt()));
+                                                                map.value("slot_length", 1000).toInt(),
+                                                                map.value("adaptive", false).toBool(),
+                                                                map.value("tolerance", 0.05).toDouble(),
+                                                                map.value("tcp_info_interval", 0).toInt()));
 }
 
 QVariant HTTPDownloadDefinition::toVariant() const
@@ -38,5 +45,8 @@ QVariant HTTPDownloadDefinition::toVariant() const
     map.insert("target_time", targetTime);
     map.insert("ramp_up_time", rampUpTime);
     map.insert("slot_length", slotLength);
+    map.insert("adaptive", adaptive);
+    map.insert("tolerance", tolerance);
+    map.insert("tcp_info_interval", tcpInfoInterval);
     return map;
 }
@@ -12,7 +12,9 @@ class HTTPDownloadDefinition : public MeasurementDefinition
 {
 public:
     HTTPDownloadDefinition(const QString &url, const bool avoidCaches, const int threads,
-                           const int targetTime, const int rampUpTime, const int slotLength);
+                           const int targetTime, const int rampUpTime, const int slotLength,
+                           const bool adaptive = false, const qreal tolerance = 0.05,
+                           const int tcpInfoInterval = 0);
     ~HTTPDownloadDefinition();
 
     // Storage
@@ -25,6 +27,14 @@ public:
     int targetTime;
     int rampUpTime;
     int slotLength;
+    // stop once the ramp-up is over and the throughput converged, then
+    // rampUpTime and targetTime are only upper bounds
+    bool adaptive;
+    // half width of the 95% confidence interval of the mean slot
+    // throughput relative to the mean at which an adaptive test stops
+    qreal tolerance;
+    // ms between two TCP_INFO samples of each connection, 0 to not sample
+    int tcpInfoInterval;
 
     // Serializable interface
     QVariant toVariant() const;
@@ -0,0 +1,248 @@
+#include "httpresponseparser.h"
+
+#include <QList>
+
+#include <string.h>
+
+HttpResponseParser::HttpResponseParser()
+: m_state(StatusLine)
+, m_statusCode(0)
+, m_contentLength(-1)
+, m_chunked(false)
+, m_remaining(0)
+, m_headersComplete(false)
+{
+}
+
+void HttpResponseParser::feed(const char *data, qint64 size)
+{
+    while (size > 0)
+    {
+        switch (m_state)
+        {
+        case Body:
+        case ChunkData:
+        {
+            qint64 n = m_remaining < 0 ? size : qMin(size, m_remaining);
+            skip(n);
+            data += n;
+            size -= n;
+            break;
+        }
+
+        case Complete:
+        case Error:
+            // a server sending more than it announced does not matter
+            return;
+
+        default:
+        {
+            const char *end = static_cast<const char *>(memchr(data, '\n', size));
+            qint64 n = end ? end - data + 1 : size;
+
+            m_line.append(data, n);
+            data += n;
+            size -= n;
+
+            if (end)
+            {
+                QByteArray line = m_line;
+                m_line.clear();
+                parseLine(line.trimmed());
+            }
+            else if (m_line.size() > maxLineLength)
+            {
+                m_state = Error;
+            }
+
+            break;
+        }
+        }
+    }
+}
+
+qint64 HttpResponseParser::skippable() const
+{
+    if (m_state == Body || m_state == ChunkData)
+    {
+        return m_remaining;
+    }
+
+    return 0;
+}
+
+void HttpResponseParser::skip(qint64 size)
+{
+    if (m_remaining < 0)
+    {
+        return;
+    }
+
+    m_remaining -= size;
+
+    if (m_remaining == 0)
+    {
+        m_state = m_state == Body ? Complete : ChunkDataEnd;
+    }
+}
+
+HttpResponseParser::State HttpResponseParser::state() const
+{
+    return m_state;
+}
+
+bool HttpResponseParser::headersComplete() const
+{
+    return m_headersComplete;
+}
+
+bool HttpResponseParser::isComplete() const
+{
+    return m_state == Complete;
+}
+
+int HttpResponseParser::statusCode() const
+{
+    return m_statusCode;
+}
+
+qint64 HttpResponseParser::contentLength() const
+{
+    return m_contentLength;
+}
+
+bool HttpResponseParser::isChunked() const
+{
+    return m_chunked;
+}
+
+void HttpResponseParser::parseLine(const QByteArray &line)
+{
+    switch (m_state)
+    {
+    case StatusLine:
+    {
+        // HTTP/1.1 200 OK
+        QList<QByteArray> parts = line.split(' ');
+        bool ok = false;
+
+        if (parts.size() >= 2 && parts[0].startsWith("HTTP/"))
+        {
+            m_statusCode = parts[1].toInt(&ok);
+        }
+
+        m_state = ok ? Headers : Error;
+        break;
+    }
+
+    case Headers:
+        if (line.isEmpty())
+        {
+            headersDone();
+        }
+        else
+        {
+            parseHeader(line);
+        }
+        break;
+
+    case ChunkSize:
+    {
+        bool ok = false;
+        int extension = line.indexOf(';');
+        qint64 size = (extension < 0 ? line : line.left(extension)).trimmed().toLongLong(&ok, 16);
+
+        if (!ok || size < 0)
+        {
+            m_state = Error;
+        }
+        else if (size == 0)
+        {
+            m_state = Trailers;
+        }
+        else
+        {
+            m_remaining = size;
+            m_state = ChunkData;
+        }
+        break;
+    }
+
+    case ChunkDataEnd:
+        m_state = line.isEmpty() ? ChunkSize : Error;
+        break;
+
+    case Trailers:
+        if (line.isEmpty())
+        {
+            m_state = Complete;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void HttpResponseParser::parseHeader(const QByteArray &line)
+{
+    int colon = line.indexOf(':');
+
+    if (colon <= 0)
+    {
+        m_state = Error;
+        return;
+    }
+
+    QByteArray name = line.left(colon).trimmed().toLower();
+    QByteArray value = line.mid(colon + 1).trimmed();
+
+    if (name == "content-length")
+    {
+        bool ok = false;
+        m_contentLength = value.toLongLong(&ok);
+
+        if (!ok || m_contentLength < 0)
+        {
+            m_state = Error;
+        }
+    }
+    else if (name == "transfer-encoding")
+    {
+        m_chunked = value.toLower().contains("chunked");
+    }
+}
+
+void HttpResponseParser::headersDone()
+{
+    // an interim response (100 Continue) is followed by the real one
+    if (m_statusCode >= 100 && m_statusCode < 200)
+    {
+        m_statusCode = 0;
+        m_contentLength = -1;
+        m_chunked = false;
+        m_state = StatusLine;
+        return;
+    }
+
+    m_headersComplete = true;
+
+    if (m_statusCode == 204 || m_statusCode == 304)
+    {
+        m_state = Complete;
+    }
+    else if (m_chunked)
+    {
+        m_state = ChunkSize;
+    }
+    else if (m_contentLength == 0)
+    {
+        m_state = Complete;
+    }
+    else
+    {
+        // without a length the body ends when the server closes
+        m_remaining = m_contentLength;
+        m_state = Body;
+    }
+}
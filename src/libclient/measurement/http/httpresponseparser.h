@@ -0,0 +1,67 @@
+#ifndef HTTPRESPONSEPARSER_H
+#define HTTPRESPONSEPARSER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+/*
+ * Incremental parser of an HTTP/1.x response: status line, headers and
+ * the framing of the body (Content-Length, chunked or until the server
+ * closes the connection). The body itself is not kept, skippable() tells
+ * how much of it can be thrown away without looking at it.
+ */
+class HttpResponseParser
+{
+public:
+    enum State
+    {
+        StatusLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailers,
+        Complete,
+        Error
+    };
+
+    HttpResponseParser();
+
+    void feed(const char *data, qint64 size);
+
+    // body bytes which can be skipped right now, -1 if the body lasts until
+    // the connection is closed
+    qint64 skippable() const;
+    // only bytes reported by skippable()
+    void skip(qint64 size);
+
+    State state() const;
+    bool headersComplete() const;
+    bool isComplete() const;
+
+    // 0 until the status line was parsed
+    int statusCode() const;
+    // -1 if not given
+    qint64 contentLength() const;
+    bool isChunked() const;
+
+private:
+    void parseLine(const QByteArray &line);
+    void parseHeader(const QByteArray &line);
+    void headersDone();
+
+    State m_state;
+    QByteArray m_line;
+    int m_statusCode;
+    qint64 m_contentLength;
+    bool m_chunked;
+    // body or chunk bytes still to come, -1 until the connection is closed
+    qint64 m_remaining;
+    bool m_headersComplete;
+
+    // longer status, header or chunk size lines are an error
+    static const int maxLineLength = 8192;
+};
+
+#endif // HTTPRESPONSEPARSER_H
@@ -0,0 +1,769 @@
+#include "httpupload.h"
+#include "../../log/logger.h"
+#include "types.h"
+#include "../statistics.h"
+#include "../../network/randomdata.h"
+
+#if defined(Q_OS_LINUX)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+LOGGER(HTTPUpload);
+
+namespace
+{
+    //the body is announced with a length no upload reaches in its time
+    const qint64 maxBytesPerMs = 10000000000LL / 8 / 1000;
+}
+
+UploadBuffer::UploadBuffer(int size)
+: m_data(randomData(size))
+, m_fd(-1)
+{
+#if defined(Q_OS_LINUX) && defined(SYS_memfd_create)
+    m_fd = syscall(SYS_memfd_create, "httpupload", 0);
+
+    if (m_fd < 0)
+    {
+        LOG_DEBUG(QString("memfd_create failed, sending from memory: %1").arg(strerror(errno)));
+        return;
+    }
+
+    qint64 written = 0;
+
+    while (written < size)
+    {
+        ssize_t n = ::write(m_fd, m_data.constData() + written, size - written);
+
+        if (n <= 0)
+        {
+            LOG_DEBUG(QString("Unable to fill the memfd, sending from memory: %1").arg(strerror(errno)));
+            ::close(m_fd);
+            m_fd = -1;
+            return;
+        }
+
+        written += n;
+    }
+#endif
+}
+
+UploadBuffer::~UploadBuffer()
+{
+#if defined(Q_OS_LINUX)
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+#endif
+}
+
+const QByteArray &UploadBuffer::data() const
+{
+    return m_data;
+}
+
+int UploadBuffer::fd() const
+{
+    return m_fd;
+}
+
+UploadConnection::UploadConnection(const QUrl &url, const QHostInfo &server, const UploadBuffer *buffer,
+                                   int targetTimeMs, int rampUpTimeMs, int slotLengthMs, QObject *parent)
+: QObject(parent)
+, url(url)
+, server(server)
+, buffer(buffer)
+, socket(NULL)
+, writeNotifier(NULL)
+, cStatus(Inactive)
+, headerBytes(0)
+, remainingBytes((qint64)(2 * tcpConnectTimeout + rampUpTimeMs + targetTimeMs) * maxBytesPerMs)
+, position(0)
+, samples((qint64)slotLengthMs * 1000000 / binsPerSlot,
+          (qint64)(2 * tcpConnectTimeout + rampUpTimeMs + targetTimeMs) * 1000000)
+, countAcked(false)
+, ackedOffset(0)
+, ackedBytes(0)
+{
+    timeoutTimer.setSingleShot(true);
+    connect(&timeoutTimer, &QTimer::timeout, this, &UploadConnection::timeout);
+
+    sampleTimer.setInterval(qMax(slotLengthMs / binsPerSlot, 1));
+    connect(&sampleTimer, &QTimer::timeout, this, &UploadConnection::sampleAcked);
+}
+
+UploadConnection::~UploadConnection()
+{
+    delete writeNotifier;
+
+    if (socket != NULL)
+    {
+        if (socket->state() == QAbstractSocket::ConnectedState)
+        {
+            socket->close();
+        }
+
+        delete socket;
+    }
+}
+
+UploadConnection::UploadConnectionStatus UploadConnection::connectionStatus() const
+{
+    return cStatus;
+}
+
+qint64 UploadConnection::startTimeInNs() const
+{
+    return startTime.toMSecsSinceEpoch() * 1000000;
+}
+
+qint64 UploadConnection::endTimeInNs() const
+{
+    return startTime.toMSecsSinceEpoch() * 1000000 + samples.lastTime();
+}
+
+qint64 UploadConnection::runTimeInNs() const
+{
+    return samples.lastTime();
+}
+
+qreal UploadConnection::averageThroughput(qint64 sTime, qint64 eTime) const
+{
+    return samples.averageThroughput(sTime - startTimeInNs(), eTime - startTimeInNs());
+}
+
+QList<qreal> UploadConnection::measurementSlots(int slotLength) const
+{
+    return samples.throughputSlots((qint64)slotLength * 1000000);
+}
+
+bool UploadConnection::countsAckedBytes() const
+{
+    return countAcked;
+}
+
+void UploadConnection::startTCPConnection()
+{
+    if (server.addresses().isEmpty() || (!url.isValid()))
+    {
+        cStatus = FinishedError;
+        emit TCPConnected(false);
+        return;
+    }
+
+    socket = new QTcpSocket();
+
+    connect(socket, &QTcpSocket::connected, this, &UploadConnection::connected);
+    connect(socket, &QTcpSocket::disconnected, this, &UploadConnection::disconnected);
+    connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError(QAbstractSocket::SocketError)));
+    connect(socket, &QTcpSocket::bytesWritten, this, &UploadConnection::written);
+    connect(socket, &QTcpSocket::readyRead, this, &UploadConnection::serverResponse);
+
+    cStatus = ConnectingTCP;
+
+    socket->connectToHost(server.addresses().first(), url.port(defaultPort));
+
+    timeoutTimer.start(tcpConnectTimeout);
+}
+
+void UploadConnection::connected()
+{
+    timeoutTimer.stop();
+    cStatus = ConnectedTCP;
+    emit TCPConnected(true);
+}
+
+void UploadConnection::disconnected()
+{
+    if (cStatus == UploadInProgress)
+    {
+        finish();
+    }
+    else
+    {
+        fail();
+    }
+}
+
+void UploadConnection::socketError(QAbstractSocket::SocketError socketError)
+{
+    //the server closing the connection is handled by disconnected()
+    if (socketError != QAbstractSocket::RemoteHostClosedError)
+    {
+        fail();
+    }
+}
+
+void UploadConnection::timeout()
+{
+    fail();
+}
+
+void UploadConnection::fail()
+{
+    switch (cStatus)
+    {
+    case ConnectingTCP:
+        cStatus = FinishedError;
+        socket->abort();
+        emit TCPConnected(false);
+        break;
+
+    case UploadInProgress:
+        //keep what was measured until the error
+        finish();
+        break;
+
+    default:
+        break;
+    }
+}
+
+//the upload ended by itself, what was sent so far counts
+void UploadConnection::finish()
+{
+    if (cStatus != UploadInProgress)
+    {
+        return;
+    }
+
+    if (countAcked)
+    {
+        sampleAcked();
+        sampleTimer.stop();
+    }
+
+    cStatus = FinishedSuccess;
+
+    if (writeNotifier != NULL)
+    {
+        writeNotifier->setEnabled(false);
+    }
+
+    emit uploadStopped();
+}
+
+void UploadConnection::startUpload()
+{
+    if (cStatus != ConnectedTCP)
+    {
+        cStatus = FinishedError;
+        emit uploadStarted(false);
+        return;
+    }
+
+    QByteArray request = QString("POST %1 HTTP/1.1\r\n"
+                                 "Host: %2\r\n"
+                                 "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10.9; rv:31.0) Gecko/20100101 Firefox/31.0\r\n"
+                                 "Referer: http://www.measure-it.net\r\n"
+                                 "Content-Type: application/octet-stream\r\n"
+                                 "Content-Length: %3\r\n\r\n")
+                         .arg(url.path().isEmpty() ? "/" : url.path())
+                         .arg(url.host())
+                         .arg(remainingBytes).toLatin1();
+
+    startTime = QDateTime::currentDateTime();
+
+    //the header goes through the socket's buffer, the body follows once it
+    //is out (see written())
+    headerBytes = socket->write(request);
+
+    if (headerBytes != request.size())
+    {
+        cStatus = FinishedError;
+        socket->abort();
+        emit uploadStarted(false);
+        return;
+    }
+
+    if (buffer->fd() >= 0)
+    {
+        writeNotifier = new QSocketNotifier(socket->socketDescriptor(), QSocketNotifier::Write);
+        writeNotifier->setEnabled(false);
+        connect(writeNotifier, &QSocketNotifier::activated, this, &UploadConnection::send);
+    }
+
+    //the socket accepts a send buffer full of data at once, only what the
+    //server acknowledged went through the link; the header is not body
+    ackedOffset = TcpInfoSeries::bytesAcked(socket);
+    countAcked = ackedOffset >= 0;
+    ackedOffset += request.size();
+    ackedBytes = 0;
+
+    measurementTimer.start();
+
+    if (countAcked)
+    {
+        sampleTimer.start();
+    }
+
+    cStatus = UploadInProgress;
+    emit uploadStarted(true);
+}
+
+void UploadConnection::sampleAcked()
+{
+    qint64 acked = TcpInfoSeries::bytesAcked(socket) - ackedOffset;
+
+    if (acked > ackedBytes)
+    {
+        samples.add(measurementTimer.nsecsElapsed(), acked - ackedBytes);
+        ackedBytes = acked;
+    }
+}
+
+void UploadConnection::written(qint64 bytes)
+{
+    if (cStatus != UploadInProgress)
+    {
+        return;
+    }
+
+    qint64 header = qMin(bytes, headerBytes);
+    headerBytes -= header;
+    bytes -= header;
+
+    if (bytes > 0 && !countAcked)
+    {
+        samples.add(measurementTimer.nsecsElapsed(), bytes);
+    }
+
+    if (headerBytes == 0)
+    {
+        send();
+    }
+}
+
+void UploadConnection::send()
+{
+    if (cStatus != UploadInProgress || headerBytes > 0)
+    {
+        return;
+    }
+
+    const QByteArray &data = buffer->data();
+
+#if defined(Q_OS_LINUX)
+    if (buffer->fd() >= 0)
+    {
+        qint64 sent = 0;
+        bool failed = false;
+        int sendError = 0;
+
+        //unlike the socket's own writes sendfile() raises SIGPIPE when the
+        //peer is gone, keep it from ending the process
+        sigset_t sigpipe;
+        sigset_t oldMask;
+        sigemptyset(&sigpipe);
+        sigaddset(&sigpipe, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &sigpipe, &oldMask);
+
+        while (remainingBytes > 0)
+        {
+            off_t offset = position % data.size();
+            ssize_t n = ::sendfile(socket->socketDescriptor(), buffer->fd(), &offset,
+                                   qMin((qint64)data.size() - offset, remainingBytes));
+
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+
+            if (n <= 0)
+            {
+                sendError = errno;
+                failed = true;
+                break;
+            }
+
+            sent += n;
+            position += n;
+            remainingBytes -= n;
+        }
+
+        if (failed)
+        {
+            LOG_DEBUG(QString("sendfile failed: %1").arg(strerror(sendError)));
+
+            if (sendError == EPIPE)
+            {
+                struct timespec noWait = {0, 0};
+                sigtimedwait(&sigpipe, NULL, &noWait);
+            }
+        }
+
+        pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+        if (sent > 0 && !countAcked)
+        {
+            samples.add(measurementTimer.nsecsElapsed(), sent);
+        }
+
+        if (failed || remainingBytes == 0)
+        {
+            finish();
+            return;
+        }
+
+        writeNotifier->setEnabled(true);
+        return;
+    }
+#endif
+
+    //keep one buffer queued in the socket, without TCP_INFO written()
+    //counts what the socket hands to the operating system
+    while (remainingBytes > 0 && socket->bytesToWrite() < data.size())
+    {
+        qint64 offset = position % data.size();
+        qint64 n = socket->write(data.constData() + offset, qMin(data.size() - offset, remainingBytes));
+
+        if (n <= 0)
+        {
+            break;
+        }
+
+        position += n;
+        remainingBytes -= n;
+    }
+
+    if (remainingBytes == 0 && socket->bytesToWrite() == 0)
+    {
+        finish();
+    }
+}
+
+void UploadConnection::serverResponse()
+{
+    //a sink answers once it got the whole body or refuses the upload, either
+    //way nothing more is accepted
+    socket->readAll();
+    finish();
+}
+
+void UploadConnection::stopUpload()
+{
+    timeoutTimer.stop();
+    sampleTimer.stop();
+
+    if (cStatus == UploadInProgress)
+    {
+        if (countAcked)
+        {
+            sampleAcked();
+        }
+
+        cStatus = FinishedSuccess;
+    }
+
+    if (writeNotifier != NULL)
+    {
+        writeNotifier->setEnabled(false);
+    }
+
+    if (socket != NULL)
+    {
+        socket->disconnect(this);
+        socket->abort();
+    }
+}
+
+
+HTTPUpload::HTTPUpload(QObject *parent)
+: Measurement(parent)
+, currentStatus(HTTPUpload::Unknown)
+, buffer(NULL)
+, overallBandwidth(0.0)
+, connectedThreads(0)
+, unconnectedThreads(0)
+, uploadingThreads(0)
+, notUploadingThreads(0)
+, finishedThreads(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+HTTPUpload::~HTTPUpload()
+{
+    qDeleteAll(workers);
+    delete buffer;
+}
+
+Measurement::Status HTTPUpload::status() const
+{
+    return currentStatus;
+}
+
+bool HTTPUpload::prepare(NetworkManager *networkManager,
+                         const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager)
+
+    definition = measurementDefinition.dynamicCast<HTTPUploadDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("received NULL definition");
+        return false;
+    }
+
+    if (definition->threads > maxThreads || definition->threads < minThreads)
+    {
+        setErrorString("requested number of threads wrong");
+        return false;
+    }
+
+    if (definition->rampUpTime > maxRampUpTime || definition->rampUpTime < minRampUpTime)
+    {
+        setErrorString("requested ramp-up time wrong");
+        return false;
+    }
+
+    if (definition->targetTime > maxTargetTime || definition->targetTime < minTargetTime)
+    {
+        setErrorString("requested target time wrong");
+        return false;
+    }
+
+    if (definition->slotLength > definition->targetTime || definition->slotLength < minSlotLength)
+    {
+        setErrorString("requested slot length wrong");
+        return false;
+    }
+
+    requestUrl = QUrl::fromUserInput(definition->url);
+
+    if (!requestUrl.isValid())
+    {
+        setErrorString("invalid URL");
+        return false;
+    }
+
+    //generated before the measurement starts so it does not cost upload time
+    buffer = new UploadBuffer(bufferSize);
+
+    return true;
+}
+
+bool HTTPUpload::start()
+{
+    QHostInfo::lookupHost(requestUrl.host(), this, SLOT(startConnections(QHostInfo)));
+
+    return true;
+}
+
+bool HTTPUpload::startConnections(const QHostInfo &server)
+{
+    if (server.error() != QHostInfo::NoError)
+    {
+        emit error("Name resolution failed");
+        return false;
+    }
+
+    for (int n = 0; n < definition->threads; n++)
+    {
+        UploadConnection *worker = new UploadConnection(requestUrl, server, buffer, definition->targetTime,
+                                                        definition->rampUpTime, definition->slotLength);
+
+        workers.append(worker);
+
+        connect(worker, &UploadConnection::TCPConnected, this, &HTTPUpload::TCPConnectionTracking);
+        connect(worker, &UploadConnection::uploadStarted, this, &HTTPUpload::uploadStartedTracking);
+        connect(worker, &UploadConnection::uploadStopped, this, &HTTPUpload::prematureStopTracking);
+    }
+
+    setStatus(HTTPUpload::Running);
+
+    foreach (UploadConnection *worker, workers)
+    {
+        worker->startTCPConnection();
+    }
+
+    return true;
+}
+
+void HTTPUpload::prematureStopTracking()
+{
+    finishedThreads++;
+
+    if (finishedThreads == uploadingThreads)
+    {
+        uploadFinished();
+    }
+}
+
+void HTTPUpload::TCPConnectionTracking(bool success)
+{
+    if (success)
+    {
+        connectedThreads++;
+    }
+    else
+    {
+        unconnectedThreads++;
+    }
+
+    if (connectedThreads + unconnectedThreads == definition->threads)
+    {
+        if (connectedThreads == 0)
+        {
+            emit error("Unable to establish a TCP connection");
+            return;
+        }
+
+        foreach (UploadConnection *worker, workers)
+        {
+            worker->startUpload();
+        }
+    }
+}
+
+void HTTPUpload::uploadStartedTracking(bool success)
+{
+    if (success)
+    {
+        uploadingThreads++;
+    }
+    else
+    {
+        notUploadingThreads++;
+    }
+
+    if (uploadingThreads + notUploadingThreads == definition->threads)
+    {
+        if (notUploadingThreads == definition->threads)
+        {
+            emit error("No thread able to upload after TCP connection was established.");
+            return;
+        }
+
+        uploadStartTime = QDateTime::currentDateTime().addMSecs(definition->rampUpTime);
+        uploadTimer.singleShot(definition->targetTime + definition->rampUpTime, this, SLOT(uploadFinished()));
+    }
+}
+
+void HTTPUpload::uploadFinished()
+{
+    if (currentStatus == HTTPUpload::Finished)
+    {
+        return;
+    }
+
+    setStatus(HTTPUpload::Finished);
+
+    foreach (UploadConnection *worker, workers)
+    {
+        worker->disconnect(this);
+        worker->stopUpload();
+    }
+
+    if (calculateResults())
+    {
+        emit finished();
+    }
+    else
+    {
+        emit error("Unable to calculate accurate results on the measurement.");
+    }
+}
+
+//same criteria as for the download
+bool HTTPUpload::resultsTrustable()
+{
+    int unfinishedThreads = 0;
+
+    foreach (UploadConnection *worker, workers)
+    {
+        if (worker->connectionStatus() != UploadConnection::FinishedSuccess)
+        {
+            unfinishedThreads++;
+            continue;
+        }
+
+        if (worker->runTimeInNs() -
+                (uploadStartTime.toMSecsSinceEpoch() * 1000000 - worker->startTimeInNs())
+                < (((double)definition->targetTime * 1000000) * 0.75))
+        {
+            return false;
+        }
+    }
+
+    return unfinishedThreads != definition->threads;
+}
+
+bool HTTPUpload::calculateResults()
+{
+    QVariantList threadResults;
+    int num_threads = 0;
+    bool resultsOK = resultsTrustable();
+
+    foreach (UploadConnection *worker, workers)
+    {
+        if (worker->connectionStatus() != UploadConnection::FinishedSuccess)
+        {
+            continue;
+        }
+
+        num_threads++;
+
+        QVariantMap thread;
+        qreal avg = worker->averageThroughput(uploadStartTime.toMSecsSinceEpoch() * 1000000,
+                                              uploadStartTime.toMSecsSinceEpoch() * 1000000 +
+                                              ((qint64) (definition->targetTime)) * 1000000);
+        thread.insert("avg", avg);
+        overallBandwidth += avg;
+
+        QList<qreal> measurementSlots = worker->measurementSlots(definition->slotLength);
+
+        Statistics slotStatistics;
+
+        foreach (qreal slot, measurementSlots)
+        {
+            slotStatistics.add(slot);
+        }
+
+        thread.insert("max", slotStatistics.max());
+        thread.insert("min", slotStatistics.min());
+        thread.insert("stdev", slotStatistics.stdev());
+        thread.insert("p50", slotStatistics.quantile(0.5));
+        thread.insert("p90", slotStatistics.quantile(0.9));
+        thread.insert("p99", slotStatistics.quantile(0.99));
+
+        thread.insert("slots", listToVariant(measurementSlots));
+        thread.insert("bytes_counted", worker->countsAckedBytes() ? "acked" : "written");
+
+        threadResults.append(thread);
+    }
+
+    results.insert("actual_num_threads", num_threads);
+    results.insert("results_ok", resultsOK);
+    results.insert("bandwidth_bps_avg", overallBandwidth);
+    results.insert("bandwidth_bps_per_thread", threadResults);
+
+    return true;
+}
+
+bool HTTPUpload::stop()
+{
+    return true;
+}
+
+Result HTTPUpload::result() const
+{
+    return Result(results);
+}
+
+void HTTPUpload::setStatus(Status status)
+{
+    if (currentStatus != status)
+    {
+        currentStatus = status;
+        emit statusChanged(status);
+    }
+}
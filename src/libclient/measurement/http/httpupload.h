@@ -0,0 +1,201 @@
+#ifndef HTTPUPLOAD_H
+#define HTTPUPLOAD_H
+
+#include "../measurement.h"
+#include "httpupload_definition.h"
+#include "samplering.h"
+#include "../../network/tcpinfo.h"
+
+#include <QElapsedTimer>
+#include <QHostInfo>
+#include <QUrl>
+#include <QList>
+#include <QTimer>
+#include <QTcpSocket>
+#include <QSocketNotifier>
+
+// incompressible data the upload connections send over and over; on Linux
+// it is also kept in a memfd so it can be sent with sendfile() without
+// copying it into the socket
+class UploadBuffer
+{
+public:
+    explicit UploadBuffer(int size);
+    ~UploadBuffer();
+
+    const QByteArray &data() const;
+    // the memfd holding data(), -1 if not available
+    int fd() const;
+
+private:
+    QByteArray m_data;
+    int m_fd;
+};
+
+// one HTTP POST of upload data, like DownloadConnection all of them share
+// the thread of the measurement
+class UploadConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum UploadConnectionStatus
+    {
+        Inactive,
+        ConnectingTCP,
+        ConnectedTCP,
+        UploadInProgress,
+        FinishedSuccess,
+        FinishedError
+    };
+
+    UploadConnection(const QUrl &url, const QHostInfo &server, const UploadBuffer *buffer, int targetTimeMs,
+                     int rampUpTimeMs, int slotLengthMs, QObject *parent = 0);
+    ~UploadConnection();
+
+    UploadConnectionStatus connectionStatus() const;
+
+    qint64 startTimeInNs() const;
+    qint64 endTimeInNs() const;
+    qint64 runTimeInNs() const;
+
+    qreal averageThroughput(qint64 sTime, qint64 eTime) const; //average througput in bps
+    QList<qreal> measurementSlots(int slotLength) const; //slotLength in ms
+    //false if the samples are the bytes handed to the operating system
+    bool countsAckedBytes() const;
+
+private:
+    void fail();
+    void finish();
+
+    QUrl url;
+    QHostInfo server;
+    const UploadBuffer *buffer;
+
+    QTcpSocket *socket;
+    //signals when sendfile() can continue, NULL without a memfd
+    QSocketNotifier *writeNotifier;
+
+    UploadConnectionStatus cStatus;
+
+    QTimer timeoutTimer;
+    //polls the acknowledged bytes, runs once per bin of the samples
+    QTimer sampleTimer;
+
+    //absolute start time of the upload
+    QDateTime startTime;
+    QElapsedTimer measurementTimer;
+
+    //bytes of the request header not written yet, they are no upload data
+    qint64 headerBytes;
+    //bytes of the body not sent yet
+    qint64 remainingBytes;
+    //position in the upload buffer
+    qint64 position;
+
+    //bytes of the body the server acknowledged since the request was sent;
+    //where TCP_INFO does not tell, the bytes handed to the operating system,
+    //which at first only fill the send buffer
+    SampleRing samples;
+    bool countAcked;
+    //acknowledged bytes which were no body data, body bytes counted so far
+    qint64 ackedOffset;
+    qint64 ackedBytes;
+
+    static const int tcpConnectTimeout = 5000;
+    static const int defaultPort = 80;
+    //resolution of the samples relative to the slot length
+    static const int binsPerSlot = 10;
+
+public slots:
+    void startTCPConnection();
+    void startUpload();
+    void stopUpload();
+
+private slots:
+    void connected();
+    void disconnected();
+    void socketError(QAbstractSocket::SocketError socketError);
+    void timeout();
+    void sampleAcked();
+    void written(qint64 bytes);
+    void send();
+    //the server answers once it has had enough
+    void serverResponse();
+
+signals:
+    void TCPConnected(bool success);
+    void uploadStarted(bool success);
+    //the upload ended before it was stopped
+    void uploadStopped();
+};
+
+
+class HTTPUpload : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit HTTPUpload(QObject *parent = 0);
+    ~HTTPUpload();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private:
+    QVariantMap results;
+
+    void setStatus(Status status);
+    bool resultsTrustable();
+    bool calculateResults();
+
+    HTTPUploadDefinitionPtr definition;
+
+    Status currentStatus;
+    QUrl requestUrl;
+
+    UploadBuffer *buffer;
+    QList<UploadConnection *> workers;
+
+    qreal overallBandwidth;
+
+    //timer to stop the upload (from startTime till targetTime in milli-seconds later)
+    QTimer uploadTimer;
+
+    QDateTime uploadStartTime;
+
+    //like the download the definition and the results speak of threads
+    int connectedThreads;
+    int unconnectedThreads;
+    int uploadingThreads;
+    int notUploadingThreads;
+    int finishedThreads;
+
+    //same bounds as the download
+    static const int maxRampUpTime = 10000;
+    static const int minRampUpTime = 1000;
+    static const int maxThreads = 64;
+    static const int minThreads = 1;
+    static const int maxTargetTime = 45000;
+    static const int minTargetTime = 2000;
+    static const int minSlotLength = 250;
+    static const int bufferSize = 4 * 1024 * 1024;
+
+private slots:
+    bool startConnections(const QHostInfo &server);
+    void uploadFinished();
+
+public slots:
+    void TCPConnectionTracking(bool success);
+    void uploadStartedTracking(bool success);
+    void prematureStopTracking();
+
+signals:
+    void statusChanged(Status status);
+};
+
+#endif // HTTPUPLOAD_H
@@ -0,0 +1,36 @@
+#include "httpupload_definition.h"
+
+HTTPUploadDefinition::HTTPUploadDefinition(const QString &url, const int threads, const int targetTime,
+                                           const int rampUpTime, const int slotLength)
+: url(url)
+, threads(threads)
+, targetTime(targetTime)
+, rampUpTime(rampUpTime)
+, slotLength(slotLength)
+{
+}
+
+HTTPUploadDefinition::~HTTPUploadDefinition()
+{
+}
+
+HTTPUploadDefinitionPtr HTTPUploadDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+    return HTTPUploadDefinitionPtr(new HTTPUploadDefinition(map.value("url", "").toString(),
+                                                            map.value("threads", 1).toInt(),
+                                                            map.value("target_time", 10000).toInt(),
+                                                            map.value("ramp_up_time", 3000).toInt(),
+                                                            map.value("slot_length", 1000).toInt()));
+}
+
+QVariant HTTPUploadDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("url", url);
+    map.insert("threads", threads);
+    map.insert("target_time", targetTime);
+    map.insert("ramp_up_time", rampUpTime);
+    map.insert("slot_length", slotLength);
+    return map;
+}
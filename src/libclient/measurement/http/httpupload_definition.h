@@ -0,0 +1,32 @@
+#ifndef HTTPUPLOAD_DEFINITION_H
+#define HTTPUPLOAD_DEFINITION_H
+
+#include "../measurementdefinition.h"
+
+class HTTPUploadDefinition;
+
+typedef QSharedPointer<HTTPUploadDefinition> HTTPUploadDefinitionPtr;
+typedef QList<HTTPUploadDefinitionPtr> HTTPUploadDefinitionList;
+
+class HTTPUploadDefinition : public MeasurementDefinition
+{
+public:
+    HTTPUploadDefinition(const QString &url, const int threads, const int targetTime,
+                         const int rampUpTime, const int slotLength);
+    ~HTTPUploadDefinition();
+
+    // Storage
+    static HTTPUploadDefinitionPtr fromVariant(const QVariant &variant);
+
+    // Getters
+    QString url;
+    int threads;
+    int targetTime;
+    int rampUpTime;
+    int slotLength;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // HTTPUPLOAD_DEFINITION_H
@@ -0,0 +1,21 @@
+#include "httpupload_plugin.h"
+#include "httpupload.h"
+#include "httpupload_definition.h"
+
+QStringList HTTPUploadPlugin::measurements() const
+{
+    return QStringList()
+           << "httpupload";
+}
+
+MeasurementPtr HTTPUploadPlugin::createMeasurement(const QString &name)
+{
+    Q_UNUSED(name);
+    return MeasurementPtr(new HTTPUpload);
+}
+
+MeasurementDefinitionPtr HTTPUploadPlugin::createMeasurementDefinition(const QString &name, const QVariant &data)
+{
+    Q_UNUSED(name);
+    return HTTPUploadDefinition::fromVariant(data);
+}
@@ -0,0 +1,16 @@
+#ifndef HTTPUPLOAD_PLUGIN_H
+#define HTTPUPLOAD_PLUGIN_H
+
+#include "../measurementplugin.h"
+
+class HTTPUploadPlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // HTTPUPLOAD_PLUGIN_H
@@ -0,0 +1,112 @@
+#include "samplering.h"
+
+SampleRing::SampleRing(qint64 binWidth, qint64 duration)
+: m_binWidth(qMax(binWidth, (qint64)1))
+, m_lastBin(-1)
+, m_firstTime(0)
+, m_lastTime(0)
+{
+    m_bins.fill(0, qMax(duration, (qint64)0) / m_binWidth + 1);
+}
+
+void SampleRing::add(qint64 time, qint64 bytes)
+{
+    qint64 bin = time / m_binWidth;
+
+    if (m_lastBin < 0)
+    {
+        m_firstTime = time;
+    }
+    else
+    {
+        // clear the bins skipped since the last sample, they may hold data
+        // of one lap ago
+        for (qint64 i = qMax(m_lastBin + 1, bin - m_bins.size() + 1); i < bin; i++)
+        {
+            m_bins[i % m_bins.size()] = 0;
+        }
+    }
+
+    if (bin != m_lastBin)
+    {
+        m_bins[bin % m_bins.size()] = 0;
+        m_lastBin = bin;
+    }
+
+    m_bins[bin % m_bins.size()] += bytes;
+    m_lastTime = time;
+}
+
+bool SampleRing::isEmpty() const
+{
+    return m_lastBin < 0;
+}
+
+qint64 SampleRing::firstTime() const
+{
+    return m_firstTime;
+}
+
+qint64 SampleRing::lastTime() const
+{
+    return m_lastTime;
+}
+
+qreal SampleRing::averageThroughput(qint64 begin, qint64 end) const
+{
+    begin = qMax(begin, m_firstTime);
+    end = qMin(end, m_lastTime);
+
+    if (isEmpty() || end <= begin)
+    {
+        return 0.0;
+    }
+
+    qint64 bytes = 0;
+
+    for (qint64 bin = begin / m_binWidth; bin <= end / m_binWidth; bin++)
+    {
+        bytes += binBytes(bin);
+    }
+
+    // bins are counted whole, so is their time
+    qint64 duration = qMin((end / m_binWidth + 1) * m_binWidth, m_lastTime) - (begin / m_binWidth) * m_binWidth;
+
+    return (8.0 * (qreal)bytes) / ((qreal)duration / 1000000000.0);
+}
+
+QList<qreal> SampleRing::throughputSlots(qint64 slotLength) const
+{
+    QList<qreal> slotList;
+
+    qint64 slotBins = qMax(slotLength / m_binWidth, (qint64)1);
+
+    // the bins before the first byte (e.g. while the request was on its way)
+    // and those already overwritten would count as slots without throughput
+    qint64 firstBin = qMax(m_firstTime / m_binWidth, m_lastBin - m_bins.size() + 1);
+
+    for (qint64 first = firstBin; first + slotBins <= m_lastBin + 1; first += slotBins)
+    {
+        qint64 bytes = 0;
+
+        for (qint64 bin = first; bin < first + slotBins; bin++)
+        {
+            bytes += binBytes(bin);
+        }
+
+        slotList << (8.0 * (qreal)bytes) / ((qreal)(slotBins * m_binWidth) / 1000000000.0);
+    }
+
+    return slotList;
+}
+
+// 0 for bins which are not (or no longer) in the ring
+qint64 SampleRing::binBytes(qint64 bin) const
+{
+    if (bin < 0 || bin > m_lastBin || bin <= m_lastBin - m_bins.size())
+    {
+        return 0;
+    }
+
+    return m_bins[bin % m_bins.size()];
+}
@@ -0,0 +1,44 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+
+/*
+ * Bytes transferred by one connection, counted in bins of binWidth ns
+ * since the transfer started. The ring is allocated once for the expected
+ * duration, if a transfer runs longer its oldest bins are overwritten.
+ * All times are relative to the start of the transfer in ns.
+ */
+class SampleRing
+{
+public:
+    SampleRing(qint64 binWidth, qint64 duration);
+
+    void add(qint64 time, qint64 bytes);
+
+    bool isEmpty() const;
+    // times of the first and the last sample
+    qint64 firstTime() const;
+    qint64 lastTime() const;
+
+    // average throughput in bps between begin and end, cut to the time
+    // samples were taken
+    qreal averageThroughput(qint64 begin, qint64 end) const;
+    // throughput in bps of every complete slot of slotLength ns, starting
+    // with the bin of the first sample
+    QList<qreal> throughputSlots(qint64 slotLength) const;
+
+private:
+    qint64 binBytes(qint64 bin) const;
+
+    QVector<qint64> m_bins;
+    qint64 m_binWidth;
+    // last bin written to, -1 before the first sample
+    qint64 m_lastBin;
+    qint64 m_firstTime;
+    qint64 m_lastTime;
+};
+
+#endif // SAMPLERING_H
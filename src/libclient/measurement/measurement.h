@@ -59,6 +59,9 @@ signals:
     void started();
     void finished();
     void error(const QString &message);
+    // intermediate result of a long-running measurement, added to the
+    // report right away; result() is still collected after finished()
+    void resultReady(const Result &result);
 
 protected:
     class Private;
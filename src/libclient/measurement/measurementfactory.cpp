@@ -1,13 +1,19 @@
 #include "measurementfactory.h"
 #include "btc/btc_plugin.h"
 #include "http/httpdownload_plugin.h"
+#include "http/httpupload_plugin.h"
 #include "upnp/upnp_plugin.h"
 #include "ping/ping_plugin.h"
 #include "dnslookup/dnslookup_plugin.h"
 #include "reverse_dnslookup/reverseDnslookup_plugin.h"
 #include "packettrains/packettrainsplugin.h"
+#include "abw/abw_plugin.h"
+#include "owd/owd_plugin.h"
+#include "cbr/cbr_plugin.h"
 #include "ping/ping_plugin.h"
 #include "traceroute/traceroute_plugin.h"
+#include "ping_sweep/ping_sweep_plugin.h"
+#include "multipath_traceroute/multipath_traceroute_plugin.h"
 #include "wifilookup/wifilookup_plugin.h"
 #include "../log/logger.h"
 
@@ -23,13 +29,19 @@ public:
         // TODO: Don't link with plugins
         addPlugin(new BulkTransportCapacityPlugin);
         addPlugin(new HTTPDownloadPlugin);
+        addPlugin(new HTTPUploadPlugin);
         addPlugin(new UPnPPlugin);
         addPlugin(new PingPlugin);
         addPlugin(new DnslookupPlugin);
         addPlugin(new ReverseDnslookupPlugin);
         addPlugin(new PacketTrainsPlugin);
+        addPlugin(new AvailableBandwidthPlugin);
+        addPlugin(new OneWayDelayPlugin);
+        addPlugin(new ConstantBitratePlugin);
         addPlugin(new PingPlugin);
         addPlugin(new TraceroutePlugin);
+        addPlugin(new PingSweepPlugin);
+        addPlugin(new MultipathTraceroutePlugin);
         addPlugin(new WifiLookupPlugin);
     }
 
@@ -0,0 +1,839 @@
+#include "multipath_traceroute.h"
+#include "../../log/logger.h"
+#include "../../client.h"
+#include "../../trafficbudgetmanager.h"
+
+#include <QSet>
+#include <QStringList>
+
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/icmp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+
+LOGGER(MultipathTraceroute);
+
+namespace
+{
+    // stop after this many TTLs in a row without any answer
+    const int maxSilentHops = 3;
+
+    // probes carry the TTL they were sent with in the first bytes of the
+    // payload, ICMP errors quote it
+    const quint32 probeTagLength = 4;
+
+#if defined(Q_OS_LINUX)
+    const int maxEvents = 16;
+
+    bool setTtl(int sock, int family, int ttl)
+    {
+        if (family == AF_INET6)
+        {
+            return setsockopt(sock, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &ttl, sizeof(ttl)) == 0;
+        }
+
+        return setsockopt(sock, SOL_IP, IP_TTL, &ttl, sizeof(ttl)) == 0;
+    }
+#endif
+}
+
+QVector<quint32> mda::stoppingPoints(qreal confidence, quint32 maxProbes, quint32 tests)
+{
+    QVector<quint32> points;
+    // each test may only fail with its share of the error
+    qreal error = (1.0 - confidence) / qMax(1u, tests);
+
+    points << 1;
+
+    for (int k = 1; points.last() <= maxProbes; k++)
+    {
+        // p[j]: probability of having seen j of the k + 1 next hops
+        QVector<qreal> p(k + 2);
+        quint32 n = 0;
+
+        p.fill(0.0);
+        p[0] = 1.0;
+
+        while (1.0 - p[k + 1] > error)
+        {
+            for (int j = k + 1; j > 0; j--)
+            {
+                p[j] = (p[j] * j + p[j - 1] * (k + 2 - j)) / (k + 1);
+            }
+
+            p[0] = 0.0;
+            n++;
+        }
+
+        points << n;
+    }
+
+    return points;
+}
+
+MultipathTraceroute::MultipathTraceroute(QObject *parent)
+: Measurement(parent)
+#if defined(Q_OS_LINUX)
+, m_epollFd(-1)
+, m_socket(-1)
+, m_destAddress()
+, m_pendingProbes(0)
+, m_ttl(0)
+#endif
+, currentStatus(Unknown)
+, m_probeCount(0)
+{
+}
+
+MultipathTraceroute::~MultipathTraceroute()
+{
+}
+
+Measurement::Status MultipathTraceroute::status() const
+{
+    return currentStatus;
+}
+
+void MultipathTraceroute::setStatus(Status status)
+{
+    if (currentStatus != status)
+    {
+        currentStatus = status;
+        emit statusChanged(status);
+    }
+}
+
+bool MultipathTraceroute::prepare(NetworkManager *networkManager,
+                                  const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager);
+
+    definition = measurementDefinition.dynamicCast<MultipathTracerouteDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+#if defined(Q_OS_LINUX)
+
+    if (definition->maxTtl == 0 || definition->maxTtl > 255)
+    {
+        setErrorString("max_ttl must be between 1 and 255");
+        return false;
+    }
+
+    if (definition->confidence < 0.5 || definition->confidence > 0.999)
+    {
+        setErrorString("confidence must be between 0.5 and 0.999");
+        return false;
+    }
+
+    if (definition->maxFlows == 0 || definition->maxFlows > 256)
+    {
+        setErrorString("max_flows must be between 1 and 256");
+        return false;
+    }
+
+    if (definition->destinationPort == 0 || definition->destinationPort > 65535 - definition->maxFlows)
+    {
+        setErrorString(QString("destination port must be between 1 and %1").arg(65535 - definition->maxFlows));
+        return false;
+    }
+
+    if (definition->payload > 1400)
+    {
+        setErrorString("payload is too large (> 1400 bytes)");
+        return false;
+    }
+
+    if (definition->receiveTimeout > 60000)
+    {
+        setErrorString("receive timeout is too large (> 60 s)");
+        return false;
+    }
+
+    if (definition->rate == 0 || definition->rate > 10000)
+    {
+        setErrorString("rate must be between 1 and 10000 probes per second");
+        return false;
+    }
+
+    memset(&m_destAddress, 0, sizeof(m_destAddress));
+
+    if (!getAddress(definition->host, &m_destAddress))
+    {
+        setErrorString(QString("could not resolve hostname '%1'").arg(definition->host));
+        return false;
+    }
+
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
+    {
+        setErrorString("not enough traffic available");
+        return false;
+    }
+
+    m_stoppingPoints.clear();
+    m_payload.fill('X', qMax(definition->payload, probeTagLength));
+
+    return true;
+#else
+    setErrorString("multipath_traceroute is not supported on this platform");
+    return false;
+#endif
+}
+
+bool MultipathTraceroute::start()
+{
+    setStatus(MultipathTraceroute::Running);
+
+#if defined(Q_OS_LINUX)
+
+    if (!runTraceroute())
+    {
+        return false;
+    }
+
+    setStatus(MultipathTraceroute::Finished);
+    emit Measurement::finished();
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MultipathTraceroute::stop()
+{
+    return true;
+}
+
+Result MultipathTraceroute::result() const
+{
+    QVariantList hops;
+    bool destinationReached = false;
+    int maxWidth = 0;
+
+    foreach (const MultipathHop &hop, m_hops)
+    {
+        QVariantList interfaces;
+        QVariantList links;
+        QVariantMap res;
+
+        QMapIterator<QString, Statistics> it(hop.interfaces);
+
+        while (it.hasNext())
+        {
+            it.next();
+
+            QVariantMap interface;
+            interface.insert("address", it.key());
+            interface.insert("replies", static_cast<int>(it.value().count()));
+            interface.insert("rtt_avg", it.value().mean());
+            interface.insert("rtt_min", it.value().min());
+            interface.insert("rtt_max", it.value().max());
+            interface.insert("rtt_p50", it.value().quantile(0.5));
+            interfaces << interface;
+        }
+
+        for (int i = 0; i < hop.links.size(); i++)
+        {
+            QVariantMap link;
+            link.insert("from", hop.links.at(i).first);
+            link.insert("to", hop.links.at(i).second);
+            links << link;
+        }
+
+        res.insert("ttl", hop.ttl);
+        res.insert("probes", hop.probes);
+        res.insert("interfaces", interfaces);
+        res.insert("links", links);
+        res.insert("destination", hop.destination);
+        hops << res;
+
+        destinationReached |= hop.destination;
+        maxWidth = qMax(maxWidth, hop.interfaces.size());
+    }
+
+    QVariantMap map;
+    map.insert("host", definition->host);
+    map.insert("results", hops);
+    map.insert("hop_count", hops.size());
+    map.insert("probe_count", m_probeCount);
+    map.insert("max_width", maxWidth);
+    map.insert("destination_reached", destinationReached);
+
+    return Result(map);
+}
+
+quint32 MultipathTraceroute::estimateTraffic() const
+{
+    // a UDP ping per probe, with every TTL using up all flows at worst
+    quint32 est = 2 * 14 + 2 * (8 + definition->payload);  // Ethernet + UDP header + payload
+
+#if defined(Q_OS_LINUX)
+
+    if (m_destAddress.sa.sa_family == AF_INET6)
+    {
+        est += 2 * 40 + 56;  // IPv6 header + ICMPv6 response
+    }
+    else
+#endif
+    {
+        est += 2 * 20 + 36;  // IPv4 header + ICMPv4 response
+    }
+
+    return est * definition->maxTtl * definition->maxFlows;
+}
+
+#if defined(Q_OS_LINUX)
+
+int MultipathTraceroute::initSocket()
+{
+    int n = 1;
+    int family = m_destAddress.sa.sa_family;
+    sockaddr_any src_addr;
+    int sock = socket(family, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+
+    if (sock < 0)
+    {
+        setErrorString(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return -1;
+    }
+
+    memset(&src_addr, 0, sizeof(src_addr));
+    src_addr.sa.sa_family = family;
+    setPort(&src_addr, definition->sourcePort);
+
+    if (family == AF_INET6)
+    {
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &n, sizeof(n)) < 0)
+        {
+            setErrorString(QString("setsockopt IPV6_RECVERR: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            goto cleanup;
+        }
+    }
+    else if (setsockopt(sock, SOL_IP, IP_RECVERR, &n, sizeof(n)) < 0)
+    {
+        setErrorString(QString("setsockopt IP_RECVERR: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
+
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &n, sizeof(n)) < 0)
+    {
+        setErrorString(QString("setsockopt SO_TIMESTAMPNS: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
+
+    // the source port stays the same for all flows
+    if (bind(sock, &src_addr.sa, addressLength(src_addr)) < 0)
+    {
+        setErrorString(QString("bind: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
+
+    return sock;
+
+cleanup:
+    close(sock);
+    return -1;
+}
+
+/*
+ * Multipath Detection Algorithm, one TTL after another: a flow is a fixed
+ * 5-tuple (destination port = base port + flow identifier), so per-flow load
+ * balancers send all probes of a flow along the same path. Probing the same
+ * flows at consecutive TTLs links their interfaces, probeHop() decides which
+ * flows are needed.
+ */
+bool MultipathTraceroute::runTraceroute()
+{
+    struct epoll_event ev;
+    FlowProbe idle = {false, 0, 0, 0, 0};
+    int silentHops = 0;
+    bool result = true;
+
+    m_hops.clear();
+    m_probeCount = 0;
+    m_pendingProbes = 0;
+    m_ttl = 0;
+    m_flowProbes.fill(idle, definition->maxFlows);
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (m_epollFd < 0)
+    {
+        setErrorString(QString("epoll_create: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+
+    m_socket = initSocket();
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLERR;
+    ev.data.fd = m_socket;
+
+    if (m_socket < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_socket, &ev) < 0)
+    {
+        if (m_socket >= 0)
+        {
+            setErrorString(QString("epoll_ctl: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        }
+
+        result = false;
+        goto cleanup;
+    }
+
+    for (quint32 ttl = 1; ttl <= definition->maxTtl; ttl++)
+    {
+        MultipathHop hop;
+
+        hop.ttl = ttl;
+        hop.flowProbed.fill(false, definition->maxFlows);
+        hop.flowInterfaces.fill(QString(), definition->maxFlows);
+        m_hops << hop;
+
+        if (!probeHop(ttl))
+        {
+            result = false;
+            goto cleanup;
+        }
+
+        if (m_hops.last().interfaces.isEmpty())
+        {
+            if (++silentHops == maxSilentHops)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        silentHops = 0;
+
+        // all flows arrived, no path goes on behind the destination
+        if (m_hops.last().destination && m_hops.last().interfaces.size() == 1)
+        {
+            break;
+        }
+    }
+
+cleanup:
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+        m_socket = -1;
+    }
+
+    close(m_epollFd);
+    m_epollFd = -1;
+
+    return result;
+}
+
+/*
+ * Per-vertex stopping rule: the flows of this TTL are grouped by the
+ * interface they reached one TTL before, each of these interfaces is probed
+ * until the stopping point of the next hops found behind it. If there are
+ * not enough flows known to pass an interface, new flows are probed at the
+ * previous TTL first. Flows without an answer at the previous TTL count as
+ * one more interface, at TTL 1 all flows start at the source.
+ *
+ * A flow found this way at the previous TTL has no link to the TTL before,
+ * the interfaces behind the new flows are not tested again.
+ */
+quint32 MultipathTraceroute::stoppingPoint(int found)
+{
+    quint32 tests = 1;
+
+    if (definition->traceConfidence)
+    {
+        // only the interfaces found so far were tested, not all the trace
+        // could have had
+        tests = 0;
+
+        foreach (const MultipathHop &hop, m_hops)
+        {
+            tests += hop.interfaces.size();
+        }
+
+        tests = qMax(1u, tests);
+    }
+
+    if (!m_stoppingPoints.contains(tests))
+    {
+        m_stoppingPoints.insert(tests, mda::stoppingPoints(definition->confidence, definition->maxFlows, tests));
+    }
+
+    const QVector<quint32> &points = m_stoppingPoints[tests];
+    return found < points.size() ? points[found] : definition->maxFlows;
+}
+
+bool MultipathTraceroute::probeHop(quint32 ttl)
+{
+    MultipathHop &hop = m_hops[ttl - 1];
+    const MultipathHop *previous = ttl > 1 ? &m_hops[ttl - 2] : NULL;
+    QSet<QString> exhausted;
+
+    forever
+    {
+        QMap<QString, int> probed;
+        QMap<QString, QSet<QString> > successors;
+        QMap<QString, QList<int> > candidates;
+
+        for (int flow = 0; flow < hop.flowProbed.size(); flow++)
+        {
+            if (previous && !previous->flowProbed[flow])
+            {
+                continue;
+            }
+
+            QString vertex = previous ? previous->flowInterfaces[flow] : QString();
+
+            if (!hop.flowProbed[flow])
+            {
+                candidates[vertex] << flow;
+                continue;
+            }
+
+            probed[vertex]++;
+
+            if (!hop.flowInterfaces[flow].isEmpty())
+            {
+                successors[vertex].insert(hop.flowInterfaces[flow]);
+            }
+        }
+
+        QList<int> batch;
+        QStringList starving;
+        int wanted = 0;
+
+        foreach (const QString &vertex, (probed.keys() + candidates.keys()).toSet())
+        {
+            if (exhausted.contains(vertex))
+            {
+                continue;
+            }
+
+            // a silent next hop is probed like a single one
+            int found = qMax(1, successors.value(vertex).size());
+            int needed = stoppingPoint(found);
+            int missing = needed - probed.value(vertex);
+
+            if (missing <= 0)
+            {
+                continue;
+            }
+
+            QList<int> flows = candidates.value(vertex).mid(0, missing);
+
+            if (flows.isEmpty())
+            {
+                starving << vertex;
+                wanted += missing;
+            }
+
+            batch << flows;
+        }
+
+        if (!batch.isEmpty())
+        {
+            if (!probeFlows(ttl, batch))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (starving.isEmpty())
+        {
+            return true;
+        }
+
+        // the new flows may pass any interface of the previous TTL
+        QList<int> fresh;
+
+        for (int flow = 0; previous && flow < previous->flowProbed.size() && fresh.size() < wanted; flow++)
+        {
+            if (!previous->flowProbed[flow])
+            {
+                fresh << flow;
+            }
+        }
+
+        if (fresh.isEmpty())
+        {
+            // all flows are used up
+            exhausted += starving.toSet();
+            continue;
+        }
+
+        if (!probeFlows(ttl - 1, fresh))
+        {
+            return false;
+        }
+    }
+}
+
+bool MultipathTraceroute::probeFlows(quint32 ttl, const QList<int> &flows)
+{
+    struct epoll_event events[maxEvents];
+    quint64 gap = Q_UINT64_C(1000000000) / definition->rate;
+    quint64 nextSend = monotonicTime();
+    MultipathHop &hop = m_hops[ttl - 1];
+    int next = 0;
+
+    if (ttl != m_ttl)
+    {
+        quint32 tag = htonl(ttl);
+
+        if (!setTtl(m_socket, m_destAddress.sa.sa_family, ttl))
+        {
+            setErrorString(QString("setsockopt TTL: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            return false;
+        }
+
+        memcpy(m_payload.data(), &tag, probeTagLength);
+        m_ttl = ttl;
+    }
+
+    foreach (int flow, flows)
+    {
+        hop.flowProbed[flow] = true;
+    }
+
+    hop.probes += flows.size();
+    m_probeCount += flows.size();
+
+    // answers which are already there are late ones of earlier probes
+    receiveData();
+
+    while (next < flows.size() || m_pendingProbes > 0)
+    {
+        quint64 now = monotonicTime();
+
+        if (next < flows.size() && now >= nextSend)
+        {
+            sendProbe(flows.at(next++));
+
+            // keep the rate, but don't burst if we fell behind
+            nextSend = qMax(nextSend + gap, now);
+            continue;
+        }
+
+        expireProbes(now);
+
+        // sleep until the next probe is due or the next deadline passes
+        quint64 wakeup = next < flows.size() ? nextSend : Q_UINT64_C(0xffffffffffffffff);
+
+        foreach (const FlowProbe &probe, m_flowProbes)
+        {
+            if (probe.pending)
+            {
+                wakeup = qMin(wakeup, probe.deadline);
+            }
+        }
+
+        if (wakeup == Q_UINT64_C(0xffffffffffffffff))
+        {
+            continue;
+        }
+
+        int timeout = wakeup > now ? (wakeup - now + 999999) / 1000000 : 0;
+        int n = epoll_wait(m_epollFd, events, maxEvents, timeout);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            setErrorString(QString("epoll_wait: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            expireProbes(Q_UINT64_C(0xffffffffffffffff));
+            return false;
+        }
+
+        if (n > 0)
+        {
+            receiveData();
+        }
+    }
+
+    return true;
+}
+
+void MultipathTraceroute::sendProbe(int flow)
+{
+    sockaddr_any dest = m_destAddress;
+    FlowProbe &probe = m_flowProbes[flow];
+
+    setPort(&dest, definition->destinationPort + flow);
+
+    probe.sendTime = wallTime();
+
+    if (sendto(m_socket, m_payload.constData(), m_payload.size(), 0, &dest.sa, addressLength(dest)) < 0)
+    {
+        // counts as a lost probe
+        LOG_WARNING(QString("sendto: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return;
+    }
+
+    probe.pending = true;
+    probe.ttl = m_ttl;
+    probe.deadline = monotonicTime() + (quint64)definition->receiveTimeout * 1000000;
+    m_pendingProbes++;
+}
+
+void MultipathTraceroute::receiveData()
+{
+    struct msghdr msg;
+    sockaddr_any from;
+    struct iovec iov;
+    char buf[1500];
+    char control[256];
+    struct cmsghdr *cm;
+    struct sock_extended_err *ee;
+    quint64 recvTime;
+    ssize_t len;
+    bool ignore;
+
+    // drain the error queue and the socket, the socket never blocks
+    forever
+    {
+        ee = NULL;
+        recvTime = 0;
+        ignore = false;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        if ((len = recvmsg(m_socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT)) < 0)
+        {
+            msg.msg_namelen = sizeof(from);
+            msg.msg_controllen = sizeof(control);
+
+            if ((len = recvmsg(m_socket, &msg, MSG_DONTWAIT)) < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG_WARNING(QString("recvmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+                }
+
+                return;
+            }
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPNS)
+            {
+                recvTime = toNsec(*(struct timespec *) CMSG_DATA(cm));
+            }
+            else if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                     (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                ee = (struct sock_extended_err *) CMSG_DATA(cm);
+
+                if (ee->ee_origin == SO_EE_ORIGIN_ICMP)
+                {
+                    ignore = ee->ee_type == ICMP_SOURCE_QUENCH || ee->ee_type == ICMP_REDIRECT;
+                }
+                else if (ee->ee_origin != SO_EE_ORIGIN_ICMP6)
+                {
+                    ignore = true;
+                }
+            }
+        }
+
+        // msg_name is the destination quoted by an ICMP error or the
+        // answering destination itself, its port is the flow identifier
+        int flow = getPort(from) - definition->destinationPort;
+
+        if (ignore || flow < 0 || flow >= m_flowProbes.size() || !sameHost(from, m_destAddress))
+        {
+            continue;
+        }
+
+        FlowProbe &probe = m_flowProbes[flow];
+        quint32 tag = 0;
+
+        // answers of the destination itself don't quote the probe, neither
+        // do routers quoting the UDP header only
+        if (ee && len >= (ssize_t) probeTagLength)
+        {
+            memcpy(&tag, buf, probeTagLength);
+            tag = ntohl(tag);
+        }
+
+        if (tag && tag == probe.lateTtl)
+        {
+            probe.lateTtl = 0;
+            continue;
+        }
+
+        // without the tag a late answer of the flow can't be told apart
+        if (!probe.pending || (tag ? tag != probe.ttl : probe.lateTtl != 0))
+        {
+            continue;
+        }
+
+        MultipathHop &hop = m_hops[probe.ttl - 1];
+        const sockaddr_any *responder = ee ? (const sockaddr_any *) SO_EE_OFFENDER(ee) : &from;
+        QString interface = addressToString(*responder);
+        quint64 rtt = (recvTime ? recvTime : wallTime()) - probe.sendTime;
+
+        hop.interfaces[interface].add(rtt / 1000000.);
+        hop.destination |= sameHost(*responder, m_destAddress);
+
+        // the flow took the link from its interface one TTL before
+        if (probe.ttl > 1 && !m_hops.at(probe.ttl - 2).flowInterfaces[flow].isEmpty())
+        {
+            QPair<QString, QString> link(m_hops.at(probe.ttl - 2).flowInterfaces[flow], interface);
+
+            if (!hop.links.contains(link))
+            {
+                hop.links << link;
+            }
+        }
+
+        hop.flowInterfaces[flow] = interface;
+
+        probe.pending = false;
+        m_pendingProbes--;
+    }
+}
+
+void MultipathTraceroute::expireProbes(quint64 now)
+{
+    for (int flow = 0; flow < m_flowProbes.size(); flow++)
+    {
+        if (m_flowProbes[flow].pending && m_flowProbes[flow].deadline <= now)
+        {
+            // lost probes only show up in the probe count of the hop
+            m_flowProbes[flow].pending = false;
+            m_flowProbes[flow].lateTtl = m_flowProbes[flow].ttl;
+            m_pendingProbes--;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef MULTIPATH_TRACEROUTE_H
+#define MULTIPATH_TRACEROUTE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QPair>
+
+#include "../measurement.h"
+#include "../statistics.h"
+#include "../ping/ping.h"
+#include "multipath_traceroute_definition.h"
+
+namespace mda
+{
+    /*
+     * Stopping rule of the Multipath Detection Algorithm: after finding k
+     * next hops of an interface, keep probing it until k + 1 equally likely
+     * next hops would have shown up with the given confidence. The
+     * confidence holds for all tests together (Bonferroni correction), one
+     * test is a single interface.
+     * points[k] is the number of probes, the list ends with the first one
+     * above maxProbes.
+     */
+    QVector<quint32> stoppingPoints(qreal confidence, quint32 maxProbes, quint32 tests = 1);
+}
+
+// the interfaces answering at one TTL and their links to the previous TTL
+struct MultipathHop
+{
+    int ttl;
+    quint32 probes;
+    // round trip times in msec per interface address
+    QMap<QString, Statistics> interfaces;
+    QList<QPair<QString, QString> > links;
+    bool destination;
+    // indexed by the flow identifier, the interface is empty if the flow
+    // was not answered
+    QVector<bool> flowProbed;
+    QVector<QString> flowInterfaces;
+
+    MultipathHop()
+    : ttl(0)
+    , probes(0)
+    , destination(false)
+    {}
+};
+
+class MultipathTraceroute : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit MultipathTraceroute(QObject *parent = 0);
+    ~MultipathTraceroute();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private:
+    quint32 estimateTraffic() const;
+    void setStatus(Status status);
+
+#if defined(Q_OS_LINUX)
+    struct FlowProbe
+    {
+        bool pending;
+        quint32 ttl;
+        // TTL of an earlier probe of the flow which expired, its answer may
+        // still come; 0 if there is none
+        quint32 lateTtl;
+        quint64 sendTime;
+        quint64 deadline;
+    };
+
+    int initSocket();
+    bool runTraceroute();
+    bool probeHop(quint32 ttl);
+    bool probeFlows(quint32 ttl, const QList<int> &flows);
+    void sendProbe(int flow);
+    void receiveData();
+    void expireProbes(quint64 now);
+    quint32 stoppingPoint(int found);
+
+    int m_epollFd;
+    int m_socket;
+    sockaddr_any m_destAddress;
+    // indexed by the flow identifier
+    QVector<FlowProbe> m_flowProbes;
+    quint32 m_pendingProbes;
+    // TTL of the socket, 0 before the first probe
+    quint32 m_ttl;
+    // probes needed to rule out one more next hop after finding k of them,
+    // by the number of tests they are corrected for
+    QHash<quint32, QVector<quint32> > m_stoppingPoints;
+#endif
+
+    MultipathTracerouteDefinitionPtr definition;
+    Status currentStatus;
+    QList<MultipathHop> m_hops;
+    quint32 m_probeCount;
+    QByteArray m_payload;
+
+signals:
+    void statusChanged(Status status);
+};
+
+#endif // MULTIPATH_TRACEROUTE_H
@@ -0,0 +1,57 @@
+#include "multipath_traceroute_definition.h"
+
+MultipathTracerouteDefinition::MultipathTracerouteDefinition(const QString &host, const quint32 &maxTtl,
+                                                             const qreal &confidence, const quint32 &maxFlows,
+                                                             const quint32 &rate, const quint32 &receiveTimeout,
+                                                             const quint16 &destinationPort,
+                                                             const quint16 &sourcePort, const quint32 &payload,
+                                                             const bool &traceConfidence)
+: host(host)
+, maxTtl(maxTtl)
+, confidence(confidence)
+, maxFlows(maxFlows)
+, rate(rate)
+, receiveTimeout(receiveTimeout)
+, destinationPort(destinationPort)
+, sourcePort(sourcePort)
+, payload(payload)
+, traceConfidence(traceConfidence)
+{
+
+}
+
+MultipathTracerouteDefinition::~MultipathTracerouteDefinition()
+{
+
+}
+
+MultipathTracerouteDefinitionPtr MultipathTracerouteDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+    return MultipathTracerouteDefinitionPtr(new MultipathTracerouteDefinition(map.value("host", "").toString(),
+                                                                              map.value("max_ttl", 30).toUInt(),
+                                                                              map.value("confidence", 0.95).toDouble(),
+                                                                              map.value("max_flows", 64).toUInt(),
+                                                                              map.value("rate", 100).toUInt(),
+                                                                              map.value("timeout", 1000).toUInt(),
+                                                                              map.value("destination_port", 33434).toUInt(),
+                                                                              map.value("source_port", 0).toUInt(),
+                                                                              map.value("payload", 74).toUInt(),
+                                                                              map.value("trace_confidence", false).toBool()));
+}
+
+QVariant MultipathTracerouteDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("host", host);
+    map.insert("max_ttl", maxTtl);
+    map.insert("confidence", confidence);
+    map.insert("max_flows", maxFlows);
+    map.insert("rate", rate);
+    map.insert("timeout", receiveTimeout);
+    map.insert("destination_port", destinationPort);
+    map.insert("source_port", sourcePort);
+    map.insert("payload", payload);
+    map.insert("trace_confidence", traceConfidence);
+    return map;
+}
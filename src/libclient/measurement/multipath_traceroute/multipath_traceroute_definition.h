@@ -0,0 +1,46 @@
+#ifndef MULTIPATH_TRACEROUTE_DEFINITION_H
+#define MULTIPATH_TRACEROUTE_DEFINITION_H
+
+#include "../measurementdefinition.h"
+#include "../../types.h"
+
+class MultipathTracerouteDefinition;
+
+typedef QSharedPointer<MultipathTracerouteDefinition> MultipathTracerouteDefinitionPtr;
+typedef QList<MultipathTracerouteDefinitionPtr> MultipathTracerouteDefinitionList;
+
+class MultipathTracerouteDefinition : public MeasurementDefinition
+{
+public:
+    ~MultipathTracerouteDefinition();
+    MultipathTracerouteDefinition(const QString &host, const quint32 &maxTtl, const qreal &confidence,
+                                  const quint32 &maxFlows, const quint32 &rate, const quint32 &receiveTimeout,
+                                  const quint16 &destinationPort, const quint16 &sourcePort,
+                                  const quint32 &payload, const bool &traceConfidence);
+
+    // Storage
+    static MultipathTracerouteDefinitionPtr fromVariant(const QVariant &variant);
+
+    // Getters
+    QString host;
+    quint32 maxTtl;
+    // probability to find all next hops of an interface, or with
+    // traceConfidence of all interfaces of the trace
+    qreal confidence;
+    // upper bound of flows probed per TTL
+    quint32 maxFlows;
+    // probes per second
+    quint32 rate;
+    quint32 receiveTimeout;
+    // the flow identifier is added to the destination port
+    quint16 destinationPort;
+    quint16 sourcePort;
+    quint32 payload;
+    // correct the confidence for the interfaces found so far, costs probes
+    bool traceConfidence;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // MULTIPATH_TRACEROUTE_DEFINITION_H
@@ -0,0 +1,21 @@
+#include "multipath_traceroute_plugin.h"
+#include "multipath_traceroute.h"
+#include "multipath_traceroute_definition.h"
+
+QStringList MultipathTraceroutePlugin::measurements() const
+{
+    return QStringList()
+           << "multipath_traceroute";
+}
+
+MeasurementPtr MultipathTraceroutePlugin::createMeasurement(const QString &name)
+{
+    Q_UNUSED(name);
+    return MeasurementPtr(new MultipathTraceroute);
+}
+
+MeasurementDefinitionPtr MultipathTraceroutePlugin::createMeasurementDefinition(const QString &name, const QVariant &data)
+{
+    Q_UNUSED(name);
+    return MultipathTracerouteDefinition::fromVariant(data);
+}
@@ -0,0 +1,18 @@
+#ifndef MULTIPATH_TRACEROUTE_PLUGIN_H
+#define MULTIPATH_TRACEROUTE_PLUGIN_H
+
+#include "../measurement.h"
+#include "../measurementdefinition.h"
+#include "../measurementplugin.h"
+
+class MultipathTraceroutePlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // MULTIPATH_TRACEROUTE_PLUGIN_H
@@ -0,0 +1,40 @@
+#include "owd_definition.h"
+
+OneWayDelayDefinition::OneWayDelayDefinition(const QString &host, quint16 port, quint32 count, quint16 rate,
+                                             quint16 packetSize, quint32 timeout)
+: host(host)
+, port(port)
+, count(count)
+, rate(rate)
+, packetSize(packetSize)
+, timeout(timeout)
+{
+}
+
+OneWayDelayDefinition::~OneWayDelayDefinition()
+{
+}
+
+QVariant OneWayDelayDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("host", host);
+    map.insert("port", port);
+    map.insert("count", count);
+    map.insert("rate", rate);
+    map.insert("packet_size", packetSize);
+    map.insert("timeout", timeout);
+    return map;
+}
+
+OneWayDelayDefinitionPtr OneWayDelayDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+
+    return OneWayDelayDefinitionPtr(new OneWayDelayDefinition(map.value("host", "").toString(),
+                                                              map.value("port", 5106).toUInt(),
+                                                              map.value("count", 100).toUInt(),
+                                                              map.value("rate", 10).toUInt(),
+                                                              map.value("packet_size", 128).toUInt(),
+                                                              map.value("timeout", 2000).toUInt()));
+}
@@ -0,0 +1,37 @@
+#ifndef OWD_DEFINITION_H
+#define OWD_DEFINITION_H
+
+#include "../measurementdefinition.h"
+
+class OneWayDelayDefinition;
+
+typedef QSharedPointer<OneWayDelayDefinition> OneWayDelayDefinitionPtr;
+typedef QList<OneWayDelayDefinitionPtr> OneWayDelayDefinitionList;
+
+class OneWayDelayDefinition : public MeasurementDefinition
+{
+public:
+    OneWayDelayDefinition(const QString &host, quint16 port, quint32 count, quint16 rate, quint16 packetSize,
+                          quint32 timeout);
+    ~OneWayDelayDefinition();
+
+    // Storage
+    static OneWayDelayDefinitionPtr fromVariant(const QVariant &variant);
+
+    // Getters
+    QString host;
+    quint16 port;
+    // packets to send
+    quint32 count;
+    // packets per second, at most 1000
+    quint16 rate;
+    // UDP payload, at least the size of a reflected packet
+    quint16 packetSize;
+    // ms to wait for replies after the last packet
+    quint32 timeout;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // OWD_DEFINITION_H
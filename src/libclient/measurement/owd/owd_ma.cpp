@@ -0,0 +1,335 @@
+#include "owd_ma.h"
+#include "owd_packet.h"
+#include "../statistics.h"
+#include "../../log/logger.h"
+#include "../../network/networkmanager.h"
+#include "../../client.h"
+#include "../../controller/ntpcontroller.h"
+#include "../../trafficbudgetmanager.h"
+
+#include <QPair>
+
+LOGGER(OneWayDelayMA);
+
+namespace
+{
+    // delays in the order they were sent, lost packets skipped
+    QVariantMap directionResult(const QVector<qint64> &delays, qint64 lost, qint64 sent, int reordered)
+    {
+        Statistics statistics;
+        Statistics jitter;
+
+        for (int i = 0; i < delays.size(); i++)
+        {
+            statistics.add(delays.at(i));
+
+            // IPDV between consecutive packets (RFC 5481)
+            if (i > 0)
+            {
+                jitter.add(qAbs(delays.at(i) - delays.at(i - 1)));
+            }
+        }
+
+        // with clock offsets the delays may be negative, which the quantile
+        // sketch counts as zero
+        QVector<qint64> sorted = delays;
+        qSort(sorted);
+        qreal median = 0;
+
+        if (!sorted.isEmpty())
+        {
+            int middle = sorted.size() / 2;
+            median = sorted.size() % 2 ? sorted.at(middle) : (sorted.at(middle - 1) + sorted.at(middle)) / 2.0;
+        }
+
+        QVariantMap map;
+        map.insert("delay_min_ns", statistics.min());
+        map.insert("delay_avg_ns", statistics.mean());
+        map.insert("delay_median_ns", median);
+        map.insert("delay_max_ns", statistics.max());
+        map.insert("jitter_ns", jitter.mean());
+        map.insert("jitter_max_ns", jitter.max());
+        map.insert("lost", lost);
+        map.insert("loss", sent > 0 ? (qreal)lost / sent : 0.0);
+        map.insert("reordered", reordered);
+        return map;
+    }
+}
+
+OneWayDelayMA::OneWayDelayMA()
+: m_udpSocket(NULL)
+, m_clockOffset(0)
+, m_synchronized(false)
+, m_peerSynchronized(false)
+, m_sent(0)
+, m_replies(0)
+, m_maxReflectorSeq(-1)
+, m_reorderedBackward(0)
+, m_duplicates(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status OneWayDelayMA::status() const
+{
+    return Unknown;
+}
+
+bool OneWayDelayMA::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    definition = measurementDefinition.dynamicCast<OneWayDelayDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    if (definition->count == 0 || definition->rate == 0 ||
+        definition->packetSize < owd::reflectorHeaderSize)
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
+    QString hostname = QString("%1:%2").arg(definition->host).arg(definition->port);
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(networkManager->establishConnection(hostname, taskId(), "owd_mp",
+                                                                                 definition, NetworkManager::UdpSocket));
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+
+    if (!m_pacer.setDestination(m_udpSocket->socketDescriptor(), definition->host, definition->port))
+    {
+        setErrorString(QString("Unable to resolve %1").arg(definition->host));
+        return false;
+    }
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    m_receiver.setSocket(m_udpSocket);
+
+    // both directions
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(2 * definition->count * definition->packetSize))
+    {
+        setErrorString("not enough traffic available");
+        return false;
+    }
+
+    NtpController *ntp = Client::instance()->ntpController();
+    m_clockOffset = ntp->offsetMsecs() * 1000000;
+    m_synchronized = ntp->isSynchronized();
+
+    if (!m_synchronized)
+    {
+        LOG_WARNING("Clock not synchronized, one-way delays include the clock offset");
+    }
+
+    m_buffer.fill(0, definition->packetSize);
+
+    m_sendTimes.fill(0, definition->count);
+    m_reflectorReceiveTimes.fill(0, definition->count);
+    m_reflectorSendTimes.fill(0, definition->count);
+    m_receiveTimes.fill(0, definition->count);
+    m_reflectorSeqs.fill(0, definition->count);
+
+    return true;
+}
+
+bool OneWayDelayMA::start()
+{
+    m_sent = 0;
+    m_replies = 0;
+    m_maxReflectorSeq = -1;
+    m_reorderedBackward = 0;
+    m_duplicates = 0;
+    m_peerSynchronized = false;
+
+    m_timeout.setInterval(definition->timeout);
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, SIGNAL(timeout()), this, SLOT(finish()));
+
+    m_receiver.notify(this, SLOT(readPendingDatagrams()));
+
+    m_pacer.calibrate();
+
+    // every packet has a fixed departure time, a late one does not shift
+    // the rest of the stream
+    qint64 interval = 1000000000LL / definition->rate;
+    qint64 deadline = Pacer::now() + m_pacer.spinThreshold();
+
+    for (quint32 i = 0; i < definition->count; i++)
+    {
+        // the replies carry kernel timestamps, reading them between the
+        // packets only keeps the socket buffer from overflowing
+        readPendingDatagrams();
+
+        m_pacer.waitUntil(deadline);
+        sendPacket();
+        deadline += interval;
+    }
+
+    m_timeout.start();
+    readPendingDatagrams();
+
+    return true;
+}
+
+bool OneWayDelayMA::stop()
+{
+    m_timeout.stop();
+
+    m_receiver.stopNotifying();
+
+    return true;
+}
+
+void OneWayDelayMA::sendPacket()
+{
+    qint64 time = owd::now() + m_clockOffset;
+    owd::writeSenderHeader(m_buffer.data(), m_sent, time, m_synchronized);
+
+    if (m_pacer.send(m_buffer.constData(), m_buffer.size()))
+    {
+        m_sendTimes[m_sent] = time;
+    }
+
+    m_sent++;
+}
+
+void OneWayDelayMA::readPendingDatagrams()
+{
+    int count;
+
+    while ((count = m_receiver.receive()) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (m_receiver.size(i) < owd::reflectorHeaderSize)
+            {
+                continue;
+            }
+
+            owd::ReflectorHeader header = owd::readReflectorHeader(m_receiver.data(i));
+
+            if (header.senderSeq >= m_sent)
+            {
+                continue;
+            }
+
+            if (m_receiveTimes.at(header.senderSeq) != 0)
+            {
+                m_duplicates++;
+                continue;
+            }
+
+            m_receiveTimes[header.senderSeq] = m_receiver.timestamp(i) + m_clockOffset;
+            m_reflectorReceiveTimes[header.senderSeq] = header.receiveTime;
+            m_reflectorSendTimes[header.senderSeq] = header.time;
+            m_reflectorSeqs[header.senderSeq] = header.seq;
+            m_peerSynchronized = header.synchronized;
+            m_replies++;
+
+            // the reflector numbers its replies in the order it sent them
+            if ((qint64)header.seq < m_maxReflectorSeq)
+            {
+                m_reorderedBackward++;
+            }
+            else
+            {
+                m_maxReflectorSeq = header.seq;
+            }
+        }
+    }
+
+    if (m_sent == definition->count && m_replies == m_sent)
+    {
+        finish();
+    }
+}
+
+void OneWayDelayMA::finish()
+{
+    stop();
+    emit finished();
+}
+
+void OneWayDelayMA::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+Result OneWayDelayMA::result() const
+{
+    QVector<qint64> forward;
+    QVector<qint64> backward;
+    QList<QPair<quint32, quint32> > reflected;
+    Statistics rtt;
+
+    for (quint32 i = 0; i < m_sent; i++)
+    {
+        if (m_receiveTimes.at(i) == 0 || m_sendTimes.at(i) == 0)
+        {
+            continue;
+        }
+
+        forward.append(m_reflectorReceiveTimes.at(i) - m_sendTimes.at(i));
+        backward.append(m_receiveTimes.at(i) - m_reflectorSendTimes.at(i));
+        rtt.add((m_receiveTimes.at(i) - m_sendTimes.at(i)) - (m_reflectorSendTimes.at(i) - m_reflectorReceiveTimes.at(i)));
+        reflected.append(qMakePair(m_reflectorSeqs.at(i), i));
+    }
+
+    // packets overtaking others on the way to the reflector got a lower
+    // sequence number there
+    qSort(reflected);
+
+    int reorderedForward = 0;
+    qint64 maxSeq = -1;
+
+    for (int i = 0; i < reflected.size(); i++)
+    {
+        if ((qint64)reflected.at(i).second < maxSeq)
+        {
+            reorderedForward++;
+        }
+        else
+        {
+            maxSeq = reflected.at(i).second;
+        }
+    }
+
+    // replies lost after the last one received count as lost on the way to
+    // the reflector
+    qint64 reflectorReceived = m_maxReflectorSeq + 1;
+
+    QVariantMap map;
+    map.insert("sent", m_sent);
+    map.insert("received", m_replies);
+    map.insert("duplicates", m_duplicates);
+    map.insert("forward", directionResult(forward, qMax((qint64)m_sent - reflectorReceived, (qint64)0), m_sent,
+                                          reorderedForward));
+    map.insert("backward", directionResult(backward, qMax(reflectorReceived - m_replies, (qint64)0),
+                                           reflectorReceived, m_reorderedBackward));
+    map.insert("rtt_min_ns", rtt.min());
+    map.insert("rtt_avg_ns", rtt.mean());
+    map.insert("rtt_max_ns", rtt.max());
+    map.insert("clock_offset_ms", m_clockOffset / 1000000);
+    map.insert("synchronized", m_synchronized && m_peerSynchronized);
+    map.insert("kernel_timestamps", m_receiver.kernelTimestamps());
+
+    return Result(map, definition->measurementUuid);
+}
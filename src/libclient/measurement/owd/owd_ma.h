@@ -0,0 +1,72 @@
+#ifndef OWD_MA_H
+#define OWD_MA_H
+
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "../measurement.h"
+#include "../packettrains/pacer.h"
+#include "../packettrains/receiver.h"
+#include "owd_definition.h"
+
+/*
+ * Sends a stream of timestamped test packets to the MP, which reflects them
+ * with its receive and transmit timestamps (TWAMP-Light). Delays in either
+ * direction are as accurate as the NTP synchronization of both ends, the
+ * round-trip time, jitter, loss and reordering are not affected by it.
+ */
+class OneWayDelayMA : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit OneWayDelayMA();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void readPendingDatagrams();
+    void finish();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    void sendPacket();
+
+    OneWayDelayDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Pacer m_pacer;
+    Receiver m_receiver;
+    QByteArray m_buffer;
+
+    // ns added to the local clock
+    qint64 m_clockOffset;
+    bool m_synchronized;
+    bool m_peerSynchronized;
+
+    // waits for the last replies
+    QTimer m_timeout;
+
+    quint32 m_sent;
+    quint32 m_replies;
+
+    // indexed by the sequence number of the sender, ns since the epoch on
+    // the NTP corrected clocks; 0 if no reply came
+    QVector<qint64> m_sendTimes;
+    QVector<qint64> m_reflectorReceiveTimes;
+    QVector<qint64> m_reflectorSendTimes;
+    QVector<qint64> m_receiveTimes;
+    QVector<quint32> m_reflectorSeqs;
+
+    // the reflector counts every packet it got
+    qint64 m_maxReflectorSeq;
+    int m_reorderedBackward;
+    int m_duplicates;
+};
+
+#endif // OWD_MA_H
@@ -0,0 +1,132 @@
+#include "owd_mp.h"
+#include "owd_packet.h"
+#include "../../log/logger.h"
+#include "../../client.h"
+#include "../../controller/ntpcontroller.h"
+
+LOGGER(OneWayDelayMP);
+
+namespace
+{
+    // ms without packets before giving up
+    const int minTimeout = 5000;
+}
+
+OneWayDelayMP::OneWayDelayMP()
+: m_udpSocket(NULL)
+, m_clockOffset(0)
+, m_synchronized(false)
+, m_reflected(0)
+{
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+Measurement::Status OneWayDelayMP::status() const
+{
+    return Unknown;
+}
+
+bool OneWayDelayMP::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager);
+
+    definition = measurementDefinition.dynamicCast<OneWayDelayDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+    m_udpSocket = qobject_cast<QUdpSocket *>(peerSocket());
+
+    if (!m_udpSocket)
+    {
+        setErrorString("Preparation failed");
+        return false;
+    }
+
+    m_udpSocket->setParent(this);
+
+    connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
+            SLOT(handleError(QAbstractSocket::SocketError)));
+
+    m_receiver.setSocket(m_udpSocket);
+
+    NtpController *ntp = Client::instance()->ntpController();
+    m_clockOffset = ntp->offsetMsecs() * 1000000;
+    m_synchronized = ntp->isSynchronized();
+
+    m_reply.fill(0, qMax((int)definition->packetSize, owd::reflectorHeaderSize));
+    m_reflected = 0;
+
+    return true;
+}
+
+bool OneWayDelayMP::start()
+{
+    // Timeout for "nothing happens"
+    connect(&m_timeout, SIGNAL(timeout()), this, SIGNAL(finished()));
+    m_timeout.setInterval(qMax(minTimeout, 3000 / qMax((int)definition->rate, 1)));
+    m_timeout.setSingleShot(true);
+    m_timeout.start();
+
+    m_receiver.notify(this, SLOT(readPendingDatagrams()));
+
+    return true;
+}
+
+bool OneWayDelayMP::stop()
+{
+    m_timeout.stop();
+
+    m_receiver.stopNotifying();
+
+    return true;
+}
+
+void OneWayDelayMP::readPendingDatagrams()
+{
+    m_timeout.start();
+
+    int count;
+
+    while ((count = m_receiver.receive()) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (m_receiver.size(i) < owd::senderHeaderSize)
+            {
+                continue;
+            }
+
+            owd::writeReflectorHeader(m_reply.data(), m_reflected, owd::now() + m_clockOffset, m_synchronized,
+                                      m_receiver.timestamp(i) + m_clockOffset, m_receiver.data(i));
+            m_udpSocket->writeDatagram(m_reply, m_receiver.sender(i), m_receiver.senderPort(i));
+            m_reflected++;
+        }
+    }
+}
+
+void OneWayDelayMP::handleError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+    {
+        return;
+    }
+
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    emit error(QString("Socket error: %1").arg(socket->errorString()));
+}
+
+Result OneWayDelayMP::result() const
+{
+    QVariantMap map;
+    map.insert("reflected", m_reflected);
+    map.insert("clock_offset_ms", m_clockOffset / 1000000);
+    map.insert("synchronized", m_synchronized);
+    map.insert("kernel_timestamps", m_receiver.kernelTimestamps());
+
+    return Result(map, getMeasurementUuid());
+}
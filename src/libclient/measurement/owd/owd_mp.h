@@ -0,0 +1,45 @@
+#ifndef OWD_MP_H
+#define OWD_MP_H
+
+#include <QTimer>
+#include <QUdpSocket>
+
+#include "../measurement.h"
+#include "../packettrains/receiver.h"
+#include "owd_definition.h"
+
+// reflects every test packet with its own receive and transmit timestamps
+class OneWayDelayMP : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit OneWayDelayMP();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private slots:
+    void readPendingDatagrams();
+    void handleError(QAbstractSocket::SocketError socketError);
+
+private:
+    OneWayDelayDefinitionPtr definition;
+    QUdpSocket *m_udpSocket;
+    Receiver m_receiver;
+    QByteArray m_reply;
+
+    // ns added to the local clock
+    qint64 m_clockOffset;
+    bool m_synchronized;
+
+    quint32 m_reflected;
+
+    QTimer m_timeout;
+};
+
+#endif // OWD_MP_H
@@ -0,0 +1,105 @@
+#include "owd_packet.h"
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include <string.h>
+
+#if !defined(Q_OS_WIN)
+#include <time.h>
+#endif
+
+namespace
+{
+    // seconds from 1900 (NTP) to 1970 (Unix)
+    const quint64 ntpEpochOffset = Q_UINT64_C(2208988800);
+
+    // S bit for a synchronized clock, multiplier 1 as a zero one is invalid
+    const quint16 synchronizedFlag = 0x8000;
+    const quint16 errorMultiplier = 0x0001;
+
+    quint16 errorEstimate(bool synchronized)
+    {
+        return (synchronized ? synchronizedFlag : 0) | errorMultiplier;
+    }
+
+    void write32(char *data, quint32 value)
+    {
+        qToBigEndian(value, reinterpret_cast<uchar *>(data));
+    }
+
+    void write64(char *data, quint64 value)
+    {
+        qToBigEndian(value, reinterpret_cast<uchar *>(data));
+    }
+
+    quint32 read32(const char *data)
+    {
+        return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data));
+    }
+
+    quint64 read64(const char *data)
+    {
+        return qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(data));
+    }
+}
+
+qint64 owd::now()
+{
+#if defined(Q_OS_WIN)
+    return QDateTime::currentMSecsSinceEpoch() * 1000000;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return (qint64)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+quint64 owd::toNtp(qint64 time)
+{
+    quint64 seconds = time / 1000000000 + ntpEpochOffset;
+    quint64 fraction = ((quint64)(time % 1000000000) << 32) / 1000000000;
+
+    return (seconds << 32) | fraction;
+}
+
+qint64 owd::fromNtp(quint64 timestamp)
+{
+    qint64 seconds = (qint64)(timestamp >> 32) - ntpEpochOffset;
+    qint64 ns = ((timestamp & Q_UINT64_C(0xffffffff)) * 1000000000 + Q_UINT64_C(0x80000000)) >> 32;
+
+    return seconds * 1000000000 + ns;
+}
+
+void owd::writeSenderHeader(char *data, quint32 seq, qint64 time, bool synchronized)
+{
+    write32(data, seq);
+    write64(data + 4, toNtp(time));
+    qToBigEndian(errorEstimate(synchronized), reinterpret_cast<uchar *>(data + 12));
+}
+
+void owd::writeReflectorHeader(char *data, quint32 seq, qint64 time, bool synchronized, qint64 receiveTime,
+                               const char *sender)
+{
+    memset(data, 0, reflectorHeaderSize);
+    write32(data, seq);
+    write64(data + 4, toNtp(time));
+    qToBigEndian(errorEstimate(synchronized), reinterpret_cast<uchar *>(data + 12));
+    write64(data + 16, toNtp(receiveTime));
+    memcpy(data + 24, sender, senderHeaderSize);
+    // the TTL of the received packet is not known
+    data[40] = (char)255;
+}
+
+owd::ReflectorHeader owd::readReflectorHeader(const char *data)
+{
+    ReflectorHeader header;
+    header.seq = read32(data);
+    header.time = fromNtp(read64(data + 4));
+    header.synchronized = qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(data + 12)) & synchronizedFlag;
+    header.receiveTime = fromNtp(read64(data + 16));
+    header.senderSeq = read32(data + 24);
+    header.senderTime = fromNtp(read64(data + 28));
+
+    return header;
+}
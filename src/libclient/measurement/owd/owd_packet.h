@@ -0,0 +1,42 @@
+#ifndef OWD_PACKET_H
+#define OWD_PACKET_H
+
+#include <QtGlobal>
+
+/*
+ * Test packets in the layout of TWAMP (RFC 5357) in unauthenticated mode,
+ * so a TWAMP-Light reflector could answer them as well. Timestamps are
+ * 64 bit NTP timestamps on the wire and ns since the epoch in here.
+ */
+namespace owd
+{
+    // sequence number, timestamp, error estimate
+    const int senderHeaderSize = 14;
+    // own sequence number, timestamp and error estimate, receive timestamp,
+    // the sender's sequence number, timestamp and error estimate and TTL
+    const int reflectorHeaderSize = 41;
+
+    struct ReflectorHeader
+    {
+        quint32 seq;
+        qint64 time;
+        bool synchronized;
+        qint64 receiveTime;
+        quint32 senderSeq;
+        qint64 senderTime;
+    };
+
+    // ns since the epoch on the real time clock
+    qint64 now();
+
+    quint64 toNtp(qint64 time);
+    qint64 fromNtp(quint64 timestamp);
+
+    void writeSenderHeader(char *data, quint32 seq, qint64 time, bool synchronized);
+    // sender is the packet being reflected
+    void writeReflectorHeader(char *data, quint32 seq, qint64 time, bool synchronized, qint64 receiveTime,
+                              const char *sender);
+    ReflectorHeader readReflectorHeader(const char *data);
+}
+
+#endif // OWD_PACKET_H
@@ -0,0 +1,33 @@
+#include "owd_plugin.h"
+#include "owd_ma.h"
+#include "owd_mp.h"
+#include "owd_definition.h"
+
+QStringList OneWayDelayPlugin::measurements() const
+{
+    return QStringList()
+           << "owd_ma"
+           << "owd_mp";
+}
+
+MeasurementPtr OneWayDelayPlugin::createMeasurement(const QString &name)
+{
+    if (name == "owd_ma")
+    {
+        return MeasurementPtr(new OneWayDelayMA);
+    }
+
+    if (name == "owd_mp")
+    {
+        return MeasurementPtr(new OneWayDelayMP);
+    }
+
+    return MeasurementPtr();
+}
+
+MeasurementDefinitionPtr OneWayDelayPlugin::createMeasurementDefinition(const QString &name,
+                                                                        const QVariant &data)
+{
+    Q_UNUSED(name);
+    return OneWayDelayDefinition::fromVariant(data);
+}
@@ -0,0 +1,16 @@
+#ifndef OWD_PLUGIN_H
+#define OWD_PLUGIN_H
+
+#include "../measurementplugin.h"
+
+class OneWayDelayPlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // OWD_PLUGIN_H
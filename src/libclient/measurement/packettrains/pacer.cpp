@@ -0,0 +1,176 @@
+#include "pacer.h"
+#include "../../log/logger.h"
+#include "../../network/socketutil.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <string.h>
+
+#if defined(Q_OS_WIN)
+#include <chrono>
+#include <thread>
+#else
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+#endif
+
+LOGGER(Pacer);
+
+namespace
+{
+    // spinning for less is not worth a sleep, more wastes a core
+    const qint64 minSpinThreshold = 20000;
+    const qint64 maxSpinThreshold = 2000000;
+
+    const int calibrationSleeps = 20;
+    const qint64 calibrationSleep = 50000;
+
+    const int unacknowledgedCopies = 3;
+}
+
+Pacer::Pacer()
+: m_socket(-1)
+, m_addressLength(0)
+, m_spinThreshold(maxSpinThreshold)
+{
+    memset(&m_address, 0, sizeof(m_address));
+}
+
+bool Pacer::setDestination(qintptr socketDescriptor, const QHostAddress &address, quint16 port)
+{
+    memset(&m_address, 0, sizeof(m_address));
+    m_socket = socketDescriptor;
+
+    if (address.protocol() == QAbstractSocket::IPv4Protocol)
+    {
+        struct sockaddr_in *in = reinterpret_cast<struct sockaddr_in *>(&m_address);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        in->sin_addr.s_addr = htonl(address.toIPv4Address());
+        m_addressLength = sizeof(struct sockaddr_in);
+    }
+    else if (address.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        struct sockaddr_in6 *in6 = reinterpret_cast<struct sockaddr_in6 *>(&m_address);
+        Q_IPV6ADDR ip = address.toIPv6Address();
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        memcpy(&in6->sin6_addr, &ip, sizeof(ip));
+        m_addressLength = sizeof(struct sockaddr_in6);
+    }
+    else
+    {
+        m_addressLength = 0;
+        return false;
+    }
+
+    return m_socket >= 0;
+}
+
+bool Pacer::setDestination(qintptr socketDescriptor, const QString &host, quint16 port)
+{
+    return setDestination(socketDescriptor, resolveHost(host), port);
+}
+
+void Pacer::calibrate()
+{
+    QVector<qint64> late;
+
+    for (int i = 0; i < calibrationSleeps; i++)
+    {
+        qint64 deadline = now() + calibrationSleep;
+        sleepUntil(deadline);
+        late.append(now() - deadline);
+    }
+
+    // the second latest wake-up, one outlier may always happen
+    qSort(late);
+    m_spinThreshold = qBound(minSpinThreshold, 2 * late.at(late.size() - 2), maxSpinThreshold);
+
+    LOG_DEBUG(QString("Spinning for the last %1 us of a wait").arg(m_spinThreshold / 1000));
+}
+
+qint64 Pacer::spinThreshold() const
+{
+    return m_spinThreshold;
+}
+
+qint64 Pacer::now()
+{
+#if defined(Q_OS_WIN)
+    static QElapsedTimer clock;
+
+    if (!clock.isValid())
+    {
+        clock.start();
+    }
+
+    return clock.nsecsElapsed();
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (qint64)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+qint64 Pacer::waitUntil(qint64 deadline)
+{
+    qint64 time = now();
+
+    if (deadline - time > m_spinThreshold)
+    {
+        sleepUntil(deadline - m_spinThreshold);
+    }
+
+    while ((time = now()) < deadline)
+    {
+    }
+
+    return time;
+}
+
+void Pacer::sleepUntil(qint64 deadline)
+{
+#if defined(Q_OS_LINUX)
+    struct timespec time;
+    time.tv_sec = deadline / 1000000000;
+    time.tv_nsec = deadline % 1000000000;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) == EINTR)
+    {
+    }
+#elif defined(Q_OS_WIN)
+    qint64 delay = deadline - now();
+
+    if (delay > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(delay));
+    }
+#else
+    qint64 delay = deadline - now();
+
+    if (delay > 0)
+    {
+        struct timespec time;
+        time.tv_sec = delay / 1000000000;
+        time.tv_nsec = delay % 1000000000;
+        ::nanosleep(&time, NULL);
+    }
+#endif
+}
+
+bool Pacer::send(const char *data, int size)
+{
+    return sendto(m_socket, data, size, 0, reinterpret_cast<const struct sockaddr *>(&m_address),
+                  m_addressLength) == size;
+}
+
+void Pacer::sendUnacknowledged(const char *data, int size)
+{
+    for (int i = 0; i < unacknowledgedCopies; i++)
+    {
+        send(data, size);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <QtGlobal>
+#include <QHostAddress>
+
+#if defined(Q_OS_WIN)
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+/*
+ * Sends datagrams at given times. A wait sleeps until spinThreshold()
+ * before the deadline and spins on the monotonic clock for the rest, the
+ * threshold is calibrated from how late sleeps wake up on this system.
+ *
+ * The destination is resolved once, the datagrams go out with sendto() on
+ * the descriptor of an already bound socket.
+ */
+class Pacer
+{
+public:
+    Pacer();
+
+    bool setDestination(qintptr socketDescriptor, const QHostAddress &address, quint16 port);
+    // looks up host if it is no address, false if it can't be resolved
+    bool setDestination(qintptr socketDescriptor, const QString &host, quint16 port);
+
+    // measures the wake-up latency of sleeps, takes a few ms
+    void calibrate();
+    qint64 spinThreshold() const;
+
+    // ns on the monotonic clock
+    static qint64 now();
+
+    // returns the time it returned at, which is never before deadline
+    qint64 waitUntil(qint64 deadline);
+    bool send(const char *data, int size);
+    // for messages the peer does not acknowledge, like the end of a
+    // measurement: sent a few times so that one of them arrives
+    void sendUnacknowledged(const char *data, int size);
+
+private:
+    static void sleepUntil(qint64 deadline);
+
+    qintptr m_socket;
+    struct sockaddr_storage m_address;
+    int m_addressLength;
+    qint64 m_spinThreshold;
+};
+
+#endif // PACER_H
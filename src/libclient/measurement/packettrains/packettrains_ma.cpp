@@ -3,39 +3,20 @@
 #include "../../network/networkmanager.h"
 #include "../../client.h"
 #include "../../trafficbudgetmanager.h"
+#include "../statistics.h"
 #include <QUdpSocket>
-#include <QElapsedTimer>
 
 #ifdef Q_OS_WIN
 #include <WinSock2.h>
-#include <chrono>
-#include <thread>
 #else
 #include <arpa/inet.h>
 #endif
 
 LOGGER(PacketTrainsMA);
 
-namespace help
-{
-#ifdef Q_OS_WIN
-    inline void nanosleep(qint64 ns)
-    {
-        std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
-    }
-#else
-    inline void nanosleep(qint64 ns)
-    {
-        struct timespec delay;
-        delay.tv_sec = 0;
-        delay.tv_nsec = ns;
-        ::nanosleep(&delay, NULL);
-    }
-#endif
-}
-
 PacketTrainsMA::PacketTrainsMA()
 : m_udpSocket(NULL)
+, m_sendErrors(0)
 {
     connect(this, SIGNAL(error(const QString &)), this,
             SLOT(setErrorString(const QString &)));
@@ -43,45 +24,56 @@ PacketTrainsMA::PacketTrainsMA()
 
 bool PacketTrainsMA::start()
 {
-    QByteArray buffer;
-    buffer.resize(definition->packetSize);
+    QByteArray buffer(definition->packetSize, 0);
 
     struct msg *message = reinterpret_cast<msg *>(buffer.data());
 
-    // calculate disperson
-    quint64 *disp = new quint64[definition->iterations];
-    quint64 R_MIN = definition->rateMin;
-    quint64 R_MAX = definition->rateMax;
-    quint64 delay = definition->delay;
+    // calculate the dispersion for a linearly growing rate
+    m_gaps.clear();
 
     for (int i = 0; i < definition->iterations; i++)
     {
-        disp[i] = (quint64)(definition->packetSize * 1000000000.0 / ((R_MAX - R_MIN) / definition->iterations * i +
-                                                                     R_MIN));  // Linear Rate
+        qreal rate = (qreal)(definition->rateMax - definition->rateMin) / definition->iterations * i + definition->rateMin;
+        m_gaps.append(qMax((qint64)(definition->packetSize * 1000000000.0 / rate), (qint64)1));
     }
 
-    QElapsedTimer timer;
-    timer.start();
+    m_sendTimes.clear();
+    m_sendTimes.reserve(definition->trainLength * definition->iterations);
+    m_sendErrors = 0;
 
-    // send trains
-    for (int i = 0; i < definition->trainLength * definition->iterations; i++)
-    {
-        message->iter = htons(i / definition->trainLength);
-        message->id = i % definition->trainLength;
+    m_pacer.calibrate();
 
-        message->otime = timer.nsecsElapsed();
+    // every packet has a fixed departure time, a late one does not shift
+    // the rest of its train
+    qint64 start = Pacer::now() + m_pacer.spinThreshold();
+    qint64 deadline = start;
 
-        m_udpSocket->writeDatagram(buffer, QHostAddress(definition->host), definition->port);
+    for (int i = 0; i < definition->iterations; i++)
+    {
+        for (int j = 0; j < definition->trainLength; j++)
+        {
+            message->iter = htons(i);
+            message->id = j;
 
-        help::nanosleep(i / definition->trainLength);
+            message->otime = m_pacer.waitUntil(deadline) - start;
 
-        if (i % definition->trainLength == definition->trainLength - 1)
-        {
-            help::nanosleep(delay);
+            if (!m_pacer.send(buffer.constData(), buffer.size()))
+            {
+                m_sendErrors++;
+            }
+
+            // the gaps are what left the socket, not the wake-ups
+            m_sendTimes.append(Pacer::now() - start);
+            deadline += m_gaps.at(i);
         }
+
+        deadline += definition->delay - m_gaps.at(i);
     }
 
-    delete[] disp;
+    if (m_sendErrors > 0)
+    {
+        LOG_WARNING(QString("%1 packets could not be sent").arg(m_sendErrors));
+    }
 
     emit finished();
     return true;
@@ -114,6 +106,14 @@ bool PacketTrainsMA::prepare(NetworkManager *networkManager, const MeasurementDe
         return false;
     }
 
+    if (definition->trainLength == 0 || definition->trainLength > packettrains::maxTrainLength ||
+        definition->iterations == 0 || definition->rateMin == 0 || definition->rateMax < definition->rateMin ||
+        definition->packetSize < sizeof(msg))
+    {
+        setErrorString("Invalid definition");
+        return false;
+    }
+
     QString hostname = QString("%1:%2").arg(definition->host).arg(definition->port);
 
     m_udpSocket = qobject_cast<QUdpSocket *>(networkManager->establishConnection(hostname, taskId(), "packettrains_mp",
@@ -127,6 +127,13 @@ bool PacketTrainsMA::prepare(NetworkManager *networkManager, const MeasurementDe
 
     m_udpSocket->setParent(this);
 
+    // the host is only looked up once and not for every packet
+    if (!m_pacer.setDestination(m_udpSocket->socketDescriptor(), definition->host, definition->port))
+    {
+        setErrorString(QString("Unable to resolve %1").arg(definition->host));
+        return false;
+    }
+
     // Signal for errors
     connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
             SLOT(handleError(QAbstractSocket::SocketError)));
@@ -146,7 +153,44 @@ bool PacketTrainsMA::stop()
     return true;
 }
 
+// the rates are in bytes/s like in the definition
 Result PacketTrainsMA::result() const
 {
-    return Result(QVariantMap(), definition->measurementUuid);
+    QVariantList trains;
+
+    for (int i = 0; i < m_gaps.size(); i++)
+    {
+        int first = i * definition->trainLength;
+        int last = qMin(first + definition->trainLength, m_sendTimes.size()) - 1;
+
+        if (last <= first)
+        {
+            break;
+        }
+
+        Statistics gaps;
+
+        for (int j = first + 1; j <= last; j++)
+        {
+            gaps.add(m_sendTimes.at(j) - m_sendTimes.at(j - 1));
+        }
+
+        QVariantMap train;
+        train.insert("rate_planned", definition->packetSize * 1000000000.0 / m_gaps.at(i));
+        train.insert("rate_sent", definition->packetSize * (last - first) * 1000000000.0 /
+                     qMax(m_sendTimes.at(last) - m_sendTimes.at(first), (qint64)1));
+        train.insert("gap_planned_ns", m_gaps.at(i));
+        train.insert("gap_avg_ns", gaps.mean());
+        train.insert("gap_stdev_ns", gaps.stdev());
+        train.insert("gap_min_ns", gaps.min());
+        train.insert("gap_max_ns", gaps.max());
+        trains.append(train);
+    }
+
+    QVariantMap map;
+    map.insert("trains", trains);
+    map.insert("send_errors", m_sendErrors);
+    map.insert("spin_threshold_ns", m_pacer.spinThreshold());
+
+    return Result(map, definition->measurementUuid);
 }
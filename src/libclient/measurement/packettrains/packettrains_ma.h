@@ -2,9 +2,11 @@
 #define PACKETTRAINS_MA_H
 
 #include <QUdpSocket>
+#include <QVector>
 
 #include "../measurement.h"
 #include "packettrainsdefinition.h"
+#include "pacer.h"
 
 class PacketTrainsMA : public Measurement
 {
@@ -20,6 +22,13 @@ public:
 private:
     PacketTrainsDefinitionPtr definition;
     QUdpSocket *m_udpSocket;
+    Pacer m_pacer;
+
+    // planned gap between the packets of each train in ns
+    QVector<qint64> m_gaps;
+    // when each packet was actually sent, ns since the first one was due
+    QVector<qint64> m_sendTimes;
+    int m_sendErrors;
 
 public slots:
     void handleError(QAbstractSocket::SocketError socketError);
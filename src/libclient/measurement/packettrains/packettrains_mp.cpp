@@ -1,8 +1,5 @@
 #include "packettrains_mp.h"
 #include <QUdpSocket>
-#include <iostream>
-using namespace std;
-#include <iomanip>
 #include "../../log/logger.h"
 #include "../../network/networkmanager.h"
 #include "../../types.h"
@@ -13,10 +10,17 @@ using namespace std;
 #include <arpa/inet.h>
 #endif
 
-LOGGER(PacketTrainsMA);
+LOGGER(PacketTrainsMP);
+
+namespace
+{
+    // a whole train queued up in the kernel must not overflow
+    const int receiveBufferSize = 4 * 1024 * 1024;
+}
 
 PacketTrainsMP::PacketTrainsMP()
 : m_udpSocket(NULL)
+, m_unexpected(0)
 {
     connect(this, SIGNAL(error(const QString &)), this,
             SLOT(setErrorString(const QString &)));
@@ -35,10 +39,7 @@ bool PacketTrainsMP::start()
     m_timer.setSingleShot(true);
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(eval()));
 
-    m_receiveTimer.invalidate();
-
-    // Signal for new packets
-    connect(m_udpSocket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
+    m_receiver.notify(this, SLOT(readPendingDatagrams()));
 
     return true;
 }
@@ -47,41 +48,47 @@ void PacketTrainsMP::readPendingDatagrams()
 {
     m_timeout.start();
 
-    qint64 timestamp;
-    struct msg *message;
-    quint16 iter;
-
-    if (!m_receiveTimer.isValid())
-    {
-        m_receiveTimer.start();
-    }
+    int count;
 
-    while (m_udpSocket->hasPendingDatagrams())
+    while ((count = m_receiver.receive()) > 0)
     {
-        // get time first
-        timestamp = m_receiveTimer.nsecsElapsed();
+        for (int i = 0; i < count; i++)
+        {
+            if (m_receiver.size(i) < (int)sizeof(msg))
+            {
+                m_unexpected++;
+                continue;
+            }
 
-        QByteArray buffer;
-        buffer.resize(m_udpSocket->pendingDatagramSize());
+            const struct msg *message = reinterpret_cast<const msg *>(m_receiver.data(i));
+            int iter = ntohs(message->iter);
+            int id = message->id;
 
-        QHostAddress sender;
-        quint16 senderPort;
+            if (iter >= definition->iterations || id >= definition->trainLength)
+            {
+                m_unexpected++;
+                continue;
+            }
 
-        m_udpSocket->readDatagram(buffer.data(), buffer.size(), &sender, &senderPort);
-        message = reinterpret_cast<msg *>(buffer.data());
+            int index = iter * definition->trainLength + id;
 
-        message->rtime = timestamp;
-        message->r_id = m_packetsReceived++;
+            if (m_receiveTimes.at(index) >= 0)
+            {
+                m_duplicates[iter]++;
+                continue;
+            }
 
-        iter = ntohs(message->iter);
+            if (id < m_highestId.at(iter))
+            {
+                m_reordered[iter]++;
+            }
+            else
+            {
+                m_highestId[iter] = id;
+            }
 
-        if (iter < m_rec.size())
-        {
-            m_rec[iter].append(*message);
-        }
-        else
-        {
-            LOG_WARNING("Something went wrong"); // TODO
+            m_sendTimes[index] = message->otime;
+            m_receiveTimes[index] = m_receiver.timestamp(i);
         }
 
         m_timer.start();
@@ -90,46 +97,72 @@ void PacketTrainsMP::readPendingDatagrams()
 
 void PacketTrainsMP::eval()
 {
-    foreach (const QList<msg> &l, m_rec)
+    m_receiver.stopNotifying();
+
+    m_sendSpeed.clear();
+    m_recvSpeed.clear();
+    m_trains.clear();
+
+    for (int i = 0; i < definition->iterations; i++)
     {
-        quint64 ts_otime[2] = {0}, ts_rtime[2] = {2};
-        double srate = 0, rrate = 0;
+        QVector<qint64> sendTimes;
+        QVector<qint64> receiveTimes;
 
-        for (int i = 0; i < l.size(); i++)
+        for (int j = 0; j < definition->trainLength; j++)
         {
-            if (l[i].id != l[i].r_id)
+            int index = i * definition->trainLength + j;
+
+            if (m_receiveTimes.at(index) >= 0)
             {
-                LOG_DEBUG("Packages out of order");
+                sendTimes.append(m_sendTimes.at(index));
+                receiveTimes.append(m_receiveTimes.at(index));
             }
         }
 
-        /*
-        ts_otime[0] = l.first().otime.tv_sec * 1000000000 + l.first().otime.tv_nsec;
-        ts_otime[1] = l.last().otime.tv_sec * 1000000000 + l.last().otime.tv_nsec;
-        ts_rtime[0] = l.first().rtime.tv_sec * 1000000000 + l.first().rtime.tv_nsec;
-        ts_rtime[1] = l.last().rtime.tv_sec * 1000000000 + l.last().rtime.tv_nsec;
-        */
+        // gaps in the order the packets arrived
+        qSort(sendTimes);
+        qSort(receiveTimes);
 
-        ts_otime[0] = l.first().otime;
-        ts_otime[1] = l.last().otime;
-        ts_rtime[0] = l.first().rtime;
-        ts_rtime[1] = l.last().rtime;
+        QVariantList gaps;
+
+        for (int j = 1; j < receiveTimes.size(); j++)
+        {
+            gaps.append(receiveTimes.at(j) - receiveTimes.at(j - 1));
+        }
 
-        srate = (double) definition->packetSize * l.size() / (ts_otime[1] - ts_otime[0]) * 1000000000;
-        rrate = (double) definition->packetSize * l.size() / (ts_rtime[1] - ts_rtime[0]) * 1000000000;
+        QVariantMap train;
+        train.insert("received", receiveTimes.size());
+        train.insert("lost", definition->trainLength - receiveTimes.size());
+        train.insert("reordered", m_reordered.at(i));
+        train.insert("duplicates", m_duplicates.at(i));
+        train.insert("receive_gaps_ns", gaps);
 
-        // ignore infinite rates
-        if (ts_otime[0] != ts_rtime[1] && ts_rtime[0] != ts_rtime[1])
+        if (receiveTimes.size() > 1 &&
+            sendTimes.last() != sendTimes.first() && receiveTimes.last() != receiveTimes.first())
         {
+            // bytes/s, the first packet only marks the start
+            double srate = (double) definition->packetSize * (sendTimes.size() - 1) /
+                           (sendTimes.last() - sendTimes.first()) * 1000000000;
+            double rrate = (double) definition->packetSize * (receiveTimes.size() - 1) /
+                           (receiveTimes.last() - receiveTimes.first()) * 1000000000;
+
+            train.insert("send_rate", srate);
+            train.insert("receive_rate", rrate);
+
             m_recvSpeed.append(rrate / 1024);
             m_sendSpeed.append(srate / 1024);
-            //cout<<"sending @ "<<fixed<<setprecision(2)<<srate / 1048576 * 8<<" MBit/s"<<endl;
-            //cout<<"receiving @ "<<fixed<<setprecision(2)<<rrate / 1048576 * 8<<" MBit/s"<<endl;
         }
         else
         {
-            LOG_WARNING("Ignoring train due to infinite rate");
+            LOG_WARNING(QString("Ignoring train %1 due to infinite rate").arg(i));
         }
+
+        m_trains.append(train);
+    }
+
+    if (m_unexpected > 0)
+    {
+        LOG_WARNING(QString("%1 datagrams did not belong to any train").arg(m_unexpected));
     }
 
     emit finished();
@@ -160,6 +193,16 @@ bool PacketTrainsMP::prepare(NetworkManager *networkManager, const MeasurementDe
     if (definition.isNull())
     {
         setErrorString("Definition is empty");
+        return false;
+    }
+
+    // the definition comes from the peer, it sizes the buffers below
+    if (definition->trainLength == 0 || definition->trainLength > packettrains::maxTrainLength ||
+        definition->iterations == 0 || definition->rateMin == 0 || definition->rateMax < definition->rateMin ||
+        definition->packetSize < sizeof(msg))
+    {
+        setErrorString("Invalid definition");
+        return false;
     }
 
     m_udpSocket = qobject_cast<QUdpSocket *>(peerSocket());
@@ -176,13 +219,17 @@ bool PacketTrainsMP::prepare(NetworkManager *networkManager, const MeasurementDe
     connect(m_udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
             SLOT(handleError(QAbstractSocket::SocketError)));
 
-    m_packetsReceived = 0;
-    m_rec.clear();
+    m_udpSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, receiveBufferSize);
 
-    for (int i = 0; i < definition->iterations; i++)
-    {
-        m_rec.append(QList<msg>());
-    }
+    m_receiver.setSocket(m_udpSocket);
+
+    int packets = definition->trainLength * definition->iterations;
+    m_sendTimes.fill(-1, packets);
+    m_receiveTimes.fill(-1, packets);
+    m_highestId.fill(-1, definition->iterations);
+    m_reordered.fill(0, definition->iterations);
+    m_duplicates.fill(0, definition->iterations);
+    m_unexpected = 0;
 
     return true;
 }
@@ -190,6 +237,9 @@ bool PacketTrainsMP::prepare(NetworkManager *networkManager, const MeasurementDe
 bool PacketTrainsMP::stop()
 {
     m_timeout.stop();
+
+    m_receiver.stopNotifying();
+
     return true;
 }
 
@@ -198,6 +248,9 @@ Result PacketTrainsMP::result() const
     QVariantMap map;
     map.insert("sending_speed", listToVariant(m_sendSpeed));
     map.insert("receiving_speed", listToVariant(m_recvSpeed));
+    map.insert("trains", m_trains);
+    map.insert("unexpected", m_unexpected);
+    map.insert("kernel_timestamps", m_receiver.kernelTimestamps());
 
     return Result(map, getMeasurementUuid());
 }
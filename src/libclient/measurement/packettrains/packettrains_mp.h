@@ -3,10 +3,11 @@
 
 #include <QTimer>
 #include <QUdpSocket>
-#include <QElapsedTimer>
+#include <QVector>
 
 #include "../measurement.h"
 #include "packettrainsdefinition.h"
+#include "receiver.h"
 
 class PacketTrainsMP : public Measurement
 {
@@ -23,15 +24,26 @@ private:
     PacketTrainsDefinitionPtr definition;
     QUdpSocket *m_udpSocket;
     QTimer m_timer;
-    QList<QList<struct msg> > m_rec;
-    quint16 m_packetsReceived;
+    Receiver m_receiver;
+
+    // per packet, indexed by train * trainLength + id; -1 if not received
+    QVector<qint64> m_sendTimes;
+    QVector<qint64> m_receiveTimes;
+
+    // per train
+    QVector<int> m_highestId;
+    QVector<int> m_reordered;
+    QVector<int> m_duplicates;
+
+    // datagrams not belonging to any train of the definition
+    int m_unexpected;
+
     QList<int> m_sendSpeed;
     QList<int> m_recvSpeed;
+    QVariantList m_trains;
 
     QTimer m_timeout;
 
-    QElapsedTimer m_receiveTimer;
-
 public slots:
     void readPendingDatagrams();
     void eval();
@@ -7,6 +7,13 @@
 
 #include "../measurementdefinition.h"
 
+namespace packettrains
+{
+    // msg::id is a quint8, the ids of a longer train would repeat; the
+    // iterations are bounded by their type
+    const quint16 maxTrainLength = 256;
+}
+
 class PacketTrainsDefinition;
 
 typedef QSharedPointer<PacketTrainsDefinition> PacketTrainsDefinitionPtr;
@@ -0,0 +1,339 @@
+#include "receiver.h"
+#include "pacer.h"
+#include "../../log/logger.h"
+
+#include <QDateTime>
+
+#include <string.h>
+
+#if defined(Q_OS_WIN)
+#include <WinSock2.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+LOGGER(Receiver);
+
+namespace
+{
+#if defined(Q_OS_LINUX)
+    const int controlSize = CMSG_SPACE(sizeof(struct timespec));
+
+    // bionic only has recvmmsg() from API level 21 on
+    int receiveMessages(int sock, struct mmsghdr *messages, unsigned int count)
+    {
+#if defined(Q_OS_ANDROID) && __ANDROID_API__ < 21
+        unsigned int received = 0;
+
+        for (; received < count; received++)
+        {
+            ssize_t len = recvmsg(sock, &messages[received].msg_hdr, MSG_DONTWAIT);
+
+            if (len < 0)
+            {
+                return received > 0 ? (int) received : -1;
+            }
+
+            messages[received].msg_len = len;
+        }
+
+        return received;
+#else
+        return recvmmsg(sock, messages, count, MSG_DONTWAIT, NULL);
+#endif
+    }
+#endif
+}
+
+Receiver::Receiver(int slotSize, int slotCount)
+: m_udpSocket(NULL)
+, m_socket(-1)
+, m_notifier(NULL)
+, m_slotSize(slotSize)
+, m_slotCount(slotCount)
+, m_kernelTimestamps(false)
+, m_ring(slotSize * slotCount, 0)
+, m_sizes(slotCount, 0)
+, m_timestamps(slotCount, 0)
+, m_senders(slotCount)
+{
+#if defined(Q_OS_LINUX)
+    m_control.fill(0, controlSize * slotCount);
+    m_headers.resize(slotCount);
+    m_iovecs.resize(slotCount);
+#endif
+}
+
+Receiver::~Receiver()
+{
+    delete m_notifier;
+
+#if !defined(Q_OS_WIN)
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+    }
+#endif
+}
+
+bool Receiver::setSocket(QUdpSocket *socket)
+{
+    stopNotifying();
+    m_udpSocket = socket;
+    m_kernelTimestamps = false;
+
+#if defined(Q_OS_WIN)
+    m_socket = socket->socketDescriptor();
+#else
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+    }
+
+    m_socket = fcntl(socket->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+
+    if (m_socket < 0)
+    {
+        LOG_ERROR(QString("Unable to duplicate the socket: %1").arg(strerror(errno)));
+        return false;
+    }
+#endif
+
+#if defined(Q_OS_LINUX) && defined(SO_TIMESTAMPNS)
+    int on = 1;
+
+    if (setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0)
+    {
+        LOG_DEBUG(QString("SO_TIMESTAMPNS not available: %1").arg(strerror(errno)));
+    }
+    else
+    {
+        m_kernelTimestamps = true;
+    }
+#endif
+
+    if (!m_kernelTimestamps)
+    {
+        LOG_INFO("No kernel receive timestamps, using the time of reading");
+    }
+
+    return m_kernelTimestamps;
+}
+
+bool Receiver::kernelTimestamps() const
+{
+    return m_kernelTimestamps;
+}
+
+void Receiver::notify(QObject *object, const char *slot)
+{
+#if defined(Q_OS_WIN)
+    QObject::connect(m_udpSocket, SIGNAL(readyRead()), object, slot);
+#else
+    if (m_socket < 0)
+    {
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, object);
+    QObject::connect(m_notifier, SIGNAL(activated(int)), object, slot);
+#endif
+}
+
+void Receiver::stopNotifying()
+{
+#if defined(Q_OS_WIN)
+    if (m_udpSocket)
+    {
+        QObject::disconnect(m_udpSocket, SIGNAL(readyRead()), 0, 0);
+    }
+#else
+    // may be called from the slot the notifier activated
+    if (m_notifier)
+    {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = NULL;
+    }
+#endif
+}
+
+int Receiver::receive()
+{
+#if defined(Q_OS_LINUX)
+    for (int i = 0; i < m_slotCount; i++)
+    {
+        m_iovecs[i].iov_base = m_ring.data() + i * m_slotSize;
+        m_iovecs[i].iov_len = m_slotSize;
+
+        struct msghdr &header = m_headers[i].msg_hdr;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &m_senders[i];
+        header.msg_namelen = sizeof(struct sockaddr_storage);
+        header.msg_iov = &m_iovecs[i];
+        header.msg_iovlen = 1;
+        header.msg_control = m_control.data() + i * controlSize;
+        header.msg_controllen = controlSize;
+    }
+
+    int count;
+
+    while ((count = receiveMessages(m_socket, m_headers.data(), m_slotCount)) < 0 && errno == EINTR)
+    {
+    }
+
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    qint64 time = now();
+
+    for (int i = 0; i < count; i++)
+    {
+        m_sizes[i] = m_headers[i].msg_len;
+        m_timestamps[i] = time;
+
+        struct msghdr &header = m_headers[i].msg_hdr;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+            {
+                struct timespec stamp;
+                memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                m_timestamps[i] = (qint64)stamp.tv_sec * 1000000000 + stamp.tv_nsec;
+            }
+        }
+    }
+
+    return count;
+#elif defined(Q_OS_WIN)
+    int count = 0;
+
+    while (count < m_slotCount && m_udpSocket->hasPendingDatagrams())
+    {
+        QHostAddress address;
+        quint16 port = 0;
+        qint64 size = m_udpSocket->readDatagram(m_ring.data() + count * m_slotSize, m_slotSize, &address, &port);
+
+        if (size < 0)
+        {
+            break;
+        }
+
+        struct sockaddr_storage &sender = m_senders[count];
+        memset(&sender, 0, sizeof(sender));
+
+        if (address.protocol() == QAbstractSocket::IPv6Protocol)
+        {
+            struct sockaddr_in6 *in6 = reinterpret_cast<struct sockaddr_in6 *>(&sender);
+            Q_IPV6ADDR ip = address.toIPv6Address();
+            in6->sin6_family = AF_INET6;
+            in6->sin6_port = htons(port);
+            memcpy(&in6->sin6_addr, &ip, sizeof(ip));
+        }
+        else
+        {
+            struct sockaddr_in *in = reinterpret_cast<struct sockaddr_in *>(&sender);
+            in->sin_family = AF_INET;
+            in->sin_port = htons(port);
+            in->sin_addr.s_addr = htonl(address.toIPv4Address());
+        }
+
+        m_sizes[count] = size;
+        m_timestamps[count] = now();
+        count++;
+    }
+
+    return count;
+#else
+    int count = 0;
+
+    while (count < m_slotCount)
+    {
+        socklen_t length = sizeof(struct sockaddr_storage);
+        int size = recvfrom(m_socket, m_ring.data() + count * m_slotSize, m_slotSize, 0,
+                            reinterpret_cast<struct sockaddr *>(&m_senders[count]), &length);
+
+        if (size < 0)
+        {
+            break;
+        }
+
+        m_sizes[count] = size;
+        m_timestamps[count] = now();
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+const char *Receiver::data(int slot) const
+{
+    return m_ring.constData() + slot * m_slotSize;
+}
+
+int Receiver::size(int slot) const
+{
+    return qMin(m_sizes.at(slot), m_slotSize);
+}
+
+qint64 Receiver::timestamp(int slot) const
+{
+    return m_timestamps.at(slot);
+}
+
+QHostAddress Receiver::sender(int slot) const
+{
+    return QHostAddress(reinterpret_cast<const struct sockaddr *>(&m_senders.at(slot)));
+}
+
+quint16 Receiver::senderPort(int slot) const
+{
+    const struct sockaddr_storage &address = m_senders.at(slot);
+
+    if (address.ss_family == AF_INET6)
+    {
+        return ntohs(reinterpret_cast<const struct sockaddr_in6 *>(&address)->sin6_port);
+    }
+
+    return ntohs(reinterpret_cast<const struct sockaddr_in *>(&address)->sin_port);
+}
+
+qint64 Receiver::now() const
+{
+#if defined(Q_OS_WIN)
+    return QDateTime::currentMSecsSinceEpoch() * 1000000;
+#else
+    // same clock as SO_TIMESTAMPNS for datagrams without one
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return (qint64)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+bool Receiver::waitForDatagram(QUdpSocket *socket, qint64 deadline, QByteArray *datagram)
+{
+    qint64 remaining = (deadline - Pacer::now()) / 1000000;
+
+    if (remaining <= 0)
+    {
+        return false;
+    }
+
+    if (!socket->hasPendingDatagrams() && !socket->waitForReadyRead(remaining))
+    {
+        return false;
+    }
+
+    datagram->resize(qMax(socket->pendingDatagramSize(), (qint64)0));
+    socket->readDatagram(datagram->data(), datagram->size());
+    return true;
+}
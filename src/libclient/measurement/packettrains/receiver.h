@@ -0,0 +1,88 @@
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QVector>
+#include <QUdpSocket>
+#include <QSocketNotifier>
+
+#if defined(Q_OS_WIN)
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+/*
+ * Drains datagrams from a non-blocking socket into a preallocated ring of
+ * slots. On Linux a batch is fetched with one recvmmsg() (a recvmsg() loop
+ * on Android before API level 21) and every datagram carries the time the
+ * kernel received it (SO_TIMESTAMPNS), so the latency of the event loop
+ * does not end up in the timestamps.
+ * Elsewhere the datagrams are read one by one and stamped when read.
+ *
+ * Qt watches the descriptor of the QUdpSocket itself and a second notifier
+ * on it is not reliable, so the receiver reads from and watches a
+ * duplicate. Duplicates share their notifications on Windows, there the
+ * datagrams are read through the QUdpSocket on readyRead().
+ *
+ * Timestamps are ns since the epoch on the real time clock.
+ */
+class Receiver
+{
+public:
+    // datagrams longer than slotSize are truncated
+    explicit Receiver(int slotSize = 2048, int slotCount = 64);
+    ~Receiver();
+
+    // false if the socket does not deliver kernel timestamps, the
+    // datagrams are then stamped when read
+    bool setSocket(QUdpSocket *socket);
+    bool kernelTimestamps() const;
+
+    // slot of object is called whenever datagrams are pending
+    void notify(QObject *object, const char *slot);
+    void stopNotifying();
+
+    // fills the ring, returns the number of datagrams read or 0 if there
+    // are none pending
+    int receive();
+
+    const char *data(int slot) const;
+    int size(int slot) const;
+    qint64 timestamp(int slot) const;
+    QHostAddress sender(int slot) const;
+    quint16 senderPort(int slot) const;
+
+    // blocks until the next datagram of a QUdpSocket arrives, for replies to
+    // control messages; false once deadline (see Pacer::now()) passed
+    static bool waitForDatagram(QUdpSocket *socket, qint64 deadline, QByteArray *datagram);
+
+private:
+    Q_DISABLE_COPY(Receiver)
+
+    qint64 now() const;
+
+    QUdpSocket *m_udpSocket;
+    // the duplicate, the descriptor of m_udpSocket on Windows
+    qintptr m_socket;
+    QSocketNotifier *m_notifier;
+    int m_slotSize;
+    int m_slotCount;
+    bool m_kernelTimestamps;
+
+    QByteArray m_ring;
+    QVector<int> m_sizes;
+    QVector<qint64> m_timestamps;
+    QVector<struct sockaddr_storage> m_senders;
+
+#if defined(Q_OS_LINUX)
+    QByteArray m_control;
+    QVector<struct mmsghdr> m_headers;
+    QVector<struct iovec> m_iovecs;
+#endif
+};
+
+#endif // RECEIVER_H
@@ -16,21 +16,20 @@
 #undef min
 #include<pcap.h>
 #include <cstring>
-#elif defined(Q_OS_LINUX) || defined(Q_OS_MAC)
+#elif defined(Q_OS_LINUX)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#elif defined(Q_OS_MAC)
 #include <netinet/in.h>
 #else
 #error Platform not supported.
 #endif
 
 #include "../measurement.h"
+#include "../statistics.h"
+#include "../../network/socketutil.h"
 #include "ping_definition.h"
 
-union sockaddr_any
-{
-    struct sockaddr sa;
-    struct sockaddr_in sin;
-    struct sockaddr_in6 sin6;
-};
 
 /*
  * This enum exists because receiveLoop() cannot directly emit signals.
@@ -63,9 +62,22 @@ typedef void pcap_if_t;
 typedef void pcap_t;
 #endif
 
+#if defined(Q_OS_LINUX)
+namespace ping
+{
+    // where the send and receive times of a probe were taken
+    enum TimestampSource
+    {
+        UserTimestamp,
+        KernelTimestamp
+    };
+}
+#endif
+
 struct PingProbe
 {
     int sock;
+    // nanoseconds
     quint64 sendTime;
     quint64 recvTime;
     sockaddr_any source;
@@ -91,6 +103,18 @@ struct PingProbe
 #if defined(Q_OS_MAC)
     int icmpSock;
 #endif
+#if defined(Q_OS_LINUX)
+    // the destination port of an UDP probe or the source port of a TCP one
+    quint16 port;
+    // monotonic time in nsec after which the probe counts as lost
+    quint64 deadline;
+    bool pending;
+    // SO_TIMESTAMPING id of the datagram
+    quint32 txId;
+    ping::TimestampSource timestampSource;
+    // the TTL of a traceroute probe, 0 for the TTL of the socket
+    int ttl;
+#endif
 
     PingProbe()
     : sock(0)
@@ -106,6 +130,14 @@ struct PingProbe
 #endif
 #if defined(Q_OS_MAC)
     , icmpSock(0)
+#endif
+#if defined(Q_OS_LINUX)
+    , port(0)
+    , deadline(0)
+    , pending(false)
+    , txId(0)
+    , timestampSource(ping::UserTimestamp)
+    , ttl(0)
 #endif
     {}
 };
@@ -127,15 +159,28 @@ public:
     Result result() const;
     void waitForFinished();
     float averagePingTime() const;
+    // the caller charged the traffic budget for the pings already
+    void setTrafficCharged(bool charged);
 
 private:
     quint32 estimateTraffic() const;
     void setStatus(Status status);
-    int initSocket();
-    bool sendUdpData(PingProbe *probe);
     bool sendTcpData(PingProbe *probe);
+#if defined(Q_OS_LINUX)
+    int initSocket(quint16 sourcePort);
+    bool runProbes();
+    int sendDatagrams(PingProbe *probes, int count);
+    void receiveDatagrams(int sock);
+    void receiveTcpData(PingProbe *probe);
+    void expireProbes(quint64 now);
+    void finishProbe(PingProbe *probe);
+    void recycleTcpSocket(int slot);
+#else
+    bool sendUdpData(PingProbe *probe);
+    int initSocket();
     void receiveData(PingProbe *probe);
     void ping(PingProbe *probe);
+#endif
 #if defined(Q_OS_WIN)
     void processUdpPackets(QVector<PingProbe> *probes);
     void processTcpPackets(QVector<PingProbe> *probes);
@@ -144,11 +189,45 @@ private:
     PingDefinitionPtr definition;
     Status currentStatus;
     QVector<PingProbe> m_pingProbes;
-    QList<float> pingTime;
+    Statistics m_rttStatistics;
 
     pcap_if_t *m_device;
     pcap_t *m_capture;
     sockaddr_any m_destAddress;
+    bool m_trafficCharged;
+
+#if defined(Q_OS_LINUX)
+    // pipelined engine state: one slot per probe in flight
+    int m_epollFd;
+    int m_datagramSocket;
+    QVector<int> m_probeSlots;
+    quint32 m_pendingProbes;
+    // datagrams sent on m_datagramSocket, matches the SO_TIMESTAMPING id
+    quint32 m_datagramSendCount;
+    // count probes per TTL, m_ttlCount TTLs starting at m_firstTtl, sent in
+    // bursts of m_burstSize; TTLs above m_ttlLimit reach the destination
+    quint32 m_probeCount;
+    quint32 m_burstSize;
+    int m_firstTtl;
+    quint32 m_ttlCount;
+    int m_ttlLimit;
+    // TCP sockets set up before the first probe, one per slot, they are
+    // reset and reused after every probe instead of being rebuilt
+    QVector<int> m_tcpSockets;
+    // handshakes answered with SYN/ACK and with RST, in msec
+    Statistics m_connectStatistics;
+    Statistics m_resetStatistics;
+
+    // built in prepare() so that sending never allocates: random payloads
+    // the probes cycle through and the sendmmsg() vectors of one burst
+    QByteArray m_payloadPool;
+    QVector<struct mmsghdr> m_burstMessages;
+    QVector<struct iovec> m_burstVectors;
+    // ICMP echo request headers or UDP probe tags of one burst, 8 bytes each
+    QByteArray m_probeHeaders;
+    // the system denies unprivileged ICMP sockets, use the ping binary
+    bool m_icmpDenied;
+#endif
 
     // for system ping only
     QProcess process;
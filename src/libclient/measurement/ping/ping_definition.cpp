@@ -3,7 +3,8 @@
 PingDefinition::PingDefinition(const QString &host, const quint32 &count, const quint32 &interval,
                                      const quint32 &receiveTimeout, const int &ttl,
                                      const quint16 &destinationPort, const quint16 &sourcePort,
-                                     const quint32 &payload, const ping::PingType &type)
+                                     const quint32 &payload, const ping::PingType &type,
+                                     const quint32 &burst, const int &maxTtl)
 : host(host)
 , count(count)
 , interval(interval)
@@ -13,6 +14,8 @@ PingDefinition::PingDefinition(const QString &host, const quint32 &count, const
 , sourcePort(sourcePort)
 , payload(payload)
 , type(type)
+, burst(burst)
+, maxTtl(maxTtl)
 {
 
 }
@@ -34,7 +37,9 @@ PingDefinitionPtr PingDefinition::fromVariant(const QVariant &variant)
                                                       map.value("source_port", 33434).toUInt(),
                                                       map.value("payload", 74).toUInt(),
                                                       pingTypeFromString(map.value(
-                                                                             "type", "Udp").toString().toLatin1())));
+                                                                             "type", "Udp").toString().toLatin1()),
+                                                      map.value("burst", 1).toUInt(),
+                                                      map.value("max_ttl", 0).toInt()));
 }
 
 QVariant PingDefinition::toVariant() const
@@ -49,5 +54,7 @@ QVariant PingDefinition::toVariant() const
     map.insert("source_port", sourcePort);
     map.insert("payload", payload);
     map.insert("type", pingTypeToString(type));
+    map.insert("burst", burst);
+    map.insert("max_ttl", maxTtl);
     return map;
 }
@@ -16,7 +16,7 @@ public:
     ~PingDefinition();
     PingDefinition(const QString &host, const quint32 &count, const quint32 &interval, const quint32 &receiveTimeout,
                       const int &ttl, const quint16 &destinationPort, const quint16 &sourcePort, const quint32 &payload,
-                      const ping::PingType &type);
+                      const ping::PingType &type, const quint32 &burst = 1, const int &maxTtl = 0);
 
     // Storage
     static PingDefinitionPtr fromVariant(const QVariant &variant);
@@ -31,6 +31,10 @@ public:
     quint16 sourcePort;
     quint32 payload;
     ping::PingType type;
+    // probes sent back-to-back per interval
+    quint32 burst;
+    // if set, count probes are sent for every TTL from ttl to maxTtl
+    int maxTtl;
 
     // Serializable interface
     QVariant toVariant() const;
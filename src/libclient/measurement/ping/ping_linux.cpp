@@ -1,15 +1,17 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
-#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <linux/errqueue.h>
 #include <linux/icmp.h>
+#include <linux/net_tstamp.h>
+#include <netinet/icmp6.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
-#include <numeric>
 
 #include <QtMath>
 
@@ -22,57 +24,116 @@ LOGGER("Ping");
 
 namespace
 {
-    bool getAddress(const QString &address, sockaddr_any *addr)
+    // upper bound of probes waiting for an answer at the same time, every
+    // TCP probe in flight occupies its own source port
+    const quint32 maxProbesInFlight = 64;
+    const int maxEvents = 16;
+
+    // UDP probes carry their index in the first bytes of the payload
+    const quint32 probeTagLength = 4;
+
+    // epoll token of the shared UDP or ICMP socket, TCP probes use their index
+    const quint64 datagramSocketToken = Q_UINT64_C(0xffffffffffffffff);
+
+    // not part of older kernel headers
+    const int timestampingOptId = 1 << 7;
+    const int timestampingOptTsonly = 1 << 11;
+
+    // software TX timestamps are looped back on the error queue with the id
+    // of the datagram instead of the datagram itself; hardware timestamps
+    // would need SIOCSHWTSTAMP on the egress interface, which is privileged
+    const int timestampingFlags = SOF_TIMESTAMPING_TX_SOFTWARE |
+                                  SOF_TIMESTAMPING_RX_SOFTWARE |
+                                  SOF_TIMESTAMPING_SOFTWARE |
+                                  timestampingOptId |
+                                  timestampingOptTsonly;
+
+    // the software timestamp sits in ts[0]
+    quint64 readTimestamping(struct cmsghdr *cm)
     {
-        struct addrinfo hints;
-        struct addrinfo *rp = NULL, *result = NULL;
+        struct timespec *ts = (struct timespec *) CMSG_DATA(cm);
 
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = PF_UNSPEC;
+        return toNsec(ts[0]);
+    }
 
-        if (getaddrinfo(address.toLatin1(), NULL, &hints, &result))
+    const char *timestampSourceToString(ping::TimestampSource source)
+    {
+        switch (source)
         {
-            return false;
+        case ping::KernelTimestamp:
+            return "kernel_sw";
+
+        default:
+            return "user";
         }
+    }
+
+    // distinct payloads the probes cycle through
+    const int payloadPoolSize = 16;
 
-        for (rp = result; rp && rp->ai_family != AF_INET &&
-             rp->ai_family != AF_INET6;
-             rp = rp->ai_next)
+    void randomizePayload(char *data, const quint32 size)
+    {
+        // ignore terminating null characters
+        const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890";
+        const char marker[] = " measure-it.net";
+        const quint32 markerLength = sizeof(marker) - 1;
+        const quint32 randomLength = size > markerLength ? size - markerLength : size;
+
+        for (quint32 i = 0; i < randomLength; i++)
         {
+            data[i] = chars[qrand() % (sizeof(chars) - 1)];
         }
 
-        if (!rp)
+        if (size > markerLength)
         {
-            freeaddrinfo(result);
-            return false;
+            memcpy(data + randomLength, marker, markerLength);
         }
-
-        memcpy(addr, rp->ai_addr, rp->ai_addrlen);
-
-        freeaddrinfo(result);
-
-        return true;
     }
 
-    QByteArray randomizePayload(const quint32 size)
+    // bionic only has sendmmsg() from API level 21 on
+    int sendMessages(int sock, struct mmsghdr *messages, unsigned int count)
     {
-        char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890";
-        QByteArray payload;
+#if defined(Q_OS_ANDROID) && __ANDROID_API__ < 21
+        unsigned int sent = 0;
 
-        payload.resize(size);
-
-        for (quint32 i = 0; i < (size > 15 ? size - 15 : size); i++)
+        for (; sent < count; sent++)
         {
-            payload[i] = chars[qrand() % strlen(chars)];
+            ssize_t len = sendmsg(sock, &messages[sent].msg_hdr, 0);
+
+            if (len < 0)
+            {
+                return sent > 0 ? (int) sent : -1;
+            }
+
+            messages[sent].msg_len = len;
         }
 
-        if (size > 15)
+        return sent;
+#else
+        return sendmmsg(sock, messages, count, 0);
+#endif
+    }
+
+    bool setTtl(int sock, int family, int ttl)
+    {
+        if (family == AF_INET6)
         {
-            // ignore terminating null character
-            payload.insert(size - 15, " measure-it.net", 15);
+            return setsockopt(sock, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &ttl, sizeof(ttl)) == 0;
         }
 
-        return payload;
+        return setsockopt(sock, SOL_IP, IP_TTL, &ttl, sizeof(ttl)) == 0;
+    }
+
+    void insertStatistics(QVariantMap *map, const QString &prefix, const Statistics &statistics)
+    {
+        map->insert(prefix + "_avg", statistics.mean());
+        map->insert(prefix + "_min", statistics.min());
+        map->insert(prefix + "_max", statistics.max());
+        map->insert(prefix + "_stdev", statistics.stdev());
+        map->insert(prefix + "_p50", statistics.quantile(0.5));
+        map->insert(prefix + "_p90", statistics.quantile(0.9));
+        map->insert(prefix + "_p99", statistics.quantile(0.99));
+        map->insert(prefix + "_count", static_cast<int>(statistics.count()));
     }
 }
 
@@ -82,6 +143,17 @@ Ping::Ping(QObject *parent)
 , m_device(NULL)
 , m_capture(NULL)
 , m_destAddress()
+, m_trafficCharged(false)
+, m_epollFd(-1)
+, m_datagramSocket(-1)
+, m_pendingProbes(0)
+, m_datagramSendCount(0)
+, m_probeCount(0)
+, m_burstSize(1)
+, m_firstTtl(64)
+, m_ttlCount(1)
+, m_ttlLimit(255)
+, m_icmpDenied(false)
 , stream(&process)
 {
     connect(this, SIGNAL(error(const QString &)), this,
@@ -123,22 +195,68 @@ bool Ping::prepare(NetworkManager *networkManager, const MeasurementDefinitionPt
         return false;
     }
 
-    if (definition->type != ping::System)
+    if (definition->payload > 1400)
+    {
+        setErrorString("payload is too large (> 1400 bytes)");
+        return false;
+    }
+
+    if (definition->burst == 0 || definition->burst > maxProbesInFlight)
+    {
+        setErrorString(QString("burst must be between 1 and %1").arg(maxProbesInFlight));
+        return false;
+    }
+
+    if (definition->receiveTimeout > 60000)
+    {
+        setErrorString("receive timeout is too large (> 60 s)");
+        return false;
+    }
+
+    m_firstTtl = definition->ttl > 0 ? definition->ttl : 64;
+    m_ttlCount = 1;
+    m_burstSize = definition->burst;
+
+    if (definition->maxTtl > 0)
     {
-        if (definition->payload > 1400)
+        // all TTLs of a round are sent as one burst, each probe with its own
+        m_firstTtl = definition->ttl > 0 ? definition->ttl : 1;
+
+        if (definition->type != ping::Udp)
         {
-            setErrorString("payload is too large (> 1400 bytes)");
+            setErrorString("max_ttl is only supported for UDP pings");
             return false;
         }
+
+        if (definition->maxTtl < m_firstTtl || definition->maxTtl > 255 ||
+            (quint32)(definition->maxTtl - m_firstTtl) >= maxProbesInFlight)
+        {
+            setErrorString(QString("max_ttl must be between ttl and ttl + %1").arg(maxProbesInFlight - 1));
+            return false;
+        }
+
+        m_ttlCount = definition->maxTtl - m_firstTtl + 1;
+        m_burstSize = m_ttlCount;
     }
 
-    if (definition->receiveTimeout > 60000)
+    m_probeCount = definition->count * m_ttlCount;
+
+    if (definition->type == ping::Udp && definition->payload < probeTagLength)
     {
-        setErrorString("receive timeout is too large (> 60 s)");
+        definition->payload = probeTagLength;
+    }
+
+    // the source ports of the TCP slots are counted up from the configured
+    // one and must not wrap around
+    if (definition->type == ping::Tcp && definition->sourcePort > 0 &&
+        definition->sourcePort + qBound(1u, m_probeCount, maxProbesInFlight) - 1 > 65535)
+    {
+        setErrorString(QString("source port %1 leaves no room for %2 probes in flight")
+                       .arg(definition->sourcePort).arg(qBound(1u, m_probeCount, maxProbesInFlight)));
         return false;
     }
 
-    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
+    if (!m_trafficCharged && !Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
     {
         setErrorString("not enough traffic available");
         return false;
@@ -149,8 +267,7 @@ bool Ping::prepare(NetworkManager *networkManager, const MeasurementDefinitionPt
         connect(&process, SIGNAL(started()), this, SLOT(started()));
         connect(&process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(finished(int, QProcess::ExitStatus)));
         connect(&process, SIGNAL(readyRead()), this, SLOT(readyRead()));
-        // We exit here since there's no need to proceed further.
-        return true;
+        // the ping binary is only needed if ICMP sockets are not permitted
     }
 
     memset(&m_destAddress, 0, sizeof(m_destAddress));
@@ -177,57 +294,66 @@ bool Ping::prepare(NetworkManager *networkManager, const MeasurementDefinitionPt
         return false;
     }
 
+    m_payloadPool.resize(payloadPoolSize * definition->payload);
+
+    for (int i = 0; i < payloadPoolSize; i++)
+    {
+        randomizePayload(m_payloadPool.data() + i * definition->payload, definition->payload);
+    }
+
+    m_burstMessages.resize(m_burstSize);
+    m_burstVectors.resize(2 * m_burstSize);
+    m_probeHeaders.fill(0, 8 * m_burstSize);
+
     return true;
 }
 
 bool Ping::start()
 {
-    PingProbe probe;
-
     setStatus(Ping::Running);
 
-    if (definition->type == ping::System)
+    if (definition->type != ping::System || !m_icmpDenied)
     {
-        QStringList args;
+        m_pingProbes.clear();
+        m_rttStatistics.clear();
+        m_connectStatistics.clear();
+        m_resetStatistics.clear();
 
-        args << "-c" << QString::number(definition->count)
-             << "-n" // Don't resolve hostnames
-             << "-W" << QString::number((float)definition->receiveTimeout / 1000)
-             << "-i" << QString::number((float)definition->interval / 1000)
-             << definition->host;
+        if (runProbes())
+        {
+            foreach (const PingProbe &probe, m_pingProbes)
+            {
+                if (probe.sendTime > 0 && probe.recvTime > 0 && probe.sendTime != probe.recvTime)
+                {
+                    m_rttStatistics.add((probe.recvTime - probe.sendTime) / 1000000.);
+                }
+            }
 
-        process.kill();
-        process.start("ping", args);
+            setStatus(Ping::Finished);
+            emit Measurement::finished();
 
-        return true;
-    }
+            return true;
+        }
 
-    probe.sock = initSocket();
+        // only a denied ICMP socket leaves the ping binary as an option
+        if (!m_icmpDenied)
+        {
+            return false;
+        }
 
-    if (probe.sock < 0)
-    {
-        setErrorString(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
-        return false;
+        LOG_INFO("ICMP sockets are not permitted, falling back to the ping binary");
     }
 
-    for (quint32 i = 0; i < definition->count; i++)
-    {
-        ping(&probe);
-        m_pingProbes.append(probe);
-    }
+    QStringList args;
 
-    close(probe.sock);
+    args << "-c" << QString::number(definition->count)
+         << "-n" // Don't resolve hostnames
+         << "-W" << QString::number((float)definition->receiveTimeout / 1000)
+         << "-i" << QString::number((float)definition->interval / 1000)
+         << definition->host;
 
-    foreach (const PingProbe &probe, m_pingProbes)
-    {
-        if (probe.sendTime > 0 && probe.recvTime > 0 && probe.sendTime != probe.recvTime)
-        {
-            pingTime.append((probe.recvTime - probe.sendTime) / 1000.);
-        }
-    }
-
-    setStatus(Ping::Finished);
-    emit Measurement::finished();
+    process.kill();
+    process.start("ping", args);
 
     return true;
 }
@@ -245,38 +371,66 @@ bool Ping::stop()
 Result Ping::result() const
 {
     QVariantMap res;
-    QVariantList roundTripMs;
-    float avg = 0.0;
+    res.insert("round_trip_avg", m_rttStatistics.mean());
+    res.insert("round_trip_min", m_rttStatistics.min());
+    res.insert("round_trip_max", m_rttStatistics.max());
+    res.insert("round_trip_stdev", m_rttStatistics.stdev());
+    res.insert("round_trip_p50", m_rttStatistics.quantile(0.5));
+    res.insert("round_trip_p90", m_rttStatistics.quantile(0.9));
+    res.insert("round_trip_p99", m_rttStatistics.quantile(0.99));
+    res.insert("round_trip_count", static_cast<int>(m_rttStatistics.count()));
+
+    // only the ping binary fallback has no per-probe times
+    if (!m_icmpDenied)
+    {
+        // the least precise source of all round trips decides
+        ping::TimestampSource source = ping::KernelTimestamp;
+        bool answered = false;
 
-    // get max and min
-    QList<float>::const_iterator it = std::max_element(pingTime.begin(), pingTime.end());
-    float max = *it;
-    it = std::min_element(pingTime.begin(), pingTime.end());
-    float min = *it;
+        foreach (const PingProbe &probe, m_pingProbes)
+        {
+            if (probe.sendTime > 0 && probe.recvTime > 0 && probe.sendTime != probe.recvTime)
+            {
+                source = qMin(source, probe.timestampSource);
+                answered = true;
+            }
+        }
 
-    // calculate average and fill ping times
-    foreach (float val, pingTime)
-    {
-        roundTripMs << val;
-        avg += val;
+        res.insert("timestamp_source", timestampSourceToString(answered ? source : ping::UserTimestamp));
     }
 
-    qreal sq_sum = std::inner_product(pingTime.begin(), pingTime.end(), pingTime.begin(), 0.0);
-    qreal stdev = 0.0;
-
-    if (pingTime.size() > 0)
+    if (definition->type == ping::Tcp)
     {
-        avg /= pingTime.size();
-        // calculate standard deviation
-        stdev = qSqrt(sq_sum / pingTime.size() - avg * avg);
+        // SYN to SYN/ACK and SYN to RST take different paths in the target
+        insertStatistics(&res, "round_trip_connect", m_connectStatistics);
+        insertStatistics(&res, "round_trip_reset", m_resetStatistics);
     }
 
-    res.insert("round_trip_avg", avg);
-    res.insert("round_trip_min", min);
-    res.insert("round_trip_max", max);
-    res.insert("round_trip_stdev", stdev);
-    res.insert("round_trip_count", pingTime.size());
-    res.insert("round_trip_ms", roundTripMs);
+    if (!m_icmpDenied && definition->burst > 1)
+    {
+        // mean gap between the answers of a burst, only for complete bursts
+        QVariantList dispersion;
+
+        for (int first = 0; first < m_pingProbes.size(); first += definition->burst)
+        {
+            int last = qMin<int>(first + definition->burst, m_pingProbes.size()) - 1;
+            bool complete = last > first;
+
+            for (int i = first; complete && i <= last; i++)
+            {
+                complete = m_pingProbes[i].recvTime > 0 &&
+                           m_pingProbes[i].recvTime != m_pingProbes[i].sendTime;
+            }
+
+            if (complete)
+            {
+                qint64 spread = m_pingProbes[last].recvTime - m_pingProbes[first].recvTime;
+                dispersion << spread / 1000000. / (last - first);
+            }
+        }
+
+        res.insert("burst_dispersion_ms", dispersion);
+    }
 
     return Result(res);
 }
@@ -356,16 +510,16 @@ quint32 Ping::estimateTraffic() const
         break;
     }
 
-    est *= definition->count;
+    est *= definition->count * m_ttlCount;
 
     return est;
 }
 
-int Ping::initSocket()
+int Ping::initSocket(quint16 sourcePort)
 {
     int n = 0;
     int sock = 0;
-    int ttl = definition->ttl ? definition->ttl : 64;
+    int ttl = m_firstTtl;
     sockaddr_any src_addr;
     struct linger sockLinger;
 
@@ -383,6 +537,20 @@ int Ping::initSocket()
     {
         sock = socket(m_destAddress.sa.sa_family, SOCK_STREAM, IPPROTO_TCP);
     }
+    else if (definition->type == ping::System)
+    {
+        // unprivileged ICMP echo socket, the kernel sets the identifier and
+        // only passes the replies of this socket on
+        sock = socket(m_destAddress.sa.sa_family, SOCK_DGRAM,
+                      m_destAddress.sa.sa_family == AF_INET6 ? (int) IPPROTO_ICMPV6 : (int) IPPROTO_ICMP);
+
+        // not permitted by net.ipv4.ping_group_range
+        if (sock < 0 && (errno == EACCES || errno == EPERM))
+        {
+            m_icmpDenied = true;
+            return -1;
+        }
+    }
     else
     {
         // this should never happen
@@ -423,61 +591,73 @@ int Ping::initSocket()
     }
 
     src_addr.sa.sa_family = m_destAddress.sa.sa_family;
+    setPort(&src_addr, sourcePort);
+
+    if (bind(sock, (struct sockaddr *) &src_addr, addressLength(src_addr)) < 0)
+    {
+        LOG_ERROR(QString("bind: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
 
     // use RECVRR
     n = 1;
 
     if (m_destAddress.sa.sa_family == AF_INET)
     {
-        src_addr.sin.sin_port = htons(definition->sourcePort);
-
-        if (bind(sock, (struct sockaddr *) &src_addr, sizeof(src_addr.sin)) < 0)
+        if (setsockopt(sock, SOL_IP, IP_RECVERR, &n, sizeof(n)) < 0)
         {
-            LOG_ERROR(QString("bind: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            LOG_ERROR(QString("setsockopt IP_RECVERR: %1").arg(
+                          QString::fromLocal8Bit(strerror(errno))));
             goto cleanup;
         }
 
-        if (setsockopt(sock, SOL_IP, IP_RECVERR, &n, sizeof(n)) < 0)
+        // set TTL
+        if (setsockopt(sock, SOL_IP, IP_TTL, &ttl, sizeof(ttl)) < 0)
         {
-            LOG_ERROR(QString("setsockopt IP_RECVERR: %1").arg(
+            LOG_ERROR(QString("setsockopt IP_TTL: %1").arg(
                           QString::fromLocal8Bit(strerror(errno))));
             goto cleanup;
         }
     }
     else if (m_destAddress.sa.sa_family == AF_INET6)
     {
-        src_addr.sin6.sin6_port = htons(definition->sourcePort);
-
-        if (bind(sock, (struct sockaddr *) &src_addr, sizeof(src_addr.sin6)) < 0)
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &n, sizeof(n)) < 0)
         {
-            LOG_ERROR(QString("bind: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            LOG_ERROR(QString("setsockopt IPV6_RECVERR: %1").arg(
+                          QString::fromLocal8Bit(strerror(errno))));
             goto cleanup;
         }
 
-        if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &n, sizeof(n)) < 0)
+        // set hop limit
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &ttl, sizeof(ttl)) < 0)
         {
-            LOG_ERROR(QString("setsockopt IPV6_RECVERR: %1").arg(
+            LOG_ERROR(QString("setsockopt IPV6_UNICAST_HOPS: %1").arg(
                           QString::fromLocal8Bit(strerror(errno))));
             goto cleanup;
         }
     }
 
-    // Enable the receiving of the SO_TIMESTAMP control message
+    // Enable the receiving of the SO_TIMESTAMPNS control message
     n = 1;
 
-    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &n, sizeof(n)) < 0)
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &n, sizeof(n)) < 0)
     {
-        LOG_ERROR(QString("setsockopt SOL_TIMESTAMP: %1").arg(
+        LOG_ERROR(QString("setsockopt SO_TIMESTAMPNS: %1").arg(
                       QString::fromLocal8Bit(strerror(errno))));
         goto cleanup;
     }
 
-    // set TTL
-    if (setsockopt(sock, SOL_IP, IP_TTL, &ttl, sizeof(ttl)) < 0)
+    // UDP probes additionally get kernel TX timestamps, without them the
+    // send time is taken in user space
+    if (definition->type != ping::Tcp)
     {
-        LOG_ERROR(QString("setsockopt IP_TTL: %1").arg(
-                      QString::fromLocal8Bit(strerror(errno))));
-        goto cleanup;
+        n = timestampingFlags;
+
+        if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &n, sizeof(n)) < 0)
+        {
+            LOG_DEBUG(QString("setsockopt SO_TIMESTAMPING: %1").arg(
+                          QString::fromLocal8Bit(strerror(errno))));
+        }
     }
 
     return sock;
@@ -487,330 +667,734 @@ cleanup:
     return -1;
 }
 
-bool Ping::sendUdpData(PingProbe *probe)
+/*
+ * Pipelined probe engine: probes are sent at the configured interval while
+ * earlier ones are still waiting for their answers. Every probe in flight
+ * owns a slot. UDP probes all share the ports of the run, so that every TTL
+ * of a Paris traceroute takes the same ECMP path, and answers are matched by
+ * the probe index leading the payload. TCP probes use the socket of their
+ * slot, whose source port is counted up from the configured one. A probe is
+ * lost as soon as its own deadline has passed, independent of the others.
+ */
+bool Ping::runProbes()
 {
-    int ret = 0;
-    struct timeval tv;
-
-    memset(&tv, 0, sizeof(tv));
-
-    gettimeofday(&tv, NULL);
-    probe->sendTime = tv.tv_sec * 1e6 + tv.tv_usec;
-
-    if (m_destAddress.sa.sa_family == AF_INET)
+    struct epoll_event ev;
+    struct epoll_event events[maxEvents];
+    quint32 sent = 0;
+    quint64 interval = (quint64)definition->interval * 1000000;
+    quint64 nextSend = monotonicTime();
+    quint32 burstSize = qBound(1u, m_burstSize, qMax(1u, m_probeCount));
+    quint32 window = qBound(1u, m_probeCount, maxProbesInFlight);
+
+    // bursts must not wrap around the end of the slots
+    window = qMax(burstSize, window - window % burstSize);
+
+    m_pendingProbes = 0;
+    m_datagramSendCount = 0;
+    m_datagramSocket = -1;
+    m_icmpDenied = false;
+    m_probeSlots.fill(-1, window);
+    m_ttlLimit = 255;
+    m_pingProbes.resize(m_probeCount);
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (m_epollFd < 0)
     {
-        ret = sendto(probe->sock, randomizePayload(definition->payload).data(),
-                     definition->payload, 0, (sockaddr *)&m_destAddress,
-                     sizeof(m_destAddress.sin));
-    }
-    else if (m_destAddress.sa.sa_family == AF_INET6)
-    {
-        ret = sendto(probe->sock, randomizePayload(definition->payload).data(),
-                     definition->payload, 0, (sockaddr *)&m_destAddress,
-                     sizeof(m_destAddress.sin6));
+        setErrorString(QString("epoll_create: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
     }
 
-    if (ret < 0)
+    if (definition->type != ping::Tcp)
     {
-        LOG_WARNING(QString("send: %1").arg(QString::fromLocal8Bit(strerror(errno))));
-        return false;
-    }
+        m_datagramSocket = initSocket(definition->type == ping::Udp ? definition->sourcePort : 0);
 
-    return true;
-}
+        if (m_datagramSocket < 0)
+        {
+            // a denied ICMP socket is not an error, start() falls back
+            if (!m_icmpDenied)
+            {
+                setErrorString(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            }
 
-bool Ping::sendTcpData(PingProbe *probe)
-{
-    int ret = 0;
-    struct timeval tv;
+            close(m_epollFd);
+            return false;
+        }
 
-    memset(&tv, 0, sizeof(tv));
-    gettimeofday(&tv, NULL);
-    probe->sendTime = tv.tv_sec * 1e6 + tv.tv_usec;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLERR;
+        ev.data.u64 = datagramSocketToken;
 
-    if (m_destAddress.sa.sa_family == AF_INET)
-    {
-        ret = ::connect(probe->sock, (sockaddr *)&m_destAddress,
-                        sizeof(struct sockaddr_in));
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_datagramSocket, &ev) < 0)
+        {
+            setErrorString(QString("epoll_ctl: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            close(m_datagramSocket);
+            close(m_epollFd);
+            return false;
+        }
     }
-    else if (m_destAddress.sa.sa_family == AF_INET6)
+    else
     {
-        ret = ::connect(probe->sock, (sockaddr *)&m_destAddress,
-                        sizeof(struct sockaddr_in6));
-    }
+        // set up all sockets before the first SYN, sending a probe is then
+        // only a connect()
+        m_tcpSockets.fill(-1, window);
+
+        for (quint32 slot = 0; slot < window; slot++)
+        {
+            m_tcpSockets[slot] = initSocket(definition->sourcePort ? definition->sourcePort + slot : 0);
 
-    gettimeofday(&tv, NULL);
-    probe->recvTime = tv.tv_sec * 1e6 + tv.tv_usec;
-    memcpy(&probe->source, &(m_destAddress), sizeof(sockaddr_any));
+            if (m_tcpSockets[slot] < 0)
+            {
+                setErrorString(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+
+                foreach (int sock, m_tcpSockets)
+                {
+                    if (sock >= 0)
+                    {
+                        close(sock);
+                    }
+                }
 
-    //for a TCP socket we only call connect (remeber, the socket is non-blocking)
-    if (ret < 0)
+                m_tcpSockets.clear();
+                close(m_epollFd);
+                return false;
+            }
+        }
+    }
+
+    while (sent < m_probeCount || m_pendingProbes > 0)
     {
-        if (errno == ECONNRESET || errno == ECONNREFUSED)
+        quint64 now = monotonicTime();
+        quint32 burst = qMin(burstSize, m_probeCount - sent);
+        int slot = sent % m_probeSlots.size();
+        bool canSend = burst > 0;
+
+        // all probes of a burst need a free slot
+        for (quint32 i = 0; canSend && i < burst; i++)
         {
-            //check immediately, as connect could return immediately if called
-            //for host-local addresses
-            emit tcpReset(*probe);
+            canSend = m_probeSlots[slot + i] < 0;
         }
-        else if (errno == EINPROGRESS)
+
+        if (canSend && now >= nextSend)
         {
-            //the call to connect came right back, we now wait a little
-            //till it goes through or till we receive a reset
-            struct pollfd pfd;
-            int ret = 0;
+            int datagramsSent = 0;
+            quint32 active = burst;
 
-            memset(&pfd, 0, sizeof(pfd));
-            pfd.fd = probe->sock;
-            pfd.events = POLLIN | POLLOUT | POLLERR;
+            if (definition->maxTtl > 0)
+            {
+                // a round holds the TTLs in ascending order, the ones behind
+                // the destination are not sent again
+                active = qMin<quint32>(burst, m_ttlLimit - m_firstTtl + 1);
+            }
 
-            //careful: when an error occured, the socket becomes also writeable
-            //i.e. POLLOUT.
-            if ((ret = poll(&pfd, 1, definition->receiveTimeout)) < 0)
+            for (quint32 i = 0; i < active; i++)
             {
-                LOG_WARNING(QString("poll: %1").arg(QString::fromLocal8Bit(
-                                                        strerror(errno))));
-                goto tcpcleanup;
+                PingProbe *probe = &m_pingProbes[sent + i];
+
+                if (definition->maxTtl > 0)
+                {
+                    probe->ttl = m_firstTtl + (sent + i) % m_ttlCount;
+                }
+
+                if (definition->type == ping::Udp)
+                {
+                    probe->port = getPort(m_destAddress);
+                }
+                else if (definition->type == ping::Tcp)
+                {
+                    probe->port = definition->sourcePort ? definition->sourcePort + slot + i : 0;
+                }
+
+                probe->deadline = now + (quint64)definition->receiveTimeout * 1000000;
             }
 
-            gettimeofday(&tv, NULL);
-            probe->recvTime = tv.tv_sec * 1e6 + tv.tv_usec;
-            memcpy(&probe->source, &(m_destAddress), sizeof(sockaddr_any));
+            if (definition->type != ping::Tcp)
+            {
+                datagramsSent = sendDatagrams(&m_pingProbes[sent], active);
+            }
 
-            //timeout... the other end is not responding...
-            //maybe a stupid Windows host or something
-            //other went wrong (ICMP)... need to distinguish
-            //the two
-            if (ret == 0)
+            for (quint32 i = 0; i < active; i++)
             {
-                //it seems counter intuitive, but we
-                //return true here, so we actually
-                //try to read from the socket...
-                return true;
+                PingProbe *probe = &m_pingProbes[sent + i];
+
+                if (definition->type != ping::Tcp ? (int)i < datagramsSent : sendTcpData(probe))
+                {
+                    probe->pending = true;
+                    m_probeSlots[slot + i] = sent + i;
+                    m_pendingProbes++;
+                }
             }
 
-            //the call to connect could have failed (RST) or actually went through
-            //need to check
-            int error_num = 0;
-            socklen_t len = sizeof(error_num);
+            // keep the schedule, but don't burst if we fell behind it
+            nextSend = qMax(nextSend + interval, now);
+            sent += burst;
+            continue;
+        }
+
+        expireProbes(now);
 
-            if (getsockopt(probe->sock, SOL_SOCKET, SO_ERROR, &error_num, &len) < 0)
+        // sleep until the next probe is due or the next deadline passes
+        quint64 wakeup = canSend ? nextSend : Q_UINT64_C(0xffffffffffffffff);
+
+        foreach (int index, m_probeSlots)
+        {
+            if (index >= 0)
             {
-                LOG_WARNING(QString("getsockopt: %1").arg(QString::fromLocal8Bit(
-                                                              strerror(error_num))));
-                goto tcpcleanup;
+                wakeup = qMin(wakeup, m_pingProbes[index].deadline);
             }
+        }
 
+        if (wakeup == Q_UINT64_C(0xffffffffffffffff))
+        {
+            continue;
+        }
 
-            if (error_num == 0)
+        int timeout = wakeup > now ? (wakeup - now + 999999) / 1000000 : 0;
+        int n = epoll_wait(m_epollFd, events, maxEvents, timeout);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
             {
-                //connection established
-                emit tcpConnect(*probe);
-                goto tcpcleanup;
+                continue;
             }
-            else if (error_num == ECONNRESET || error_num == ECONNREFUSED)
+
+            LOG_WARNING(QString("epoll_wait: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.u64 == datagramSocketToken)
             {
-                //we really expected this reset...
-                emit tcpReset(*probe);
-                goto tcpcleanup;
+                receiveDatagrams(m_datagramSocket);
             }
             else
             {
-                //unexpected
-                LOG_WARNING(QString("getsockopt: %1").arg(QString::fromLocal8Bit(
-                                                              strerror(error_num))));
-                goto tcpcleanup;
+                receiveTcpData(&m_pingProbes[static_cast<int>(events[i].data.u64)]);
             }
         }
-        else
-        {
-            //unexpected
-            LOG_WARNING(QString("connect: %1").arg(QString::fromLocal8Bit(
-                                                       strerror(errno))));
-            goto tcpcleanup;
-        }
     }
 
-tcpcleanup:
-    //closing after unsuccessful connect() OK
-    close(probe->sock);
-    probe->sock = initSocket();
+    // only reached with probes in flight if epoll failed
+    expireProbes(Q_UINT64_C(0xffffffffffffffff));
 
-    if (probe->sock < 0)
+    if (m_datagramSocket >= 0)
     {
-        LOG_WARNING(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        close(m_datagramSocket);
+        m_datagramSocket = -1;
     }
 
-    return false;
+    foreach (int sock, m_tcpSockets)
+    {
+        if (sock >= 0)
+        {
+            close(sock);
+        }
+    }
+
+    m_tcpSockets.clear();
+    close(m_epollFd);
+    m_epollFd = -1;
+
+    return true;
 }
 
-void Ping::receiveData(PingProbe *probe)
+void Ping::expireProbes(quint64 now)
 {
-    struct msghdr msg;
-    sockaddr_any from;
-    struct iovec iov;
-    char buf[1500];
-    char control[256];
-    struct cmsghdr *cm;
-    struct sock_extended_err *ee = NULL;
-    struct timeval *tv;
-    bool udp_response = false;
-
-    memset(&msg, 0, sizeof(msg));
-    msg.msg_name = &from;
-    msg.msg_namelen = sizeof(from);
-    msg.msg_control = control;
-    msg.msg_controllen = sizeof(control);
-    iov.iov_base = buf;
-    iov.iov_len = sizeof(buf);
-    msg.msg_iov = &iov;
-    msg.msg_iovlen = 1;
-
-    // poll here
-    struct pollfd pfd;
-    memset(&pfd, 0, sizeof(pfd));
-    pfd.fd = probe->sock;
-    pfd.events = POLLIN | POLLERR;
-
-    // Don't poll on TCP sockets since the sendTcpData method already does
-    // that.
-    if (definition->type == ping::Udp)
+    for (int slot = 0; slot < m_probeSlots.size(); slot++)
     {
-        if (poll(&pfd, 1, definition->receiveTimeout) < 0)
+        if (m_probeSlots[slot] < 0)
         {
-            LOG_WARNING(QString("poll: %1").arg(QString::fromLocal8Bit(strerror(errno))));
-            goto cleanup;
+            continue;
         }
+
+        PingProbe *probe = &m_pingProbes[m_probeSlots[slot]];
+
+        if (probe->deadline <= now)
+        {
+            // indicate a timeout by zeroing the ping duration
+            probe->recvTime = probe->sendTime;
+            emit timeout(*probe);
+            finishProbe(probe);
+        }
+    }
+}
+
+void Ping::finishProbe(PingProbe *probe)
+{
+    int index = probe - m_pingProbes.data();
+
+    m_probeSlots[index % m_probeSlots.size()] = -1;
+    m_pendingProbes--;
+    probe->pending = false;
+
+    if (definition->type == ping::Tcp)
+    {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, probe->sock, NULL);
+        recycleTcpSocket(index % m_probeSlots.size());
+        probe->sock = -1;
     }
+}
+
+void Ping::recycleTcpSocket(int slot)
+{
+    int sock = m_tcpSockets[slot];
+    int error_num = 0;
+    socklen_t len = sizeof(error_num);
+    struct sockaddr unspec;
+
+    memset(&unspec, 0, sizeof(unspec));
+    unspec.sa_family = AF_UNSPEC;
 
-    if (!pfd.revents)
+    //dissolving the association aborts the handshake or sends a RST just like
+    //close() with SO_LINGER, but the socket keeps its options and its port
+    if (::connect(sock, &unspec, sizeof(unspec)) == 0)
     {
-        // indicate a timeout by zeroing the ping duration
-        probe->recvTime = probe->sendTime;
-        emit timeout(*probe);
+        //an aborted handshake leaves an error behind, the next probe must
+        //not see it
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &error_num, &len);
+        return;
+    }
+
+    LOG_DEBUG(QString("disconnect: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+
+    close(sock);
+    m_tcpSockets[slot] = initSocket(definition->sourcePort ? definition->sourcePort + slot : 0);
+}
 
-        if (definition->type == ping::Tcp)
+int Ping::sendDatagrams(PingProbe *probes, int count)
+{
+    int ret = 0;
+    quint64 sendTime = 0;
+    quint32 tagLength = 0;
+
+    // everything used here was allocated in prepare()
+    for (int i = 0; i < count; i++)
+    {
+        PingProbe *probe = &probes[i];
+        int index = probe - m_pingProbes.data();
+        struct mmsghdr *message = &m_burstMessages[i];
+
+        memset(message, 0, sizeof(*message));
+        message->msg_hdr.msg_name = &m_destAddress;
+        message->msg_hdr.msg_namelen = addressLength(m_destAddress);
+        message->msg_hdr.msg_iov = &m_burstVectors[2 * i];
+        message->msg_hdr.msg_iovlen = 0;
+
+        if (definition->type == ping::System)
         {
-            close(probe->sock);
-            probe->sock = initSocket();
+            // the kernel computes the checksum and sets the identifier,
+            // ICMPv6 echo requests share the layout of ICMPv4 ones
+            struct icmphdr *echo = (struct icmphdr *) (m_probeHeaders.data() + 8 * i);
+
+            echo->type = m_destAddress.sa.sa_family == AF_INET6 ? ICMP6_ECHO_REQUEST : ICMP_ECHO;
+            echo->un.echo.sequence = htons(index & 0xffff);
+
+            m_burstVectors[2 * i].iov_base = echo;
+            m_burstVectors[2 * i].iov_len = 8;
+            message->msg_hdr.msg_iovlen++;
+        }
+        else if (definition->type == ping::Udp)
+        {
+            // the tag replaces the start of the payload, it comes back in
+            // the quote of ICMP errors and in the answer of the destination
+            quint32 tag = htonl(index);
+
+            memcpy(m_probeHeaders.data() + 8 * i, &tag, sizeof(tag));
+            m_burstVectors[2 * i].iov_base = m_probeHeaders.data() + 8 * i;
+            m_burstVectors[2 * i].iov_len = probeTagLength;
+            message->msg_hdr.msg_iovlen++;
+            tagLength = probeTagLength;
         }
 
-        goto cleanup;
+        struct iovec *payload = &m_burstVectors[2 * i + message->msg_hdr.msg_iovlen];
+        payload->iov_base = const_cast<char *>(m_payloadPool.constData()) +
+                            (index % payloadPoolSize) * definition->payload + tagLength;
+        payload->iov_len = definition->payload - tagLength;
+        message->msg_hdr.msg_iovlen++;
+
+        probe->sock = m_datagramSocket;
+        probe->timestampSource = ping::UserTimestamp;
     }
 
-    if (recvmsg(probe->sock, &msg, MSG_ERRQUEUE) < 0)
+    // the kernel TX timestamps replace this one if they arrive
+    sendTime = wallTime();
+
+    for (int i = 0; i < count; i++)
     {
-        // receive UDP packet
-        if (recvmsg(probe->sock, &msg, 0) < 0)
+        probes[i].sendTime = sendTime;
+    }
+
+    if (definition->maxTtl > 0)
+    {
+        // the TTL is a socket option, so every probe needs its own send
+        for (ret = 0; ret < count; ret++)
         {
-            LOG_WARNING(QString("recvmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
-            goto cleanup;
+            if (!setTtl(m_datagramSocket, m_destAddress.sa.sa_family, probes[ret].ttl) ||
+                sendmsg(m_datagramSocket, &m_burstMessages[ret].msg_hdr, 0) < 0)
+            {
+                LOG_WARNING(QString("sendmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+                break;
+            }
         }
+    }
+    else if ((ret = sendMessages(m_datagramSocket, m_burstMessages.data(), count)) < 0)
+    {
+        LOG_WARNING(QString("sendmmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return 0;
+    }
+
+    for (int i = 0; i < ret; i++)
+    {
+        probes[i].txId = m_datagramSendCount++;
+    }
 
-        udp_response = true;
+    return ret;
+}
 
-        // msg_name provides the source address if the initial request packet
-        // was successful
-        memcpy(&probe->source, &from, sizeof(sockaddr_any));
+bool Ping::sendTcpData(PingProbe *probe)
+{
+    int ret = 0;
+    int error_num = 0;
+    int slot = (probe - m_pingProbes.data()) % m_probeSlots.size();
+    struct epoll_event ev;
+
+    // the socket of the slot is gone if it could not be reset
+    if (m_tcpSockets[slot] < 0)
+    {
+        m_tcpSockets[slot] = initSocket(probe->port);
     }
 
-    if (msg.msg_flags & MSG_CTRUNC)
+    probe->sock = m_tcpSockets[slot];
+
+    if (probe->sock < 0)
     {
-        LOG_WARNING("control message buffer is too short to store all messages");
+        LOG_WARNING(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
     }
 
-    for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+    probe->sendTime = wallTime();
+
+    //for a TCP socket we only call connect (remember, the socket is non-blocking)
+    ret = ::connect(probe->sock, (sockaddr *)&m_destAddress, addressLength(m_destAddress));
+    error_num = errno;
+
+    if (ret < 0 && error_num == EINPROGRESS)
     {
-        void *ptr = CMSG_DATA(cm);
+        //the handshake is on its way, epoll tells us when it went through
+        //or when we received a reset (careful: when an error occured, the
+        //socket becomes also writeable)
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT | EPOLLERR;
+        ev.data.u64 = probe - m_pingProbes.data();
+
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, probe->sock, &ev) == 0)
+        {
+            return true;
+        }
 
-        switch (cm->cmsg_level)
+        LOG_WARNING(QString("epoll_ctl: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+    }
+    else
+    {
+        //connect could return immediately if called for host-local addresses
+        probe->recvTime = wallTime();
+        memcpy(&probe->source, &m_destAddress, sizeof(sockaddr_any));
+
+        if (ret == 0)
+        {
+            m_connectStatistics.add((probe->recvTime - probe->sendTime) / 1000000.);
+            emit tcpConnect(*probe);
+        }
+        else if (error_num == ECONNRESET || error_num == ECONNREFUSED)
         {
-        case SOL_SOCKET:
-            switch (cm->cmsg_type)
+            m_resetStatistics.add((probe->recvTime - probe->sendTime) / 1000000.);
+            emit tcpReset(*probe);
+        }
+        else
+        {
+            //unexpected
+            probe->recvTime = 0;
+            LOG_WARNING(QString("connect: %1").arg(QString::fromLocal8Bit(strerror(error_num))));
+        }
+    }
+
+    recycleTcpSocket(slot);
+    probe->sock = -1;
+
+    return false;
+}
+
+void Ping::receiveDatagrams(int sock)
+{
+    struct msghdr msg;
+    sockaddr_any from;
+    struct iovec iov;
+    char buf[1500];
+    char control[512];
+    struct cmsghdr *cm;
+    struct sock_extended_err *ee;
+    quint64 recvTime;
+    quint64 recvTimeSw;
+    ssize_t len;
+    int index;
+    bool answer;
+    bool ignore;
+
+    // drain everything the socket has queued, the socket never blocks here
+    forever
+    {
+        ee = NULL;
+        recvTime = 0;
+        recvTimeSw = 0;
+        answer = false;
+        ignore = false;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        if ((len = recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT)) < 0)
+        {
+            msg.msg_namelen = sizeof(from);
+            msg.msg_controllen = sizeof(control);
+
+            // receive UDP packet or ICMP echo reply
+            if ((len = recvmsg(sock, &msg, MSG_DONTWAIT)) < 0)
             {
-            case SO_TIMESTAMP:
-                tv = (struct timeval *) ptr;
-                probe->recvTime = tv->tv_sec * 1e6 + tv->tv_usec;
-                break;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG_WARNING(QString("recvmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+                }
+
+                return;
             }
 
-            break;
+            answer = true;
+        }
+
+        if (msg.msg_flags & MSG_CTRUNC)
+        {
+            LOG_WARNING("control message buffer is too short to store all messages");
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            void *ptr = CMSG_DATA(cm);
 
-        case SOL_IP:
-            switch (cm->cmsg_type)
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPNS)
+            {
+                recvTime = toNsec(*(struct timespec *) ptr);
+            }
+            else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPING)
+            {
+                recvTimeSw = readTimestamping(cm);
+            }
+            else if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                     (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
             {
-            case IP_RECVERR:
                 ee = (struct sock_extended_err *) ptr;
 
-                if (ee->ee_origin != SO_EE_ORIGIN_ICMP)
+                if (ee->ee_origin == SO_EE_ORIGIN_ICMP)
+                {
+                    ignore = ee->ee_type == ICMP_SOURCE_QUENCH || ee->ee_type == ICMP_REDIRECT;
+                }
+                else if (ee->ee_origin != SO_EE_ORIGIN_ICMP6 &&
+                         ee->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+                {
+                    // local errors don't tell anything about the path
+                    ignore = true;
+                }
+            }
+        }
+
+        if (ee && ee->ee_origin == SO_EE_ORIGIN_TIMESTAMPING)
+        {
+            // a looped back TX timestamp, its id is the datagram count
+            // (the error queue delivers it before the probe's answer)
+            foreach (int index, m_probeSlots)
+            {
+                if (index < 0 || m_pingProbes[index].txId != ee->ee_data)
                 {
-                    ee = NULL;
                     continue;
                 }
 
-                if (ee->ee_type == ICMP_SOURCE_QUENCH || ee->ee_type == ICMP_REDIRECT)
+                PingProbe *probe = &m_pingProbes[index];
+
+                if (recvTimeSw)
                 {
-                    goto cleanup;
+                    probe->sendTime = recvTimeSw;
+                    probe->timestampSource = ping::KernelTimestamp;
                 }
 
                 break;
+            }
 
-            default:
-                break;
+            continue;
+        }
+
+        if (ignore)
+        {
+            continue;
+        }
+
+        index = -1;
+
+        if (definition->type == ping::System)
+        {
+            // echo replies and the requests quoted by ICMP errors both carry
+            // the sequence number, which are the low bits of the probe index
+            struct icmphdr *icmp = (struct icmphdr *) buf;
+            quint8 replyType = m_destAddress.sa.sa_family == AF_INET6 ? ICMP6_ECHO_REPLY : ICMP_ECHOREPLY;
+
+            if (len < 8 || (answer && icmp->type != replyType))
+            {
+                continue;
             }
 
-            break;
+            foreach (int pending, m_probeSlots)
+            {
+                if (pending >= 0 && (pending & 0xffff) == ntohs(icmp->un.echo.sequence))
+                {
+                    index = pending;
+                    break;
+                }
+            }
+        }
+        else if (len >= (ssize_t) probeTagLength)
+        {
+            // the quoted (error queue) or echoed payload starts with the
+            // index of the probe, an answer to an expired probe must not be
+            // credited to the one which took over its slot
+            quint32 tag;
 
-        default:
-            break;
+            memcpy(&tag, buf, sizeof(tag));
+            tag = ntohl(tag);
+
+            if (tag < (quint32) m_pingProbes.size() &&
+                m_probeSlots[tag % m_probeSlots.size()] == (int) tag)
+            {
+                index = tag;
+            }
+        }
+        else if (m_pendingProbes == 1)
+        {
+            // routers quoting only the UDP header leave no tag, which is only
+            // unambiguous with a single probe in flight
+            foreach (int pending, m_probeSlots)
+            {
+                if (pending >= 0)
+                {
+                    index = pending;
+                    break;
+                }
+            }
         }
-    }
 
-    if (ee)
-    {
-        memcpy(&probe->source, SO_EE_OFFENDER(ee), sizeof(probe->source));
+        if (index < 0)
+        {
+            continue;
+        }
 
-        if (ee->ee_type == ICMP_TIME_EXCEEDED && ee->ee_code == ICMP_EXC_TTL)
+        PingProbe *probe = &m_pingProbes[index];
+
+        if (recvTime || recvTimeSw)
         {
-            emit ttlExceeded(*probe);
+            probe->recvTime = recvTime ? recvTime : recvTimeSw;
         }
-        else if (ee->ee_type == ICMP_DEST_UNREACH)
+        else
         {
-            emit destinationUnreachable(*probe);
+            probe->recvTime = wallTime();
+            probe->timestampSource = ping::UserTimestamp;
         }
-    }
 
-    if (udp_response)
-    {
-        emit udpResponse(*probe);
-    }
+        if (ee)
+        {
+            memcpy(&probe->source, SO_EE_OFFENDER(ee), sizeof(probe->source));
 
-cleanup:
-    return;
+            if ((ee->ee_origin == SO_EE_ORIGIN_ICMP && ee->ee_type == ICMP_TIME_EXCEEDED &&
+                 ee->ee_code == ICMP_EXC_TTL) ||
+                (ee->ee_origin == SO_EE_ORIGIN_ICMP6 && ee->ee_type == ICMP6_TIME_EXCEEDED &&
+                 ee->ee_code == ICMP6_TIME_EXCEED_TRANSIT))
+            {
+                emit ttlExceeded(*probe);
+            }
+            else if ((ee->ee_origin == SO_EE_ORIGIN_ICMP && ee->ee_type == ICMP_DEST_UNREACH) ||
+                     (ee->ee_origin == SO_EE_ORIGIN_ICMP6 && ee->ee_type == ICMP6_DST_UNREACH))
+            {
+                m_ttlLimit = qMin(m_ttlLimit, probe->ttl ? probe->ttl : 255);
+                emit destinationUnreachable(*probe);
+            }
+        }
+
+        if (answer)
+        {
+            // msg_name provides the source address if the initial request packet
+            // was successful
+            memcpy(&probe->source, &from, sizeof(sockaddr_any));
+
+            if (definition->type == ping::System)
+            {
+                emit ping((probe->recvTime - probe->sendTime) / 1000000);
+            }
+            else
+            {
+                m_ttlLimit = qMin(m_ttlLimit, probe->ttl ? probe->ttl : 255);
+                emit udpResponse(*probe);
+            }
+        }
+
+        finishProbe(probe);
+    }
 }
 
-void Ping::ping(PingProbe *probe)
+void Ping::receiveTcpData(PingProbe *probe)
 {
-    bool ret = false;
+    int error_num = 0;
+    socklen_t len = sizeof(error_num);
 
-    // send
-    if (definition->type == ping::Udp)
+    probe->recvTime = wallTime();
+    memcpy(&probe->source, &m_destAddress, sizeof(sockaddr_any));
+
+    //the call to connect could have failed (RST) or actually went through
+    //need to check
+    if (getsockopt(probe->sock, SOL_SOCKET, SO_ERROR, &error_num, &len) < 0)
     {
-        ret = sendUdpData(probe);
+        LOG_WARNING(QString("getsockopt: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        probe->recvTime = probe->sendTime;
     }
-    else if (definition->type == ping::Tcp)
+    else if (error_num == 0)
     {
-        ret = sendTcpData(probe);
+        //connection established
+        m_connectStatistics.add((probe->recvTime - probe->sendTime) / 1000000.);
+        emit tcpConnect(*probe);
     }
-
-    if (ret)
+    else if (error_num == ECONNRESET || error_num == ECONNREFUSED)
+    {
+        //we really expected this reset...
+        m_resetStatistics.add((probe->recvTime - probe->sendTime) / 1000000.);
+        emit tcpReset(*probe);
+    }
+    else
     {
-        receiveData(probe);
+        //unexpected, count the probe as lost
+        LOG_WARNING(QString("getsockopt: %1").arg(QString::fromLocal8Bit(strerror(error_num))));
+        probe->recvTime = probe->sendTime;
     }
+
+    finishProbe(probe);
 }
 
 void Ping::started()
 {
-    pingTime.clear();
+    m_rttStatistics.clear();
 
     setStatus(Ping::Running);
 }
@@ -837,7 +1421,7 @@ void Ping::readyRead()
         }
 
         float time = re.cap(1).toFloat();
-        pingTime.append(time);
+        m_rttStatistics.add(time);
 
         emit ping(time);
     }
@@ -850,14 +1434,12 @@ void Ping::waitForFinished()
 
 float Ping::averagePingTime() const
 {
-    float time = 0;
-
-    foreach (float t, pingTime)
-    {
-        time += t;
-    }
+    return m_rttStatistics.mean();
+}
 
-    return time / pingTime.size();
+void Ping::setTrafficCharged(bool charged)
+{
+    m_trafficCharged = charged;
 }
 
 // vim: set sts=4 sw=4 et:
@@ -5,7 +5,6 @@
 #include <sys/time.h>
 #include <poll.h>
 #include <fcntl.h>
-#include <numeric>
 
 #include <QtMath>
 
@@ -127,7 +126,7 @@ cleanup:
                         return false;
                     }
 
-                    time = tv_tmp->tv_sec * 1e6 + tv_tmp->tv_usec;
+                    time = tv_tmp->tv_sec * Q_UINT64_C(1000000000) + tv_tmp->tv_usec * 1000;
                     //we break after the first found timestamp, since on Mac OS there are
                     //multiple (I assume for now these are for Ethernet, IP and UDP).
                     //Tests showed they are increasing in the usec range whereas the first
@@ -147,6 +146,7 @@ Ping::Ping(QObject *parent)
 , m_device(NULL)
 , m_capture(NULL)
 , m_destAddress()
+, m_trafficCharged(false)
 , stream(&process)
 {
     connect(this, SIGNAL(error(const QString &)), this,
@@ -197,7 +197,7 @@ bool Ping::prepare(NetworkManager *networkManager, const MeasurementDefinitionPt
         return false;
     }
 
-    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
+    if (!m_trafficCharged && !Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
     {
         setErrorString("not enough traffic available");
         return false;
@@ -291,7 +291,7 @@ bool Ping::start()
     {
         if (probe.sendTime > 0 && probe.recvTime > 0 && probe.sendTime != probe.recvTime)
         {
-            pingTime.append((probe.recvTime - probe.sendTime) / 1000.);
+            m_rttStatistics.add((probe.recvTime - probe.sendTime) / 1000000.);
         }
     }
 
@@ -309,38 +309,14 @@ bool Ping::stop()
 Result Ping::result() const
 {
     QVariantMap res;
-    QVariantList roundTripMs;
-    float avg = 0.0;
-
-    // get max and min
-    QList<float>::const_iterator it = std::max_element(pingTime.begin(), pingTime.end());
-    float max = *it;
-    it = std::min_element(pingTime.begin(), pingTime.end());
-    float min = *it;
-
-    // calculate average and fill ping times
-    foreach (float val, pingTime)
-    {
-        roundTripMs << val;
-        avg += val;
-    }
-
-    qreal sq_sum = std::inner_product(pingTime.begin(), pingTime.end(), pingTime.begin(), 0.0);
-    qreal stdev = 0.0;
-
-    if (pingTime.size() > 0)
-    {
-        avg /= pingTime.size();
-        // calculate standard deviation
-        stdev = qSqrt(sq_sum / pingTime.size() - avg * avg);
-    }
-
-    res.insert("round_trip_avg", avg);
-    res.insert("round_trip_min", min);
-    res.insert("round_trip_max", max);
-    res.insert("round_trip_stdev", stdev);
-    res.insert("round_trip_count", pingTime.size());
-    res.insert("round_trip_ms", roundTripMs);
+    res.insert("round_trip_avg", m_rttStatistics.mean());
+    res.insert("round_trip_min", m_rttStatistics.min());
+    res.insert("round_trip_max", m_rttStatistics.max());
+    res.insert("round_trip_stdev", m_rttStatistics.stdev());
+    res.insert("round_trip_p50", m_rttStatistics.quantile(0.5));
+    res.insert("round_trip_p90", m_rttStatistics.quantile(0.9));
+    res.insert("round_trip_p99", m_rttStatistics.quantile(0.99));
+    res.insert("round_trip_count", static_cast<int>(m_rttStatistics.count()));
 
     return Result(res);
 }
@@ -544,7 +520,7 @@ bool Ping::sendUdpData(PingProbe *probe)
     memset(&tv, 0, sizeof(tv));
 
     gettimeofday(&tv, NULL);
-    probe->sendTime = tv.tv_sec * 1e6 + tv.tv_usec;
+    probe->sendTime = tv.tv_sec * Q_UINT64_C(1000000000) + tv.tv_usec * 1000;
 
     if (m_destAddress.sa.sa_family == AF_INET)
     {
@@ -585,7 +561,7 @@ bool Ping::sendTcpData(PingProbe *probe)
     int ret = 0;
 
     gettimeofday(&tv, NULL);
-    probe->sendTime = tv.tv_sec * 1e6 + tv.tv_usec;
+    probe->sendTime = tv.tv_sec * Q_UINT64_C(1000000000) + tv.tv_usec * 1000;
 
     if (m_destAddress.sa.sa_family == AF_INET)
     {
@@ -602,7 +578,7 @@ bool Ping::sendTcpData(PingProbe *probe)
     }
 
     gettimeofday(&tv, NULL);
-    probe->recvTime = tv.tv_sec * 1e6 + tv.tv_usec;
+    probe->recvTime = tv.tv_sec * Q_UINT64_C(1000000000) + tv.tv_usec * 1000;
     memcpy(&probe->source, &(m_destAddress), sizeof(sockaddr_any));
 
     //for a TCP socket we only call connect (remeber, the socket is non-blocking)
@@ -668,7 +644,7 @@ bool Ping::sendTcpData(PingProbe *probe)
             }
 
             gettimeofday(&tv, NULL);
-            probe->recvTime = tv.tv_sec * 1e6 + tv.tv_usec;
+            probe->recvTime = tv.tv_sec * Q_UINT64_C(1000000000) + tv.tv_usec * 1000;
             memcpy(&probe->source, &(m_destAddress), sizeof(sockaddr_any));
 
             if (error_num == 0)
@@ -764,7 +740,7 @@ void Ping::receiveData(PingProbe *probe)
     //will be overwritten if the packet was timestamped by the kernel
     //note: on Mavericks (10.9.3) the kernel did
     gettimeofday(&tv, NULL);
-    probe->recvTime = tv.tv_sec * 1e6 + tv.tv_usec;
+    probe->recvTime = tv.tv_sec * Q_UINT64_C(1000000000) + tv.tv_usec * 1000;
 
     if (ret == 0)
     {
@@ -868,7 +844,7 @@ void Ping::ping(PingProbe *probe)
 
 void Ping::started()
 {
-    pingTime.clear();
+    m_rttStatistics.clear();
 
     setStatus(Ping::Running);
 }
@@ -895,7 +871,7 @@ void Ping::readyRead()
         }
 
         float time = re.cap(1).toFloat();
-        pingTime.append(time);
+        m_rttStatistics.add(time);
 
         emit ping(time);
     }
@@ -908,14 +884,12 @@ void Ping::waitForFinished()
 
 float Ping::averagePingTime() const
 {
-    float time = 0;
-
-    foreach (float t, pingTime)
-    {
-        time += t;
-    }
+    return m_rttStatistics.mean();
+}
 
-    return time / pingTime.size();
+void Ping::setTrafficCharged(bool charged)
+{
+    m_trafficCharged = charged;
 }
 
 // vim: set sts=4 sw=4 et:
@@ -8,7 +8,6 @@
 #include <mswsock.h>
 #include <Mstcpip.h>
 #include <pcap.h>
-#include <numeric>
 
 #include <QCryptographicHash>
 #include <QThread>
@@ -107,15 +106,15 @@ namespace
                  * This however cannot be determined, as such a response most likely will not
                  * echo back our packet/payload which we could analyse.
                  */
-                probe.recvTime = header->ts.tv_sec * 1e6 +
-                                 header->ts.tv_usec;
+                probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                 header->ts.tv_usec * 1000;
                 probe.response = ping::UDP_RESPONSE;
                 getAddress(sourceAddress, &probe.source);
             }
             else
             {
                 // UDP request
-                probe.sendTime = header->ts.tv_sec * 1e6 + header->ts.tv_usec;
+                probe.sendTime = header->ts.tv_sec * Q_UINT64_C(1000000000) + header->ts.tv_usec * 1000;
                 payload = QByteArray::fromRawData(reinterpret_cast<char *>(const_cast<u_char *>(data + 42)),
                                                   payloadSize);
                 probe.hash = QCryptographicHash::hash(payload, QCryptographicHash::Sha256).toHex();
@@ -130,8 +129,8 @@ namespace
             if (!strncmp(sourceAddress, destinationAddress, INET_ADDRSTRLEN))
             {
                 // TCP response (SYN-ACK or RST)
-                probe.recvTime = header->ts.tv_sec * 1e6 +
-                                 header->ts.tv_usec;
+                probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                 header->ts.tv_usec * 1000;
                 getAddress(sourceAddress, &probe.source);
 
                 // swap bytes of tcp flags
@@ -154,7 +153,7 @@ namespace
             else
             {
                 // TCP request
-                probe.sendTime = header->ts.tv_sec * 1e6 + header->ts.tv_usec;
+                probe.sendTime = header->ts.tv_sec * Q_UINT64_C(1000000000) + header->ts.tv_usec * 1000;
             }
 
             break;
@@ -181,8 +180,8 @@ namespace
                 if (strncmp(sourceAddress, destinationAddress,
                             INET_ADDRSTRLEN) == 0)
                 {
-                    probe.recvTime = header->ts.tv_sec * 1e6 +
-                                     header->ts.tv_usec;
+                    probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                     header->ts.tv_usec * 1000;
                     probe.response = *icmpType == 3
                                      ? ping::DESTINATION_UNREACHABLE
                                      : ping::TTL_EXCEEDED;
@@ -261,15 +260,15 @@ namespace
             if (!strncmp(sourceAddress, destinationAddress, INET6_ADDRSTRLEN))
             {
                 // UDP response
-                probe.recvTime = header->ts.tv_sec * 1e6 +
-                                 header->ts.tv_usec;
+                probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                 header->ts.tv_usec * 1000;
                 probe.response = ping::UDP_RESPONSE;
                 getAddress(sourceAddress, &probe.source);
             }
             else
             {
                 // UDP request
-                probe.sendTime = header->ts.tv_sec * 1e6 + header->ts.tv_usec;
+                probe.sendTime = header->ts.tv_sec * Q_UINT64_C(1000000000) + header->ts.tv_usec * 1000;
                 payload = QByteArray::fromRawData(reinterpret_cast<char *>(const_cast<u_char *>(data + 62)),
                                                   payloadSize);
                 probe.hash = QCryptographicHash::hash(payload, QCryptographicHash::Sha256).toHex();
@@ -284,8 +283,8 @@ namespace
             if (!strncmp(sourceAddress, destinationAddress, INET_ADDRSTRLEN))
             {
                 // TCP response (SYN-ACK or RST)
-                probe.recvTime = header->ts.tv_sec * 1e6 +
-                                 header->ts.tv_usec;
+                probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                 header->ts.tv_usec * 1000;
                 getAddress(sourceAddress, &probe.source);
 
                 // swap bytes of tcp flags
@@ -308,7 +307,7 @@ namespace
             else
             {
                 // TCP request
-                probe.sendTime = header->ts.tv_sec * 1e6 + header->ts.tv_usec;
+                probe.sendTime = header->ts.tv_sec * Q_UINT64_C(1000000000) + header->ts.tv_usec * 1000;
             }
 
             break;
@@ -332,8 +331,8 @@ namespace
                 if (strncmp(sourceAddress, destinationAddress,
                             INET6_ADDRSTRLEN) == 0)
                 {
-                    probe.recvTime = header->ts.tv_sec * 1e6 +
-                                     header->ts.tv_usec;
+                    probe.recvTime = header->ts.tv_sec * Q_UINT64_C(1000000000) +
+                                     header->ts.tv_usec * 1000;
                     probe.response = *icmpType == 1
                                      ? ping::DESTINATION_UNREACHABLE
                                      : ping::TTL_EXCEEDED;
@@ -494,6 +493,7 @@ Ping::Ping(QObject *parent)
 , m_device(NULL)
 , m_capture(NULL)
 , m_destAddress()
+, m_trafficCharged(false)
 , stream(&process)
 {
     connect(this, SIGNAL(error(const QString &)), this,
@@ -556,7 +556,7 @@ bool Ping::prepare(NetworkManager *networkManager, const MeasurementDefinitionPt
         return false;
     }
 
-    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
+    if (!m_trafficCharged && !Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
     {
         setErrorString("not enough traffic available");
         return false;
@@ -726,38 +726,14 @@ bool Ping::stop()
 Result Ping::result() const
 {
     QVariantMap res;
-    QVariantList roundTripMs;
-    float avg = 0.0;
-
-    // get max and min
-    QList<float>::const_iterator it = std::max_element(pingTime.begin(), pingTime.end());
-    float max = *it;
-    it = std::min_element(pingTime.begin(), pingTime.end());
-    float min = *it;
-
-    // calculate average and fill ping times
-    foreach (float val, pingTime)
-    {
-        roundTripMs << val;
-        avg += val;
-    }
-
-    qreal sq_sum = std::inner_product(pingTime.begin(), pingTime.end(), pingTime.begin(), 0.0);
-    qreal stdev = 0.0;
-
-    if (pingTime.size() > 0)
-    {
-        avg /= pingTime.size();
-        // calculate standard deviation
-        stdev = qSqrt(sq_sum / pingTime.size() - avg * avg);
-    }
-
-    res.insert("round_trip_avg", avg);
-    res.insert("round_trip_min", min);
-    res.insert("round_trip_max", max);
-    res.insert("round_trip_stdev", stdev);
-    res.insert("round_trip_count", pingTime.size());
-    res.insert("round_trip_ms", roundTripMs);
+    res.insert("round_trip_avg", m_rttStatistics.mean());
+    res.insert("round_trip_min", m_rttStatistics.min());
+    res.insert("round_trip_max", m_rttStatistics.max());
+    res.insert("round_trip_stdev", m_rttStatistics.stdev());
+    res.insert("round_trip_p50", m_rttStatistics.quantile(0.5));
+    res.insert("round_trip_p90", m_rttStatistics.quantile(0.9));
+    res.insert("round_trip_p99", m_rttStatistics.quantile(0.99));
+    res.insert("round_trip_count", static_cast<int>(m_rttStatistics.count()));
 
     return Result(res);
 }
@@ -1041,7 +1017,7 @@ void Ping::ping(PingProbe *probe)
     {
         if (probe.sendTime > 0 && probe.recvTime > 0)
         {
-            pingTime.append((probe.recvTime - probe.sendTime) / 1000.);
+            m_rttStatistics.add((probe.recvTime - probe.sendTime) / 1000000.);
         }
     }
 }
@@ -1234,7 +1210,7 @@ void Ping::processTcpPackets(QVector<PingProbe> *probes)
 
 void Ping::started()
 {
-    pingTime.clear();
+    m_rttStatistics.clear();
 
     setStatus(Ping::Running);
 }
@@ -1261,7 +1237,7 @@ void Ping::readyRead()
         }
 
         float time = re.cap(1).toFloat();
-        pingTime.append(time);
+        m_rttStatistics.add(time);
 
         emit ping(time);
     }
@@ -1274,14 +1250,12 @@ void Ping::waitForFinished()
 
 float Ping::averagePingTime() const
 {
-    float time = 0;
-
-    foreach (float t, pingTime)
-    {
-        time += t;
-    }
+    return m_rttStatistics.mean();
+}
 
-    return time / pingTime.size();
+void Ping::setTrafficCharged(bool charged)
+{
+    m_trafficCharged = charged;
 }
 
 // vim: set sts=4 sw=4 et:
@@ -0,0 +1,649 @@
+#include "ping_sweep.h"
+#include "../../log/logger.h"
+#include "../../client.h"
+#include "../../trafficbudgetmanager.h"
+
+#include <QHostInfo>
+
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/errqueue.h>
+#include <linux/icmp.h>
+#include <netinet/icmp6.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+LOGGER(PingSweep);
+
+namespace
+{
+    // probes of all targets waiting for an answer at the same time, each of
+    // them occupies its own destination port
+    const int maxProbesInFlight = 256;
+
+#if defined(Q_OS_LINUX)
+    const int maxEvents = 16;
+#endif
+}
+
+PingSweep::PingSweep(QObject *parent)
+: Measurement(parent)
+#if defined(Q_OS_LINUX)
+, m_epollFd(-1)
+, m_pendingProbes(0)
+#endif
+, currentStatus(Unknown)
+{
+#if defined(Q_OS_LINUX)
+    m_sockets[0] = -1;
+    m_sockets[1] = -1;
+#endif
+
+    connect(this, SIGNAL(error(const QString &)), this,
+            SLOT(setErrorString(const QString &)));
+}
+
+PingSweep::~PingSweep()
+{
+}
+
+Measurement::Status PingSweep::status() const
+{
+    return currentStatus;
+}
+
+void PingSweep::setStatus(Status status)
+{
+    if (currentStatus != status)
+    {
+        currentStatus = status;
+        emit statusChanged(status);
+    }
+}
+
+bool PingSweep::prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition)
+{
+    Q_UNUSED(networkManager);
+
+    definition = measurementDefinition.dynamicCast<PingSweepDefinition>();
+
+    if (definition.isNull())
+    {
+        setErrorString("Definition is empty");
+        return false;
+    }
+
+#if defined(Q_OS_LINUX)
+
+    if (definition->type != ping::Udp)
+    {
+        setErrorString("Ping type not supported");
+        return false;
+    }
+
+    if (definition->hosts.isEmpty())
+    {
+        setErrorString("no hosts given");
+        return false;
+    }
+
+    if (definition->payload > 1400)
+    {
+        setErrorString("payload is too large (> 1400 bytes)");
+        return false;
+    }
+
+    if (definition->receiveTimeout > 60000)
+    {
+        setErrorString("receive timeout is too large (> 60 s)");
+        return false;
+    }
+
+    if (definition->rate == 0 || definition->rate > 10000)
+    {
+        setErrorString("rate must be between 1 and 10000 probes per second");
+        return false;
+    }
+
+    if (definition->destinationPort == 0 || definition->destinationPort > 65535 - maxProbesInFlight)
+    {
+        setErrorString(QString("destination port must be between 1 and %1").arg(65535 - maxProbesInFlight));
+        return false;
+    }
+
+    m_targets.clear();
+    m_targets.resize(definition->hosts.size());
+
+    for (int i = 0; i < definition->hosts.size(); i++)
+    {
+        m_targets[i].host = definition->hosts.at(i);
+    }
+
+    m_payload.fill('X', definition->payload);
+
+    return true;
+#else
+    setErrorString("ping_sweep is not supported on this platform");
+    return false;
+#endif
+}
+
+bool PingSweep::start()
+{
+    setStatus(PingSweep::Running);
+
+#if defined(Q_OS_LINUX)
+    // the names are looked up in parallel, the sweep must not block on DNS
+    // and starts once the last answer is in
+    m_lookups.clear();
+
+    for (int i = 0; i < m_targets.size(); i++)
+    {
+        m_lookups.insert(QHostInfo::lookupHost(m_targets[i].host, this, SLOT(hostResolved(QHostInfo))), i);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PingSweep::hostResolved(const QHostInfo &info)
+{
+#if defined(Q_OS_LINUX)
+
+    if (!m_lookups.contains(info.lookupId()))
+    {
+        return;
+    }
+
+    PingSweepTarget &target = m_targets[m_lookups.take(info.lookupId())];
+
+    if (info.error() == QHostInfo::NoError)
+    {
+        foreach (const QHostAddress &address, info.addresses())
+        {
+            if (toSockaddr(address, &target.address))
+            {
+                target.resolved = true;
+                break;
+            }
+        }
+    }
+
+    if (!target.resolved)
+    {
+        LOG_WARNING(QString("could not resolve hostname '%1'").arg(target.host));
+    }
+
+    if (!m_lookups.isEmpty())
+    {
+        return;
+    }
+
+    // only the resolved targets are probed
+    if (!Client::instance()->trafficBudgetManager()->addUsedTraffic(estimateTraffic()))
+    {
+        emit error("not enough traffic available");
+        return;
+    }
+
+    if (!runSweep())
+    {
+        emit error(errorString());
+        return;
+    }
+
+    setStatus(PingSweep::Finished);
+    emit Measurement::finished();
+#else
+    Q_UNUSED(info);
+#endif
+}
+
+bool PingSweep::stop()
+{
+    foreach (int id, m_lookups.keys())
+    {
+        QHostInfo::abortHostLookup(id);
+    }
+
+    m_lookups.clear();
+
+    return true;
+}
+
+Result PingSweep::result() const
+{
+    QVariantList targets;
+    int unresolved = 0;
+
+    foreach (const PingSweepTarget &target, m_targets)
+    {
+        QVariantMap res;
+        res.insert("host", target.host);
+
+        if (!target.resolved)
+        {
+            res.insert("error", "could not resolve hostname");
+            targets << res;
+            unresolved++;
+            continue;
+        }
+
+#if defined(Q_OS_LINUX)
+        res.insert("address", addressToString(target.address));
+#endif
+        res.insert("sent", target.sent);
+        res.insert("received", static_cast<int>(target.pingTime.count()));
+        res.insert("errors", target.errors);
+        res.insert("round_trip_avg", target.pingTime.mean());
+        res.insert("round_trip_min", target.pingTime.min());
+        res.insert("round_trip_max", target.pingTime.max());
+        res.insert("round_trip_stdev", target.pingTime.stdev());
+
+        targets << res;
+    }
+
+    QVariantMap map;
+    map.insert("results", targets);
+    map.insert("target_count", m_targets.size());
+    map.insert("unresolved_count", unresolved);
+
+    return Result(map);
+}
+
+quint32 PingSweep::estimateTraffic() const
+{
+    quint32 est = 0;
+
+    // same per probe estimation as for a UDP ping
+    foreach (const PingSweepTarget &target, m_targets)
+    {
+        if (!target.resolved)
+        {
+            continue;
+        }
+
+        quint32 probe = 2 * 14 + 2 * (8 + definition->payload);  // Ethernet + UDP header + payload
+
+        if (target.address.sa.sa_family == AF_INET6)
+        {
+            probe += 2 * 40 + 56;  // IPv6 header + ICMPv6 response
+        }
+        else
+        {
+            probe += 2 * 20 + 36;  // IPv4 header + ICMPv4 response
+        }
+
+        est += probe * definition->count;
+    }
+
+    return est;
+}
+
+#if defined(Q_OS_LINUX)
+
+int PingSweep::initSocket(int family)
+{
+    int n = 1;
+    int ttl = definition->ttl ? definition->ttl : 64;
+    sockaddr_any src_addr;
+    int sock = socket(family, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+
+    if (sock < 0)
+    {
+        setErrorString(QString("socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return -1;
+    }
+
+    memset(&src_addr, 0, sizeof(src_addr));
+    src_addr.sa.sa_family = family;
+
+    if (family == AF_INET6)
+    {
+        // the IPv4 socket may use the same source port
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &n, sizeof(n)) < 0 ||
+            setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &n, sizeof(n)) < 0 ||
+            setsockopt(sock, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &ttl, sizeof(ttl)) < 0)
+        {
+            setErrorString(QString("setsockopt: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            goto cleanup;
+        }
+
+        src_addr.sin6.sin6_port = htons(definition->sourcePort);
+    }
+    else
+    {
+        if (setsockopt(sock, SOL_IP, IP_RECVERR, &n, sizeof(n)) < 0 ||
+            setsockopt(sock, SOL_IP, IP_TTL, &ttl, sizeof(ttl)) < 0)
+        {
+            setErrorString(QString("setsockopt: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            goto cleanup;
+        }
+
+        src_addr.sin.sin_port = htons(definition->sourcePort);
+    }
+
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &n, sizeof(n)) < 0)
+    {
+        setErrorString(QString("setsockopt SO_TIMESTAMPNS: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
+
+    if (bind(sock, &src_addr.sa, addressLength(src_addr)) < 0)
+    {
+        setErrorString(QString("bind: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        goto cleanup;
+    }
+
+    return sock;
+
+cleanup:
+    close(sock);
+    return -1;
+}
+
+/*
+ * All targets share one event loop: probes go out round-robin over the
+ * targets at the configured global rate, each probe in flight owns a slot
+ * which is encoded in its destination port. Answers are matched by that port
+ * and by the address of the target, a probe is lost once its own deadline
+ * has passed.
+ */
+bool PingSweep::runSweep()
+{
+    struct epoll_event ev;
+    struct epoll_event events[maxEvents];
+    QVector<int> order;
+    quint32 sent = 0;
+    quint32 total = 0;
+    quint64 gap = Q_UINT64_C(1000000000) / definition->rate;
+    quint64 nextSend = monotonicTime();
+    bool result = true;
+
+    for (int i = 0; i < m_targets.size(); i++)
+    {
+        if (m_targets[i].resolved)
+        {
+            order.append(i);
+        }
+    }
+
+    total = order.size() * definition->count;
+
+    if (total == 0)
+    {
+        // nothing to do, the result lists the unresolved hosts
+        return true;
+    }
+
+    SweepProbe empty = {-1, 0, 0};
+    m_probeSlots.fill(empty, qMin<int>(total, maxProbesInFlight));
+    m_pendingProbes = 0;
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (m_epollFd < 0)
+    {
+        setErrorString(QString("epoll_create: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+
+    // only open the sockets for the address families needed
+    for (int i = 0; i < 2; i++)
+    {
+        int family = i ? AF_INET6 : AF_INET;
+        bool needed = false;
+
+        foreach (int index, order)
+        {
+            needed |= m_targets[index].address.sa.sa_family == family;
+        }
+
+        if (!needed)
+        {
+            continue;
+        }
+
+        m_sockets[i] = initSocket(family);
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLERR;
+        ev.data.fd = m_sockets[i];
+
+        if (m_sockets[i] < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_sockets[i], &ev) < 0)
+        {
+            if (m_sockets[i] >= 0)
+            {
+                setErrorString(QString("epoll_ctl: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            }
+
+            result = false;
+            goto cleanup;
+        }
+    }
+
+    while (sent < total || m_pendingProbes > 0)
+    {
+        quint64 now = monotonicTime();
+        int slot = sent % m_probeSlots.size();
+        bool canSend = sent < total && m_probeSlots[slot].target < 0;
+
+        if (canSend && now >= nextSend)
+        {
+            sendProbe(order[sent % order.size()], slot);
+
+            // keep the global rate, but don't burst if we fell behind
+            nextSend = qMax(nextSend + gap, now);
+            sent++;
+            continue;
+        }
+
+        expireProbes(now);
+
+        // sleep until the next probe is due or the next deadline passes
+        quint64 wakeup = canSend ? nextSend : Q_UINT64_C(0xffffffffffffffff);
+
+        foreach (const SweepProbe &probe, m_probeSlots)
+        {
+            if (probe.target >= 0)
+            {
+                wakeup = qMin(wakeup, probe.deadline);
+            }
+        }
+
+        if (wakeup == Q_UINT64_C(0xffffffffffffffff))
+        {
+            continue;
+        }
+
+        int timeout = wakeup > now ? (wakeup - now + 999999) / 1000000 : 0;
+        int n = epoll_wait(m_epollFd, events, maxEvents, timeout);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            setErrorString(QString("epoll_wait: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            result = false;
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            receiveData(events[i].data.fd);
+        }
+    }
+
+cleanup:
+    expireProbes(Q_UINT64_C(0xffffffffffffffff));
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (m_sockets[i] >= 0)
+        {
+            close(m_sockets[i]);
+            m_sockets[i] = -1;
+        }
+    }
+
+    close(m_epollFd);
+    m_epollFd = -1;
+
+    return result;
+}
+
+bool PingSweep::sendProbe(int target, int slot)
+{
+    PingSweepTarget &t = m_targets[target];
+    sockaddr_any dest = t.address;
+    int sock = m_sockets[dest.sa.sa_family == AF_INET6 ? 1 : 0];
+
+    setPort(&dest, definition->destinationPort + slot);
+
+    t.sent++;
+
+    SweepProbe &probe = m_probeSlots[slot];
+    probe.sendTime = wallTime();
+
+    if (sendto(sock, m_payload.constData(), m_payload.size(), 0, &dest.sa, addressLength(dest)) < 0)
+    {
+        LOG_WARNING(QString("sendto %1: %2").arg(t.host).arg(QString::fromLocal8Bit(strerror(errno))));
+        t.errors++;
+        return false;
+    }
+
+    probe.target = target;
+    probe.deadline = monotonicTime() + (quint64)definition->receiveTimeout * 1000000;
+    m_pendingProbes++;
+
+    return true;
+}
+
+void PingSweep::receiveData(int sock)
+{
+    struct msghdr msg;
+    sockaddr_any from;
+    struct iovec iov;
+    char buf[1500];
+    char control[256];
+    struct cmsghdr *cm;
+    struct sock_extended_err *ee;
+    quint64 recvTime;
+    bool ignore;
+
+    // drain the error queue and the socket, the socket never blocks
+    forever
+    {
+        ee = NULL;
+        recvTime = 0;
+        ignore = false;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            msg.msg_namelen = sizeof(from);
+            msg.msg_controllen = sizeof(control);
+
+            if (recvmsg(sock, &msg, MSG_DONTWAIT) < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG_WARNING(QString("recvmsg: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+                }
+
+                return;
+            }
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPNS)
+            {
+                recvTime = toNsec(*(struct timespec *) CMSG_DATA(cm));
+            }
+            else if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                     (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                ee = (struct sock_extended_err *) CMSG_DATA(cm);
+
+                if (ee->ee_origin == SO_EE_ORIGIN_ICMP)
+                {
+                    ignore = ee->ee_type == ICMP_SOURCE_QUENCH || ee->ee_type == ICMP_REDIRECT;
+                }
+                else if (ee->ee_origin != SO_EE_ORIGIN_ICMP6)
+                {
+                    ignore = true;
+                }
+            }
+        }
+
+        // msg_name is the original destination for errors and the target
+        // itself for UDP answers, both carry the probe's port
+        int slot = getPort(from) - definition->destinationPort;
+
+        if (ignore || slot < 0 || slot >= m_probeSlots.size() || m_probeSlots[slot].target < 0)
+        {
+            continue;
+        }
+
+        SweepProbe &probe = m_probeSlots[slot];
+        PingSweepTarget &target = m_targets[probe.target];
+
+        if (!sameHost(from, target.address))
+        {
+            continue;
+        }
+
+        // only answers of the target itself count as reply, anything a
+        // router sends back means the target was not reached
+        if (!ee || sameHost(*(sockaddr_any *) SO_EE_OFFENDER(ee), target.address))
+        {
+            quint64 rtt = (recvTime ? recvTime : wallTime()) - probe.sendTime;
+            target.pingTime.add(rtt / 1000000.);
+        }
+        else
+        {
+            target.errors++;
+        }
+
+        finishProbe(slot);
+    }
+}
+
+void PingSweep::expireProbes(quint64 now)
+{
+    for (int slot = 0; slot < m_probeSlots.size(); slot++)
+    {
+        if (m_probeSlots[slot].target >= 0 && m_probeSlots[slot].deadline <= now)
+        {
+            // lost probes only show up as the difference of sent and received
+            finishProbe(slot);
+        }
+    }
+}
+
+void PingSweep::finishProbe(int slot)
+{
+    m_probeSlots[slot].target = -1;
+    m_pendingProbes--;
+}
+
+#endif
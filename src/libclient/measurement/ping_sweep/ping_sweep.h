@@ -0,0 +1,88 @@
+#ifndef PING_SWEEP_H
+#define PING_SWEEP_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QHostInfo>
+
+#include "../measurement.h"
+#include "../ping/ping.h"
+#include "ping_sweep_definition.h"
+
+struct PingSweepTarget
+{
+    QString host;
+    sockaddr_any address;
+    bool resolved;
+    quint32 sent;
+    quint32 errors;
+    // ms
+    Statistics pingTime;
+
+    PingSweepTarget()
+    : address()
+    , resolved(false)
+    , sent(0)
+    , errors(0)
+    {}
+};
+
+class PingSweep : public Measurement
+{
+    Q_OBJECT
+
+public:
+    explicit PingSweep(QObject *parent = 0);
+    ~PingSweep();
+
+    // Measurement interface
+    Status status() const;
+    bool prepare(NetworkManager *networkManager, const MeasurementDefinitionPtr &measurementDefinition);
+    bool start();
+    bool stop();
+    Result result() const;
+
+private:
+    quint32 estimateTraffic() const;
+    void setStatus(Status status);
+
+#if defined(Q_OS_LINUX)
+    struct SweepProbe
+    {
+        int target;
+        quint64 sendTime;
+        quint64 deadline;
+    };
+
+    int initSocket(int family);
+    bool runSweep();
+    bool sendProbe(int target, int slot);
+    void receiveData(int sock);
+    void expireProbes(quint64 now);
+    void finishProbe(int slot);
+
+    // one UDP socket per address family shared by all targets
+    int m_epollFd;
+    int m_sockets[2];
+    QVector<SweepProbe> m_probeSlots;
+    quint32 m_pendingProbes;
+#endif
+
+    PingSweepDefinitionPtr definition;
+    Status currentStatus;
+    QVector<PingSweepTarget> m_targets;
+    // lookup id to the index of the target
+    QHash<int, int> m_lookups;
+    QByteArray m_payload;
+
+private slots:
+    void hostResolved(const QHostInfo &info);
+
+signals:
+    void statusChanged(Status status);
+};
+
+#endif // PING_SWEEP_H
@@ -0,0 +1,53 @@
+#include "ping_sweep_definition.h"
+
+PingSweepDefinition::PingSweepDefinition(const QStringList &hosts, const quint32 &count, const quint32 &rate,
+                                         const quint32 &receiveTimeout, const int &ttl,
+                                         const quint16 &destinationPort, const quint16 &sourcePort,
+                                         const quint32 &payload, const ping::PingType &type)
+: hosts(hosts)
+, count(count)
+, rate(rate)
+, receiveTimeout(receiveTimeout)
+, ttl(ttl)
+, destinationPort(destinationPort)
+, sourcePort(sourcePort)
+, payload(payload)
+, type(type)
+{
+
+}
+
+PingSweepDefinition::~PingSweepDefinition()
+{
+
+}
+
+PingSweepDefinitionPtr PingSweepDefinition::fromVariant(const QVariant &variant)
+{
+    QVariantMap map = variant.toMap();
+    return PingSweepDefinitionPtr(new PingSweepDefinition(map.value("hosts").toStringList(),
+                                                          map.value("count", 3).toUInt(),
+                                                          map.value("rate", 100).toUInt(),
+                                                          map.value("timeout", 1000).toUInt(),
+                                                          map.value("ttl", 64).toInt(),
+                                                          map.value("destination_port", 33434).toUInt(),
+                                                          map.value("source_port", 0).toUInt(),
+                                                          map.value("payload", 74).toUInt(),
+                                                          pingTypeFromString(map.value(
+                                                                                 "type", "Udp").toString().toLatin1())));
+}
+
+QVariant PingSweepDefinition::toVariant() const
+{
+    QVariantMap map;
+    map.insert("hosts", hosts);
+    map.insert("count", count);
+    map.insert("rate", rate);
+    map.insert("timeout", receiveTimeout);
+    map.insert("ttl", ttl);
+    map.insert("destination_port", destinationPort);
+    map.insert("source_port", sourcePort);
+    map.insert("payload", payload);
+    map.insert("type", pingTypeToString(type));
+    return map;
+}
@@ -0,0 +1,42 @@
+#ifndef PING_SWEEP_DEFINITION_H
+#define PING_SWEEP_DEFINITION_H
+
+#include "../measurementdefinition.h"
+#include "../../types.h"
+
+#include <QStringList>
+
+class PingSweepDefinition;
+
+typedef QSharedPointer<PingSweepDefinition> PingSweepDefinitionPtr;
+typedef QList<PingSweepDefinitionPtr> PingSweepDefinitionList;
+
+class PingSweepDefinition : public MeasurementDefinition
+{
+public:
+    ~PingSweepDefinition();
+    PingSweepDefinition(const QStringList &hosts, const quint32 &count, const quint32 &rate,
+                        const quint32 &receiveTimeout, const int &ttl, const quint16 &destinationPort,
+                        const quint16 &sourcePort, const quint32 &payload, const ping::PingType &type);
+
+    // Storage
+    static PingSweepDefinitionPtr fromVariant(const QVariant &variant);
+
+    // Getters
+    QStringList hosts;
+    // probes per target
+    quint32 count;
+    // probes per second over all targets
+    quint32 rate;
+    quint32 receiveTimeout;
+    int ttl;
+    quint16 destinationPort;
+    quint16 sourcePort;
+    quint32 payload;
+    ping::PingType type;
+
+    // Serializable interface
+    QVariant toVariant() const;
+};
+
+#endif // PING_SWEEP_DEFINITION_H
@@ -0,0 +1,21 @@
+#include "ping_sweep_plugin.h"
+#include "ping_sweep.h"
+#include "ping_sweep_definition.h"
+
+QStringList PingSweepPlugin::measurements() const
+{
+    return QStringList()
+           << "ping_sweep";
+}
+
+MeasurementPtr PingSweepPlugin::createMeasurement(const QString &name)
+{
+    Q_UNUSED(name);
+    return MeasurementPtr(new PingSweep);
+}
+
+MeasurementDefinitionPtr PingSweepPlugin::createMeasurementDefinition(const QString &name, const QVariant &data)
+{
+    Q_UNUSED(name);
+    return PingSweepDefinition::fromVariant(data);
+}
@@ -0,0 +1,18 @@
+#ifndef PING_SWEEP_PLUGIN_H
+#define PING_SWEEP_PLUGIN_H
+
+#include "../measurement.h"
+#include "../measurementdefinition.h"
+#include "../measurementplugin.h"
+
+class PingSweepPlugin : public MeasurementPlugin
+{
+public:
+    // MeasurementPlugin interface
+    QStringList measurements() const;
+
+    MeasurementPtr createMeasurement(const QString &name);
+    MeasurementDefinitionPtr createMeasurementDefinition(const QString &name, const QVariant &data);
+};
+
+#endif // PING_SWEEP_PLUGIN_H
@@ -0,0 +1,280 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QVector>
+
+/*
+ * Mergeable quantile sketch with a relative error guarantee. Values are
+ * counted in buckets with logarithmically growing bounds, a quantile is
+ * reported with at most relativeAccuracy error relative to its true value.
+ * If the values span more than maxBuckets buckets the lowest buckets are
+ * collapsed, this keeps the memory bounded and only costs accuracy in the
+ * lowest quantiles.
+ *
+ * Values below minValue() (including zero and negative values) are counted
+ * as zero.
+ */
+class QuantileSketch
+{
+public:
+    explicit QuantileSketch(qreal relativeAccuracy = 0.01, int maxBuckets = 1024)
+    : m_gamma((1 + relativeAccuracy) / (1 - relativeAccuracy))
+    , m_logGamma(qLn(m_gamma))
+    , m_maxBuckets(maxBuckets)
+    , m_offset(0)
+    , m_zeroCount(0)
+    , m_count(0)
+    {
+    }
+
+    void add(qreal value)
+    {
+        m_count++;
+
+        if (value < minValue())
+        {
+            m_zeroCount++;
+            return;
+        }
+
+        insert(qCeil(qLn(value) / m_logGamma), 1);
+    }
+
+    // both sketches must use the same relative accuracy
+    void merge(const QuantileSketch &other)
+    {
+        for (int i = 0; i < other.m_buckets.size(); i++)
+        {
+            if (other.m_buckets[i])
+            {
+                insert(other.m_offset + i, other.m_buckets[i]);
+            }
+        }
+
+        m_zeroCount += other.m_zeroCount;
+        m_count += other.m_count;
+    }
+
+    // q in [0, 1], returns 0 if nothing was added
+    qreal quantile(qreal q) const
+    {
+        if (m_count == 0)
+        {
+            return 0.0;
+        }
+
+        quint64 rank = qBound(0.0, q, 1.0) * (m_count - 1);
+        quint64 seen = m_zeroCount;
+
+        if (rank < seen)
+        {
+            return 0.0;
+        }
+
+        for (int i = 0; i < m_buckets.size(); i++)
+        {
+            seen += m_buckets[i];
+
+            if (seen > rank)
+            {
+                return bucketValue(m_offset + i);
+            }
+        }
+
+        return bucketValue(m_offset + m_buckets.size() - 1);
+    }
+
+    quint64 count() const
+    {
+        return m_count;
+    }
+
+    void clear()
+    {
+        m_buckets.clear();
+        m_offset = 0;
+        m_zeroCount = 0;
+        m_count = 0;
+    }
+
+private:
+    // smaller values are counted as zero
+    static qreal minValue()
+    {
+        return 1e-9;
+    }
+
+    void insert(int key, quint64 n)
+    {
+        if (m_buckets.isEmpty())
+        {
+            m_offset = key;
+            m_buckets.resize(1);
+        }
+        else if (key < m_offset)
+        {
+            // values below the lowest bucket end up in it if the range
+            // would get too wide
+            key = qMax(key, m_offset + m_buckets.size() - m_maxBuckets);
+
+            if (key < m_offset)
+            {
+                m_buckets.insert(0, m_offset - key, 0);
+                m_offset = key;
+            }
+        }
+        else if (key >= m_offset + m_buckets.size())
+        {
+            m_buckets.resize(key - m_offset + 1);
+
+            if (m_buckets.size() > m_maxBuckets)
+            {
+                // collapse the lowest buckets
+                int excess = m_buckets.size() - m_maxBuckets;
+                quint64 collapsed = 0;
+
+                for (int i = 0; i < excess; i++)
+                {
+                    collapsed += m_buckets[i];
+                }
+
+                m_buckets.remove(0, excess);
+                m_buckets[0] += collapsed;
+                m_offset += excess;
+            }
+        }
+
+        m_buckets[key - m_offset] += n;
+    }
+
+    // the value with the smallest relative error to all values in the bucket
+    qreal bucketValue(int key) const
+    {
+        return 2 * qPow(m_gamma, key) / (m_gamma + 1);
+    }
+
+    qreal m_gamma;
+    qreal m_logGamma;
+    int m_maxBuckets;
+    int m_offset;
+    QVector<quint64> m_buckets;
+    quint64 m_zeroCount;
+    quint64 m_count;
+};
+
+/*
+ * Online statistics of a series of values: count, mean and variance (with
+ * Welford's algorithm), min, max and quantiles from a QuantileSketch. Uses
+ * constant memory no matter how many values are added.
+ */
+class Statistics
+{
+public:
+    Statistics()
+    : m_count(0)
+    , m_mean(0.0)
+    , m_m2(0.0)
+    , m_min(0.0)
+    , m_max(0.0)
+    {
+    }
+
+    void add(qreal value)
+    {
+        qreal delta = value - m_mean;
+
+        m_count++;
+        m_mean += delta / m_count;
+        m_m2 += delta * (value - m_mean);
+
+        if (m_count == 1 || value < m_min)
+        {
+            m_min = value;
+        }
+
+        if (m_count == 1 || value > m_max)
+        {
+            m_max = value;
+        }
+
+        m_sketch.add(value);
+    }
+
+    void merge(const Statistics &other)
+    {
+        if (other.m_count == 0)
+        {
+            return;
+        }
+
+        if (m_count == 0)
+        {
+            *this = other;
+            return;
+        }
+
+        quint64 count = m_count + other.m_count;
+        qreal delta = other.m_mean - m_mean;
+
+        m_m2 += other.m_m2 + delta * delta * m_count * other.m_count / count;
+        m_mean += delta * other.m_count / count;
+        m_count = count;
+        m_min = qMin(m_min, other.m_min);
+        m_max = qMax(m_max, other.m_max);
+        m_sketch.merge(other.m_sketch);
+    }
+
+    void clear()
+    {
+        *this = Statistics();
+    }
+
+    quint64 count() const
+    {
+        return m_count;
+    }
+
+    // all of these return 0 if nothing was added
+    qreal mean() const
+    {
+        return m_mean;
+    }
+
+    // population variance, like the measurements always reported it
+    qreal variance() const
+    {
+        return m_count ? m_m2 / m_count : 0.0;
+    }
+
+    qreal stdev() const
+    {
+        return qSqrt(variance());
+    }
+
+    qreal min() const
+    {
+        return m_min;
+    }
+
+    qreal max() const
+    {
+        return m_max;
+    }
+
+    qreal quantile(qreal q) const
+    {
+        return m_sketch.quantile(q);
+    }
+
+private:
+    quint64 m_count;
+    qreal m_mean;
+    qreal m_m2;
+    qreal m_min;
+    qreal m_max;
+    QuantileSketch m_sketch;
+};
+
+#endif // STATISTICS_H
@@ -0,0 +1,198 @@
+#include "topologycache.h"
+#include "../../storage/storagepaths.h"
+#include "../../log/logger.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QVariant>
+
+#include <algorithm>
+
+LOGGER(TopologyCache);
+
+namespace
+{
+    const qint64 maxAge = 24 * 3600 * 1000;
+    // keeps the file small on devices tracing to many destinations
+    const int maxEntries = 10000;
+    const char *fileName = "stopset.json";
+}
+
+TopologyCache::TopologyCache()
+: m_dir(StoragePaths().topologyDirectory())
+{
+}
+
+bool TopologyCache::load()
+{
+    QFile file(m_dir.absoluteFilePath(fileName));
+
+    if (!file.exists())
+    {
+        return true;
+    }
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        LOG_WARNING(QString("Unable to open file: %1").arg(file.errorString()));
+        return false;
+    }
+
+    QVariantMap map = QJsonDocument::fromJson(file.readAll()).toVariant().toMap();
+    QVariantMap interfaces = map.value("interfaces").toMap();
+    QVariantMap destinations = map.value("destinations").toMap();
+
+    m_interfaces.clear();
+    m_destinations.clear();
+
+    for (QVariantMap::const_iterator it = interfaces.constBegin(); it != interfaces.constEnd(); ++it)
+    {
+        m_interfaces.insert(it.key(), it.value().toLongLong());
+    }
+
+    for (QVariantMap::const_iterator it = destinations.constBegin(); it != destinations.constEnd(); ++it)
+    {
+        QVariantMap destination = it.value().toMap();
+        Destination entry = {destination.value("distance").toInt(),
+                             destination.value("last_seen").toLongLong()};
+        m_destinations.insert(it.key(), entry);
+    }
+
+    expire(QDateTime::currentMSecsSinceEpoch());
+
+    return true;
+}
+
+bool TopologyCache::save() const
+{
+    if (!m_dir.exists() && !QDir::root().mkpath(m_dir.absolutePath()))
+    {
+        LOG_ERROR(QString("Unable to create path %1").arg(m_dir.absolutePath()));
+        return false;
+    }
+
+    QVariantMap interfaces;
+    QVariantMap destinations;
+
+    for (QHash<QString, qint64>::const_iterator it = m_interfaces.constBegin(); it != m_interfaces.constEnd(); ++it)
+    {
+        interfaces.insert(it.key(), it.value());
+    }
+
+    for (QHash<QString, Destination>::const_iterator it = m_destinations.constBegin(); it != m_destinations.constEnd(); ++it)
+    {
+        QVariantMap destination;
+        destination.insert("distance", it.value().distance);
+        destination.insert("last_seen", it.value().lastSeen);
+        destinations.insert(it.key(), destination);
+    }
+
+    QVariantMap map;
+    map.insert("interfaces", interfaces);
+    map.insert("destinations", destinations);
+
+    QFile file(m_dir.absoluteFilePath(fileName));
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        LOG_ERROR(QString("Unable to open file: %1").arg(file.errorString()));
+        return false;
+    }
+
+    file.write(QJsonDocument::fromVariant(map).toJson(QJsonDocument::Compact));
+    file.close();
+
+    return true;
+}
+
+int TopologyCache::startTtl(const QString &host, int maxTtl) const
+{
+    int distance = 0;
+
+    if (m_destinations.contains(host))
+    {
+        distance = m_destinations.value(host).distance;
+    }
+    else if (!m_destinations.isEmpty())
+    {
+        // an unknown destination is assumed to be as far away as the
+        // median of the known ones
+        QList<int> distances;
+
+        foreach (const Destination &destination, m_destinations)
+        {
+            distances.append(destination.distance);
+        }
+
+        std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+        distance = distances.at(distances.size() / 2);
+    }
+
+    // starting in the middle keeps the chance of overshooting the
+    // destination low while the backward probing hits the stop set early
+    return qBound(1, distance / 2, maxTtl);
+}
+
+bool TopologyCache::containsInterface(const QString &address) const
+{
+    return m_interfaces.contains(address);
+}
+
+void TopologyCache::addInterface(const QString &address)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (!m_interfaces.contains(address) && m_interfaces.size() >= maxEntries)
+    {
+        expire(now);
+
+        if (m_interfaces.size() >= maxEntries)
+        {
+            m_interfaces.erase(m_interfaces.begin());
+        }
+    }
+
+    m_interfaces.insert(address, now);
+}
+
+void TopologyCache::setDestinationDistance(const QString &host, int distance)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (!m_destinations.contains(host) && m_destinations.size() >= maxEntries)
+    {
+        expire(now);
+
+        if (m_destinations.size() >= maxEntries)
+        {
+            m_destinations.erase(m_destinations.begin());
+        }
+    }
+
+    Destination destination = {distance, now};
+    m_destinations.insert(host, destination);
+}
+
+void TopologyCache::expire(qint64 now)
+{
+    QMutableHashIterator<QString, qint64> interfaces(m_interfaces);
+
+    while (interfaces.hasNext())
+    {
+        if (now - interfaces.next().value() > maxAge)
+        {
+            interfaces.remove();
+        }
+    }
+
+    QMutableHashIterator<QString, Destination> destinations(m_destinations);
+
+    while (destinations.hasNext())
+    {
+        if (now - destinations.next().value().lastSeen > maxAge)
+        {
+            destinations.remove();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef TOPOLOGYCACHE_H
+#define TOPOLOGYCACHE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QDir>
+
+/*
+ * Hops discovered by earlier traceroutes of this device, used for
+ * Doubletree probing: a traceroute starts in the middle of the path and
+ * probes backward only until it reaches an interface of the local stop set
+ * (all interfaces seen before), since the part of the path closer to the
+ * device is shared by most destinations. Entries expire after a day so
+ * routing changes are picked up again.
+ */
+class TopologyCache
+{
+public:
+    TopologyCache();
+
+    bool load();
+    bool save() const;
+
+    // first TTL to probe towards host, 1 if nothing is known
+    int startTtl(const QString &host, int maxTtl) const;
+
+    bool containsInterface(const QString &address) const;
+    void addInterface(const QString &address);
+    void setDestinationDistance(const QString &host, int distance);
+
+private:
+    struct Destination
+    {
+        int distance;
+        qint64 lastSeen;
+    };
+
+    void expire(qint64 now);
+
+    QDir m_dir;
+    // last time each interface was seen in msecs since epoch
+    QHash<QString, qint64> m_interfaces;
+    QHash<QString, Destination> m_destinations;
+};
+
+#endif // TOPOLOGYCACHE_H
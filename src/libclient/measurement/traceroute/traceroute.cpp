@@ -1,24 +1,85 @@
 #include "../../log/logger.h"
 #include "traceroute.h"
+#include "../statistics.h"
+#include "../../client.h"
+#include "../../trafficbudgetmanager.h"
 
 #if defined(Q_OS_LINUX) || defined(Q_OS_MAC)
 #include <arpa/inet.h>
 #elif defined(Q_OS_WIN)
 #include <winsock2.h>
 #endif
-#include <numeric>
-#include <QtMath>
+#include <algorithm>
 #include <QtGlobal>
 
 LOGGER("Traceroute");
 
+namespace
+{
+    // the Linux ping engine probes all TTLs at once, each probe carries its
+    // own TTL, elsewhere the TTLs are probed one after another
+    int probeTtl(const PingProbe &probe, int ttl)
+    {
+#if defined(Q_OS_LINUX)
+        Q_UNUSED(ttl);
+        return probe.ttl;
+#else
+        Q_UNUSED(probe);
+        return ttl;
+#endif
+    }
+
+    bool lessTtl(const Hop &a, const Hop &b)
+    {
+        return a.ttl < b.ttl;
+    }
+
+    // a monitored hop is reported again once its loss rate moved by this
+    // much or its average round trip time by this fraction (but at least
+    // minRttChange usec)
+    const qreal lossThreshold = 0.05;
+    const qreal rttThreshold = 0.2;
+    const qreal minRttChange = 1000.0;
+
+    qreal lossRate(const MonitoredHop &hop)
+    {
+        return hop.sent ? 1.0 - (qreal)hop.received / hop.sent : 0.0;
+    }
+
+    QVariantMap monitoredHopToVariant(int ttl, const MonitoredHop &hop)
+    {
+        const Statistics &rtt = hop.rttStatistics;
+
+        QVariantMap map;
+        map.insert("ttl", ttl);
+        map.insert("hop", hop.address);
+        map.insert("sent", hop.sent);
+        map.insert("received", hop.received);
+        map.insert("loss", lossRate(hop));
+        map.insert("rtt_min", rtt.min());
+        map.insert("rtt_max", rtt.max());
+        map.insert("rtt_avg", rtt.mean());
+        map.insert("rtt_stdev", rtt.stdev());
+        map.insert("rtt_p50", rtt.quantile(0.5));
+        map.insert("rtt_p90", rtt.quantile(0.9));
+        map.insert("rtt_p99", rtt.quantile(0.99));
+        return map;
+    }
+}
+
 Traceroute::Traceroute(QObject *parent)
 : Measurement(parent)
 , currentStatus(Unknown)
 , m_ping()
 , endOfRoute(false)
 , ttl(0)
+, m_startTtl(1)
+, m_backward(false)
+, m_pathLength(0)
+, m_cycles(0)
 {
+    m_cycleTimer.setSingleShot(true);
+    connect(&m_cycleTimer, SIGNAL(timeout()), this, SLOT(nextCycle()));
 }
 
 Traceroute::~Traceroute()
@@ -51,6 +112,32 @@ bool Traceroute::prepare(NetworkManager *networkManager,
         return false;
     }
 
+    // the TTLs of one round share the slots of the ping engine
+    if (definition->maxTtl == 0 || definition->maxTtl > 64)
+    {
+        setErrorString("max_ttl must be between 1 and 64");
+        return false;
+    }
+
+    if (definition->duration > 0 && definition->cycleInterval == 0)
+    {
+        setErrorString("cycle_interval must not be 0 when monitoring");
+        return false;
+    }
+
+    // monitoring needs every hop in every cycle
+    if (definition->doubletree && definition->duration > 0)
+    {
+        LOG_WARNING("doubletree is ignored when monitoring");
+        definition->doubletree = false;
+    }
+
+    if (definition->doubletree)
+    {
+        m_topologyCache.load();
+        m_startTtl = m_topologyCache.startTtl(definition->host, definition->maxTtl);
+    }
+
     // initialize ports randomly if not given
     qsrand(QDateTime::currentMSecsSinceEpoch());
 
@@ -64,6 +151,43 @@ bool Traceroute::prepare(NetworkManager *networkManager,
         definition->sourcePort = (qrand() % 64511) + 1024; // range 1024 - 65535
     }
 
+    QHostAddress address = resolveHost(definition->host);
+
+    if (address.isNull())
+    {
+        setErrorString(QString("could not resolve hostname '%1'").arg(definition->host));
+        return false;
+    }
+
+    m_hostAddress = address.toString();
+
+    if (definition->duration > 0)
+    {
+        // charged once for the whole monitoring, at worst every cycle has to
+        // discover the route again
+        quint64 cycles = definition->duration / definition->cycleInterval + 1;
+        quint64 probe = 2 * 14 + 2 * (8 + definition->payload);  // Ethernet + UDP header + payload
+
+        if (address.protocol() == QAbstractSocket::IPv6Protocol)
+        {
+            probe += 2 * 40 + 56;  // IPv6 header + ICMPv6 response
+        }
+        else
+        {
+            probe += 2 * 20 + 36;  // IPv4 header + ICMPv4 response
+        }
+
+        quint64 traffic = cycles * definition->count * definition->maxTtl * probe;
+
+        if (traffic > 0xffffffff || !Client::instance()->trafficBudgetManager()->addUsedTraffic(traffic))
+        {
+            setErrorString("not enough traffic available");
+            return false;
+        }
+
+        m_ping.setTrafficCharged(true);
+    }
+
     connect(&m_ping, SIGNAL(destinationUnreachable(const PingProbe &)),
             this, SLOT(destinationUnreachable(const PingProbe &)));
 
@@ -86,6 +210,12 @@ bool Traceroute::prepare(NetworkManager *networkManager,
 
 bool Traceroute::start()
 {
+    if (definition->duration > 0)
+    {
+        m_monitorTime.start();
+    }
+
+    ttl = m_startTtl - 1;
     ping();
 
     return true;
@@ -93,104 +223,151 @@ bool Traceroute::start()
 
 bool Traceroute::stop()
 {
+    m_cycleTimer.stop();
     disconnect(&m_ping);
     return true;
 }
 
 Result Traceroute::result() const
 {
+    if (definition->duration > 0)
+    {
+        QVariantList res;
+
+        for (int i = 0; i < m_monitoredHops.size(); i++)
+        {
+            res << monitoredHopToVariant(i + 1, m_monitoredHops[i]);
+        }
+
+        QVariantMap map;
+        map.insert("results", res);
+        map.insert("hop_count", res.size());
+        map.insert("cycles", m_cycles);
+
+        return Result(map);
+    }
+
     QVariantList res;
     QVariantList pings;
     QVariantMap hop;
     QVariantMap probe;
-    QList<quint64> pingTime;
+    int i = 0;
 
-    for (int i = 0; i < hops.size(); i += definition->count)
+    // hops are ordered by TTL, every TTL has up to count probes
+    while (i < hops.size())
     {
+        Statistics rttStatistics;
+        int hopTtl = hops[i].ttl;
+        int responder = i;
+
         pings.clear();
-        pingTime.clear();
 
-        for (quint32 k = 0; k < definition->count; k++)
+        for (; i < hops.size() && hops[i].ttl == hopTtl; i++)
         {
-            if ((quint32) hops.size() <= i + k)
-            {
-                break;
-            }
+            // probe times are in nsec, the result reports usec
+            quint64 rtt = (hops[i].probe.recvTime - hops[i].probe.sendTime) / 1000;
 
             // use only successful pings for the statistics
-            if (hops[i + k].response != traceroute::TIMEOUT)
+            if (hops[i].response != traceroute::TIMEOUT)
             {
-                pingTime.append(hops[i + k].probe.recvTime - hops[i + k].probe.sendTime);
-            }
-
-            probe.insert("response", hops[i + k].response);
-            probe.insert("rtt", (int)(hops[i + k].probe.recvTime -
-                                      hops[i + k].probe.sendTime));
-            pings.append(probe);
-        }
+                rttStatistics.add(rtt);
 
-        quint64 min = 0, max = 0;
-        qreal avg = 0.0, sq_sum = 0.0, stdev = 0.0;
-
-        // do statistics only when there are pings
-        if (pingTime.size() > 0)
-        {
-            // get max and min
-            QList<quint64>::const_iterator it = std::max_element(pingTime.begin(), pingTime.end());
-            max = *it;
-            it = std::min_element(pingTime.begin(), pingTime.end());
-            min = *it;
-
-            // calculate average and fill ping times
-            foreach (quint64 val, pingTime)
-            {
-                avg += val;
+                if (hops[responder].response == traceroute::TIMEOUT)
+                {
+                    responder = i;
+                }
             }
 
-            sq_sum = std::inner_product(pingTime.begin(), pingTime.end(), pingTime.begin(), 0.0);
-            stdev = 0.0;
-
-            avg /= pingTime.size();
-            // calculate standard deviation
-            stdev = qSqrt(sq_sum / pingTime.size() - avg * avg);
+            probe.insert("response", hops[i].response);
+            probe.insert("rtt", (int)rtt);
+            pings.append(probe);
         }
 
-        hop.insert("hop", QString(inet_ntoa(hops[i].probe.source.sin.sin_addr)));
+        hop.insert("hop", addressToString(hops[responder].probe.source));
         hop.insert("pings", pings);
-        hop.insert("ttl", i / 3 + 1);
-        hop.insert("rtt_min", min);
-        hop.insert("rtt_max", max);
-        hop.insert("rtt_avg", avg);
-        hop.insert("rtt_stdev", stdev);
-        hop.insert("rtt_count", pingTime.size());
+        hop.insert("ttl", hopTtl);
+        hop.insert("rtt_min", rttStatistics.min());
+        hop.insert("rtt_max", rttStatistics.max());
+        hop.insert("rtt_avg", rttStatistics.mean());
+        hop.insert("rtt_stdev", rttStatistics.stdev());
+        hop.insert("rtt_p50", rttStatistics.quantile(0.5));
+        hop.insert("rtt_p90", rttStatistics.quantile(0.9));
+        hop.insert("rtt_p99", rttStatistics.quantile(0.99));
+        hop.insert("rtt_count", static_cast<int>(rttStatistics.count()));
 
         res << hop;
     }
 
     QVariantMap map;
     map.insert("results", res);
-    map.insert("hop_count", static_cast<int>(hops.size() / definition->count));
+    map.insert("hop_count", res.size());
+
+    // hops below the first probed TTL were found in the stop set
+    if (definition->doubletree)
+    {
+        map.insert("first_ttl", hops.isEmpty() ? 1 : hops.first().ttl);
+        map.insert("start_ttl", m_startTtl);
+    }
 
     return Result(map);
 }
 
 void Traceroute::ping()
 {
-    if (++ttl == 20)
+    if (++ttl > (int)definition->maxTtl)
     {
-        emit finished();
+        forwardFinished();
+        return;
+    }
+
+#if defined(Q_OS_LINUX)
+    // one ping run covers all TTLs and stops at the destination distance,
+    // while monitoring a known route only its hops and the destination are
+    // probed, a router answering in place of the destination means the
+    // route got longer
+    quint32 maxTtl = definition->maxTtl;
+
+    if (m_pathLength > 0)
+    {
+        maxTtl = qMin(maxTtl, (quint32)m_pathLength);
+    }
+
+    startPing(ttl, maxTtl);
+#else
+    startPing(ttl, 0);
+#endif
+}
+
+void Traceroute::probeBackward()
+{
+    if (--ttl < 1)
+    {
+        traceFinished();
         return;
     }
 
-    PingDefinition pingDef(definition->host,
+    // each step depends on the answer of the previous one
+#if defined(Q_OS_LINUX)
+    startPing(ttl, ttl);
+#else
+    startPing(ttl, 0);
+#endif
+}
+
+// lastTtl = 0 probes firstTtl only and leaves the probes' ttl unset
+void Traceroute::startPing(int firstTtl, int lastTtl)
+{
+    PingDefinition pingDef(m_hostAddress,
                                  definition->count,
                                  definition->interval,
                                  definition->receiveTimeout,
-                                 ttl,
+                                 firstTtl,
                                  definition->destinationPort,
                                  definition->sourcePort,
                                  definition->payload,
-                                 definition->type);
+                                 definition->type,
+                                 1,
+                                 lastTtl);
 
     if (m_ping.prepare(NULL, PingPlugin().createMeasurementDefinition(
                            "ping",
@@ -198,6 +375,13 @@ void Traceroute::ping()
     {
         m_ping.start();
     }
+    else if (m_cycles > 0)
+    {
+        // keep what was monitored so far
+        LOG_WARNING(QString("Stopped monitoring after %1 cycles: %2")
+                    .arg(m_cycles).arg(m_ping.errorString()));
+        emit finished();
+    }
     else
     {
         emit error("ping preparation failed");
@@ -206,38 +390,298 @@ void Traceroute::ping()
 
 void Traceroute::destinationUnreachable(const PingProbe &probe)
 {
-    Hop hop = {probe, traceroute::DESTINATION_UNREACHABLE};
+    Hop hop = {probe, traceroute::DESTINATION_UNREACHABLE, probeTtl(probe, ttl)};
     hops << hop;
     endOfRoute = true;
 }
 
 void Traceroute::ttlExceeded(const PingProbe &probe)
 {
-    Hop hop = {probe, traceroute::TTL_EXCEEDED};
+    Hop hop = {probe, traceroute::TTL_EXCEEDED, probeTtl(probe, ttl)};
     hops << hop;
 }
 
 void Traceroute::timeout(const PingProbe &probe)
 {
-    Hop hop = {probe, traceroute::TIMEOUT};
+    Hop hop = {probe, traceroute::TIMEOUT, probeTtl(probe, ttl)};
     hops << hop;
 }
 
 void Traceroute::udpResponse(const PingProbe &probe)
 {
-    Hop hop = {probe, traceroute::UDP_RESPONSE};
+    Hop hop = {probe, traceroute::UDP_RESPONSE, probeTtl(probe, ttl)};
     hops << hop;
     endOfRoute = true;
 }
 
 void Traceroute::pingFinished()
 {
-    if (endOfRoute)
+    if (m_backward)
     {
-        emit finished();
+        backwardFinished();
+        return;
+    }
+
+#if defined(Q_OS_LINUX)
+    // answers of parallel probes arrive in any order, and the probes sent
+    // beyond the destination before its distance was known are dropped
+    int destinationTtl = definition->maxTtl;
+
+    std::stable_sort(hops.begin(), hops.end(), lessTtl);
+
+    foreach (const Hop &hop, hops)
+    {
+        if (hop.response == traceroute::DESTINATION_UNREACHABLE ||
+            hop.response == traceroute::UDP_RESPONSE)
+        {
+            destinationTtl = qMin(destinationTtl, hop.ttl);
+        }
+    }
+
+    while (!hops.isEmpty() && hops.last().ttl > destinationTtl)
+    {
+        hops.removeLast();
+    }
+
+    forwardFinished();
+#else
+    if (endOfRoute || (m_pathLength > 0 && ttl >= m_pathLength))
+    {
+        forwardFinished();
     }
     else
     {
         ping();
     }
+#endif
+}
+
+void Traceroute::forwardFinished()
+{
+    if (m_startTtl > 1)
+    {
+        m_backward = true;
+        ttl = m_startTtl;
+        probeBackward();
+    }
+    else
+    {
+        traceFinished();
+    }
+}
+
+void Traceroute::backwardFinished()
+{
+    bool known = false;
+    bool destination = false;
+
+    foreach (const Hop &hop, hops)
+    {
+        if (hop.ttl != ttl || hop.response == traceroute::TIMEOUT)
+        {
+            continue;
+        }
+
+        if (hop.response == traceroute::DESTINATION_UNREACHABLE ||
+            hop.response == traceroute::UDP_RESPONSE)
+        {
+            destination = true;
+        }
+
+        known = known || m_topologyCache.containsInterface(addressToString(hop.probe.source));
+    }
+
+    // the start was beyond the destination, drop the hops behind it
+    if (destination)
+    {
+        for (int i = hops.size() - 1; i >= 0; i--)
+        {
+            if (hops[i].ttl > ttl)
+            {
+                hops.removeAt(i);
+            }
+        }
+    }
+
+    if (known)
+    {
+        traceFinished();
+    }
+    else
+    {
+        probeBackward();
+    }
+}
+
+void Traceroute::traceFinished()
+{
+    // backward probes come after the forward ones
+    std::stable_sort(hops.begin(), hops.end(), lessTtl);
+
+    if (definition->doubletree)
+    {
+        foreach (const Hop &hop, hops)
+        {
+            if (hop.response != traceroute::TIMEOUT)
+            {
+                m_topologyCache.addInterface(addressToString(hop.probe.source));
+            }
+        }
+
+        if (endOfRoute && !hops.isEmpty())
+        {
+            m_topologyCache.setDestinationDistance(definition->host, hops.last().ttl);
+        }
+
+        m_topologyCache.save();
+    }
+
+    routeFinished();
+}
+
+void Traceroute::routeFinished()
+{
+    if (definition->duration == 0)
+    {
+        emit finished();
+        return;
+    }
+
+    updateMonitoredHops();
+
+    if (m_monitorTime.elapsed() >= definition->duration)
+    {
+        emit finished();
+    }
+    else
+    {
+        m_cycleTimer.start(definition->cycleInterval);
+    }
+}
+
+void Traceroute::nextCycle()
+{
+    hops.clear();
+    endOfRoute = false;
+    m_backward = false;
+    ttl = m_startTtl - 1;
+
+    ping();
+}
+
+void Traceroute::updateMonitoredHops()
+{
+    // a cycle which did not reach the destination (e.g. it lost the probes
+    // to it) only updates the hops known already
+    int pathLength = m_monitoredHops.size();
+
+    if (endOfRoute || m_monitoredHops.isEmpty())
+    {
+        pathLength = 0;
+
+        foreach (const Hop &hop, hops)
+        {
+            pathLength = qMax(pathLength, hop.ttl);
+        }
+    }
+
+    bool pathChanged = m_cycles > 0 && pathLength != m_monitoredHops.size();
+
+    while (m_monitoredHops.size() > pathLength)
+    {
+        m_monitoredHops.removeLast();
+    }
+
+    while (m_monitoredHops.size() < pathLength)
+    {
+        m_monitoredHops.append(MonitoredHop());
+    }
+
+    foreach (const Hop &hop, hops)
+    {
+        if (hop.ttl > pathLength)
+        {
+            continue;
+        }
+
+        MonitoredHop &monitored = m_monitoredHops[hop.ttl - 1];
+        monitored.sent++;
+
+        if (hop.response == traceroute::TIMEOUT)
+        {
+            continue;
+        }
+
+        QString address = addressToString(hop.probe.source);
+
+        if (address != monitored.address)
+        {
+            // another router at this distance, its numbers start over
+            if (!monitored.address.isEmpty())
+            {
+                pathChanged = true;
+                monitored.sent = 1;
+                monitored.received = 0;
+                monitored.rttStatistics.clear();
+            }
+
+            monitored.address = address;
+        }
+
+        // probe times are in nsec, the statistics are in usec
+        monitored.received++;
+        monitored.rttStatistics.add((hop.probe.recvTime - hop.probe.sendTime) / 1000);
+    }
+
+    // a route is discovered until the destination answers, a known one
+    // only if it changed; lost probes to the destination don't count as a
+    // change
+    if (m_pathLength == 0)
+    {
+        m_pathLength = endOfRoute ? pathLength : 0;
+    }
+    else if (pathChanged)
+    {
+        m_pathLength = 0;
+    }
+
+    m_cycles++;
+
+    // only the hops which changed noticeably since they were last reported
+    QVariantList changedHops;
+
+    for (int i = 0; i < m_monitoredHops.size(); i++)
+    {
+        MonitoredHop &monitored = m_monitoredHops[i];
+        qreal loss = lossRate(monitored);
+        qreal rtt = monitored.rttStatistics.mean();
+
+        if (monitored.reported &&
+            monitored.address == monitored.reportedAddress &&
+            qAbs(loss - monitored.reportedLoss) < lossThreshold &&
+            qAbs(rtt - monitored.reportedRtt) < qMax(rttThreshold * monitored.reportedRtt, minRttChange))
+        {
+            continue;
+        }
+
+        monitored.reported = true;
+        monitored.reportedAddress = monitored.address;
+        monitored.reportedLoss = loss;
+        monitored.reportedRtt = rtt;
+
+        changedHops << monitoredHopToVariant(i + 1, monitored);
+    }
+
+    if (changedHops.isEmpty() && !pathChanged)
+    {
+        return;
+    }
+
+    QVariantMap map;
+    map.insert("cycle", m_cycles);
+    map.insert("hop_count", m_monitoredHops.size());
+    map.insert("path_changed", pathChanged);
+    map.insert("results", changedHops);
+
+    emit resultReady(Result(map));
 }
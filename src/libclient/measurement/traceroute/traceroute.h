@@ -4,12 +4,16 @@
 #include <QtGlobal>
 #include <QMutex>
 #include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "../measurement.h"
 #include "../../task/task.h"
 #include "../ping/ping.h"
 #include "../ping/ping_plugin.h"
 #include "../ping/ping_definition.h"
+#include "../statistics.h"
+#include "topologycache.h"
 #include "traceroute_definition.h"
 
 namespace traceroute
@@ -27,6 +31,31 @@ struct Hop
 {
     PingProbe probe;
     traceroute::Response response;
+    int ttl;
+};
+
+// what the monitoring mode knows about the router at one distance
+struct MonitoredHop
+{
+    QString address;
+    quint32 sent;
+    quint32 received;
+    // round trip times in usec
+    Statistics rttStatistics;
+
+    // state of the last delta result which contained this hop
+    bool reported;
+    QString reportedAddress;
+    qreal reportedLoss;
+    qreal reportedRtt;
+
+    MonitoredHop()
+    : sent(0)
+    , received(0)
+    , reported(false)
+    , reportedLoss(0.0)
+    , reportedRtt(0.0)
+    {}
 };
 
 class Traceroute : public Measurement
@@ -47,14 +76,37 @@ public:
 private:
     void setStatus(Status status);
     void ping();
+    void probeBackward();
+    void startPing(int firstTtl, int lastTtl);
+    void forwardFinished();
+    void backwardFinished();
+    void traceFinished();
+    void routeFinished();
+    void updateMonitoredHops();
 
     TracerouteDefinitionPtr definition;
     Status currentStatus;
+    // resolved once, every ping uses it instead of the host name
+    QString m_hostAddress;
     Ping m_ping;
     QList<Hop> hops;
     bool endOfRoute;
     int ttl;
 
+    // Doubletree, probing starts forward at m_startTtl and then goes
+    // backward until a hop of the stop set is found
+    TopologyCache m_topologyCache;
+    int m_startTtl;
+    bool m_backward;
+
+    // monitoring mode, indexed by ttl - 1
+    QList<MonitoredHop> m_monitoredHops;
+    // destination distance of the known route, 0 while it is discovered
+    int m_pathLength;
+    quint32 m_cycles;
+    QElapsedTimer m_monitorTime;
+    QTimer m_cycleTimer;
+
 signals:
     void statusChanged(Status status);
     void handledResponse();
@@ -65,6 +117,9 @@ public slots:
     void timeout(const PingProbe &probe);
     void udpResponse(const PingProbe &probe);
     void pingFinished();
+
+private slots:
+    void nextCycle();
 };
 
 #endif // TRACEROUTE_H
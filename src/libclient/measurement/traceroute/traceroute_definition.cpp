@@ -7,7 +7,11 @@ TracerouteDefinition::TracerouteDefinition(const QString &host,
                                            const quint16 &destinationPort,
                                            const quint16 &sourcePort,
                                            const quint32 &payload,
-                                           const ping::PingType &type)
+                                           const ping::PingType &type,
+                                           const quint32 &maxTtl,
+                                           const quint32 &duration,
+                                           const quint32 &cycleInterval,
+                                           const bool &doubletree)
 : host(host)
 , count(count)
 , interval(interval)
@@ -16,6 +20,10 @@ TracerouteDefinition::TracerouteDefinition(const QString &host,
 , sourcePort(sourcePort)
 , payload(payload)
 , type(type)
+, maxTtl(maxTtl)
+, duration(duration)
+, cycleInterval(cycleInterval)
+, doubletree(doubletree)
 {
 }
 
@@ -35,7 +43,11 @@ TracerouteDefinitionPtr TracerouteDefinition::fromVariant(const QVariant &varian
                                        map.value("source_port", 33434).toUInt(),
                                        map.value("payload", 74).toUInt(),
                                        pingTypeFromString(map.value(
-                                                              "ping_type", "Udp").toString().toLatin1())));
+                                                              "ping_type", "Udp").toString().toLatin1()),
+                                       map.value("max_ttl", 30).toUInt(),
+                                       map.value("duration", 0).toUInt(),
+                                       map.value("cycle_interval", 5000).toUInt(),
+                                       map.value("doubletree", false).toBool()));
 }
 
 QVariant TracerouteDefinition::toVariant() const
@@ -49,5 +61,9 @@ QVariant TracerouteDefinition::toVariant() const
     map.insert("source_port", sourcePort);
     map.insert("payload", payload);
     map.insert("ping_type", pingTypeToString(type));
+    map.insert("max_ttl", maxTtl);
+    map.insert("duration", duration);
+    map.insert("cycle_interval", cycleInterval);
+    map.insert("doubletree", doubletree);
     return map;
 }
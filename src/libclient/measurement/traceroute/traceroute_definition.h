@@ -17,7 +17,10 @@ public:
                          const quint32 &interval, const quint32 &receiveTimeout,
                          const quint16 &destinationPort,
                          const quint16 &sourcePort, const quint32 &payload,
-                         const ping::PingType &type);
+                         const ping::PingType &type, const quint32 &maxTtl = 30,
+                         const quint32 &duration = 0,
+                         const quint32 &cycleInterval = 5000,
+                         const bool &doubletree = false);
     ~TracerouteDefinition();
 
     // Storage
@@ -32,6 +35,14 @@ public:
     quint16 sourcePort;
     quint32 payload;
     ping::PingType type;
+    quint32 maxTtl;
+    // keep re-probing the route for this many msec, 0 traces it once
+    quint32 duration;
+    // msec between two probing cycles while monitoring
+    quint32 cycleInterval;
+    // start in the middle of the path and skip the hops known from earlier
+    // traceroutes, see TopologyCache
+    bool doubletree;
 
     // Serializable interface
     QVariant toVariant() const;
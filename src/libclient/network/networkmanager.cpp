@@ -81,6 +81,7 @@ class NetworkManager::Private : public QObject
 public:
     Private(NetworkManager *q)
     : q(q)
+    , localPort(0)
 #if defined(Q_OS_ANDROID)
     , networkInfo("de/hsaugsburg/informatik/mplane/NetInfo")
 #endif
@@ -598,15 +599,24 @@ QAbstractSocket *NetworkManager::establishConnection(const QString &hostname,
         testSocket = udpSocket;
     }
 
-    QByteArray data = QJsonDocument::fromVariant(request.toVariant()).toJson();
+    // Without a keepalive socket (not initialized or no keepalive address
+    // configured) the peer has to be listening already
+    if (testSocket)
+    {
+        QByteArray data = QJsonDocument::fromVariant(request.toVariant()).toJson();
 
-    // Step one: Send test offer to peer directly
-    testSocket->writeDatagram(data, QHostAddress(remote.host), d->localPort);
+        // Step one: Send test offer to peer directly
+        testSocket->writeDatagram(data, QHostAddress(remote.host), d->localPort);
 
-    // Step two: Send test offer to peer via alive-server
-    //testSocket->writeDatagram(data, d->keepaliveAddress, aliveRemote.port); // TODO deactivated for now
+        // Step two: Send test offer to peer via alive-server
+        //testSocket->writeDatagram(data, d->keepaliveAddress, aliveRemote.port); // TODO deactivated for now
 
-    LOG_TRACE("Sent test offer to peer and alive-server");
+        LOG_TRACE("Sent test offer to peer and alive-server");
+    }
+    else
+    {
+        LOG_DEBUG("No keepalive socket, not sending a test offer");
+    }
 
     if (socketType != UdpSocket)
     {
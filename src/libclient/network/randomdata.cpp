@@ -0,0 +1,21 @@
+#include "randomdata.h"
+
+#include <QDateTime>
+
+#include <string.h>
+
+QByteArray randomData(int size)
+{
+    QByteArray data(size, 0);
+    quint64 x = QDateTime::currentMSecsSinceEpoch() | 1;
+
+    for (int i = 0; i + 8 <= size; i += 8)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(data.data() + i, &x, 8);
+    }
+
+    return data;
+}
@@ -0,0 +1,10 @@
+#ifndef RANDOMDATA_H
+#define RANDOMDATA_H
+
+#include <QByteArray>
+
+// xorshift output for upload and download payloads, it does not compress,
+// so no compression on the path makes the link look faster than it is
+QByteArray randomData(int size);
+
+#endif // RANDOMDATA_H
@@ -0,0 +1,148 @@
+#include "socketutil.h"
+
+#include <QHostInfo>
+
+QHostAddress resolveHost(const QString &host)
+{
+    QHostAddress address(host);
+
+    if (address.isNull())
+    {
+        QHostInfo info = QHostInfo::fromName(host);
+
+        if (info.error() == QHostInfo::NoError && !info.addresses().isEmpty())
+        {
+            address = info.addresses().first();
+        }
+    }
+
+    return address;
+}
+
+QString addressToString(const sockaddr_any &addr)
+{
+    return QHostAddress(&addr.sa).toString();
+}
+
+#if defined(Q_OS_LINUX)
+#include <netdb.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+quint64 toNsec(const struct timespec &ts)
+{
+    return ts.tv_sec * Q_UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+quint64 monotonicTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return toNsec(ts);
+}
+
+quint64 wallTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return toNsec(ts);
+}
+
+quint16 getPort(const sockaddr_any &addr)
+{
+    return ntohs(addr.sa.sa_family == AF_INET6 ? addr.sin6.sin6_port : addr.sin.sin_port);
+}
+
+void setPort(sockaddr_any *addr, quint16 port)
+{
+    if (addr->sa.sa_family == AF_INET6)
+    {
+        addr->sin6.sin6_port = htons(port);
+    }
+    else
+    {
+        addr->sin.sin_port = htons(port);
+    }
+}
+
+socklen_t addressLength(const sockaddr_any &addr)
+{
+    return addr.sa.sa_family == AF_INET6 ? sizeof(addr.sin6) : sizeof(addr.sin);
+}
+
+bool sameHost(const sockaddr_any &a, const sockaddr_any &b)
+{
+    if (a.sa.sa_family != b.sa.sa_family)
+    {
+        return false;
+    }
+
+    if (a.sa.sa_family == AF_INET6)
+    {
+        return !memcmp(&a.sin6.sin6_addr, &b.sin6.sin6_addr, sizeof(a.sin6.sin6_addr));
+    }
+
+    return a.sin.sin_addr.s_addr == b.sin.sin_addr.s_addr;
+}
+
+bool getAddress(const QString &address, sockaddr_any *addr)
+{
+    struct addrinfo hints;
+    struct addrinfo *rp = NULL, *result = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = PF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(address.toLatin1(), NULL, &hints, &result))
+    {
+        return false;
+    }
+
+    for (rp = result; rp && rp->ai_family != AF_INET &&
+         rp->ai_family != AF_INET6;
+         rp = rp->ai_next)
+    {
+    }
+
+    if (!rp)
+    {
+        freeaddrinfo(result);
+        return false;
+    }
+
+    memcpy(addr, rp->ai_addr, rp->ai_addrlen);
+
+    freeaddrinfo(result);
+
+    return true;
+}
+
+bool toSockaddr(const QHostAddress &address, sockaddr_any *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+
+    if (address.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        Q_IPV6ADDR ip = address.toIPv6Address();
+
+        addr->sin6.sin6_family = AF_INET6;
+        memcpy(&addr->sin6.sin6_addr, &ip, sizeof(addr->sin6.sin6_addr));
+        return true;
+    }
+
+    if (address.protocol() == QAbstractSocket::IPv4Protocol)
+    {
+        addr->sin.sin_family = AF_INET;
+        addr->sin.sin_addr.s_addr = htonl(address.toIPv4Address());
+        return true;
+    }
+
+    return false;
+}
+#endif
@@ -0,0 +1,53 @@
+#ifndef SOCKETUTIL_H
+#define SOCKETUTIL_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHostAddress>
+
+#if defined(Q_OS_WIN)
+#include <winsock2.h>
+#include <Ws2ipdef.h>
+#include <WS2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// the address itself if host is one, otherwise the first address the
+// resolver returns (blocking); a null address if host can't be resolved
+QHostAddress resolveHost(const QString &host);
+
+union sockaddr_any
+{
+    struct sockaddr sa;
+    struct sockaddr_in sin;
+    struct sockaddr_in6 sin6;
+};
+
+// IPv4 or IPv6 by the family of addr
+QString addressToString(const sockaddr_any &addr);
+
+#if defined(Q_OS_LINUX)
+struct timespec;
+
+// helpers of the measurements sending their own probes over raw sockets,
+// all times are ns
+quint64 toNsec(const struct timespec &ts);
+quint64 monotonicTime();
+// the clock of SO_TIMESTAMPNS
+quint64 wallTime();
+
+quint16 getPort(const sockaddr_any &addr);
+void setPort(sockaddr_any *addr, quint16 port);
+socklen_t addressLength(const sockaddr_any &addr);
+// compares the addresses only, not the ports
+bool sameHost(const sockaddr_any &a, const sockaddr_any &b);
+
+// blocks on the resolver, the first IPv4 or IPv6 address is taken
+bool getAddress(const QString &address, sockaddr_any *addr);
+// the port is 0, false if address is neither IPv4 nor IPv6
+bool toSockaddr(const QHostAddress &address, sockaddr_any *addr);
+#endif
+
+#endif // SOCKETUTIL_H
@@ -0,0 +1,189 @@
+#include "tcpinfo.h"
+#include "../types.h"
+
+#include <QAbstractSocket>
+
+#if defined(Q_OS_LINUX)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace
+{
+    // struct tcp_info of linux/tcp.h up to the fields of kernel 4.10; the
+    // headers of older kernels and of Android lack the later fields, so the
+    // layout is kept here and the kernel copies only what it knows
+    struct TcpInfo
+    {
+        quint8 tcpi_state;
+        quint8 tcpi_ca_state;
+        quint8 tcpi_retransmits;
+        quint8 tcpi_probes;
+        quint8 tcpi_backoff;
+        quint8 tcpi_options;
+        quint8 tcpi_wscale;
+        quint8 tcpi_flags;
+
+        quint32 tcpi_rto;
+        quint32 tcpi_ato;
+        quint32 tcpi_snd_mss;
+        quint32 tcpi_rcv_mss;
+
+        quint32 tcpi_unacked;
+        quint32 tcpi_sacked;
+        quint32 tcpi_lost;
+        quint32 tcpi_retrans;
+        quint32 tcpi_fackets;
+
+        quint32 tcpi_last_data_sent;
+        quint32 tcpi_last_ack_sent;
+        quint32 tcpi_last_data_recv;
+        quint32 tcpi_last_ack_recv;
+
+        quint32 tcpi_pmtu;
+        quint32 tcpi_rcv_ssthresh;
+        quint32 tcpi_rtt;
+        quint32 tcpi_rttvar;
+        quint32 tcpi_snd_ssthresh;
+        quint32 tcpi_snd_cwnd;
+        quint32 tcpi_advmss;
+        quint32 tcpi_reordering;
+
+        quint32 tcpi_rcv_rtt;
+        quint32 tcpi_rcv_space;
+
+        quint32 tcpi_total_retrans;
+
+        // 3.15
+        quint64 tcpi_pacing_rate;
+        quint64 tcpi_max_pacing_rate;
+        // 4.1
+        quint64 tcpi_bytes_acked;
+        quint64 tcpi_bytes_received;
+        // 4.2
+        quint32 tcpi_segs_out;
+        quint32 tcpi_segs_in;
+        // 4.6
+        quint32 tcpi_notsent_bytes;
+        quint32 tcpi_min_rtt;
+        quint32 tcpi_data_segs_in;
+        quint32 tcpi_data_segs_out;
+        // 4.9
+        quint64 tcpi_delivery_rate;
+        // 4.10
+        quint64 tcpi_busy_time;
+        quint64 tcpi_rwnd_limited;
+        quint64 tcpi_sndbuf_limited;
+    };
+}
+#endif
+
+TcpInfoSeries::TcpInfoSeries()
+{
+}
+
+bool TcpInfoSeries::isSupported()
+{
+#if defined(Q_OS_LINUX)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TcpInfoSeries::sample(const QAbstractSocket *socket, qint64 time)
+{
+#if defined(Q_OS_LINUX)
+    if (!socket || socket->socketDescriptor() < 0)
+    {
+        return false;
+    }
+
+    // older kernels fill in less, the fields they do not know stay 0
+    TcpInfo info;
+    socklen_t length = sizeof(info);
+    memset(&info, 0, sizeof(info));
+
+    if (getsockopt(socket->socketDescriptor(), IPPROTO_TCP, TCP_INFO, &info, &length) < 0)
+    {
+        return false;
+    }
+
+    m_times.append(time);
+    m_rtt.append(info.tcpi_rtt);
+    m_rttVar.append(info.tcpi_rttvar);
+    m_rcvRtt.append(info.tcpi_rcv_rtt);
+    m_cwnd.append(info.tcpi_snd_cwnd);
+    m_retransmits.append(info.tcpi_total_retrans);
+    m_deliveryRate.append(info.tcpi_delivery_rate);
+    m_rcvSpace.append(info.tcpi_rcv_space);
+    m_busyTime.append(info.tcpi_busy_time);
+    m_rwndLimited.append(info.tcpi_rwnd_limited);
+    m_sndbufLimited.append(info.tcpi_sndbuf_limited);
+
+    return true;
+#else
+    Q_UNUSED(socket);
+    Q_UNUSED(time);
+    return false;
+#endif
+}
+
+qint64 TcpInfoSeries::bytesAcked(const QAbstractSocket *socket)
+{
+#if defined(Q_OS_LINUX)
+    if (!socket || socket->socketDescriptor() < 0)
+    {
+        return -1;
+    }
+
+    TcpInfo info;
+    socklen_t length = sizeof(info);
+    memset(&info, 0, sizeof(info));
+
+    if (getsockopt(socket->socketDescriptor(), IPPROTO_TCP, TCP_INFO, &info, &length) < 0 ||
+        length < offsetof(TcpInfo, tcpi_bytes_acked) + sizeof(info.tcpi_bytes_acked))
+    {
+        return -1;
+    }
+
+    return info.tcpi_bytes_acked;
+#else
+    Q_UNUSED(socket);
+    return -1;
+#endif
+}
+
+bool TcpInfoSeries::isEmpty() const
+{
+    return m_times.isEmpty();
+}
+
+int TcpInfoSeries::size() const
+{
+    return m_times.size();
+}
+
+void TcpInfoSeries::clear()
+{
+    *this = TcpInfoSeries();
+}
+
+QVariantMap TcpInfoSeries::toVariant() const
+{
+    QVariantMap map;
+    map.insert("time_ns", listToVariant(m_times));
+    map.insert("rtt_us", listToVariant(m_rtt));
+    map.insert("rttvar_us", listToVariant(m_rttVar));
+    map.insert("rcv_rtt_us", listToVariant(m_rcvRtt));
+    map.insert("cwnd", listToVariant(m_cwnd));
+    map.insert("retransmits", listToVariant(m_retransmits));
+    map.insert("delivery_rate_Bps", listToVariant(m_deliveryRate));
+    map.insert("rcv_space", listToVariant(m_rcvSpace));
+    map.insert("busy_us", listToVariant(m_busyTime));
+    map.insert("rwnd_limited_us", listToVariant(m_rwndLimited));
+    map.insert("sndbuf_limited_us", listToVariant(m_sndbufLimited));
+    return map;
+}
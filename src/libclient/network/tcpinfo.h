@@ -0,0 +1,61 @@
+#ifndef TCPINFO_H
+#define TCPINFO_H
+
+#include <QtGlobal>
+#include <QVariantMap>
+#include <QVector>
+
+class QAbstractSocket;
+
+/*
+ * Time series of the kernel's TCP_INFO of one connection, to tell a
+ * receive window limited transfer from a congestion or loss limited one.
+ * Every field is kept in its own vector and reported as a list, so a
+ * sample costs a few integers. The owner calls sample() from its own
+ * timer, on systems without TCP_INFO (everything but Linux) nothing is
+ * recorded.
+ */
+class TcpInfoSeries
+{
+public:
+    TcpInfoSeries();
+
+    // ms, sampling more often costs more than it tells
+    static const int minInterval = 10;
+
+    static bool isSupported();
+
+    // time in ns on the clock of the caller, false if the socket could not
+    // be queried (not connected, closed or unsupported)
+    bool sample(const QAbstractSocket *socket, qint64 time);
+
+    // bytes of the connection the receiver acknowledged, -1 where the
+    // kernel does not tell (before Linux 4.1 and everywhere else)
+    static qint64 bytesAcked(const QAbstractSocket *socket);
+
+    bool isEmpty() const;
+    int size() const;
+    void clear();
+
+    QVariantMap toVariant() const;
+
+private:
+    QVector<qint64> m_times;
+    // usec, as measured by the sender and the receiver side of the socket
+    QVector<quint32> m_rtt;
+    QVector<quint32> m_rttVar;
+    QVector<quint32> m_rcvRtt;
+    // segments
+    QVector<quint32> m_cwnd;
+    QVector<quint32> m_retransmits;
+    // bytes per second
+    QVector<quint64> m_deliveryRate;
+    // bytes
+    QVector<quint32> m_rcvSpace;
+    // usec since the connection was established
+    QVector<quint64> m_busyTime;
+    QVector<quint64> m_rwndLimited;
+    QVector<quint64> m_sndbufLimited;
+};
+
+#endif // TCPINFO_H
@@ -10,6 +10,7 @@ bool Storage::deleteData()
     dirs<<storagePath.cacheDirectory();
     dirs<<storagePath.schedulerDirectory();
     dirs<<storagePath.reportDirectory();
+    dirs<<storagePath.topologyDirectory();
 
     foreach (QDir dir, dirs)
     {
@@ -31,6 +31,11 @@ QDir StoragePaths::logDirectory() const
     return QDir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/logs");
 }
 
+QDir StoragePaths::topologyDirectory() const
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/topology");
+}
+
 QDir StoragePaths::crashDumpDirectory() const
 {
     return QDir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/crashdumps");
@@ -15,6 +15,7 @@ public:
     QDir reportDirectory() const;
     QDir cacheDirectory() const;
     QDir logDirectory() const;
+    QDir topologyDirectory() const;
 
     QDir crashDumpDirectory() const;
 
@@ -65,6 +65,11 @@ QDir StoragePaths::logDirectory() const
     return StoragePaths::Private::log;
 }
 
+QDir StoragePaths::topologyDirectory() const
+{
+    return QDir(StoragePaths::Private::cache.absoluteFilePath("topology"));
+}
+
 QDir StoragePaths::crashDumpDirectory() const
 {
     return StoragePaths::Private::crashDumps;
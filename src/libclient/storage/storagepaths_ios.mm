@@ -52,6 +52,11 @@ QDir StoragePaths::logDirectory() const
     return QDir(d->applicationRootPath);
 }
 
+QDir StoragePaths::topologyDirectory() const
+{
+    return QDir(cacheDirectory().absoluteFilePath("topology"));
+}
+
 QDir StoragePaths::crashDumpDirectory() const
 {
     return QDir(d->applicationRootPath + "/crashdumps");
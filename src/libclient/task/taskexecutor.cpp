@@ -44,6 +44,7 @@ public slots:
 
             connect(measurement.data(), SIGNAL(finished()), this, SLOT(measurementFinished()));
             connect(measurement.data(), SIGNAL(error(const QString &)), this, SLOT(measurementError(const QString &)));
+            connect(measurement.data(), SIGNAL(resultReady(const Result &)), this, SLOT(measurementResultReady(const Result &)));
 
             if (observer)
             {
@@ -94,10 +95,21 @@ public slots:
         }
     }
 
+    void measurementResultReady(const Result &result)
+    {
+        Result intermediate = result;
+        intermediate.setStartDateTime(measurement->startDateTime());
+        intermediate.setEndDateTime(measurement->startDateTime().addMSecs(timer.elapsed()));
+        intermediate.setPreInfo(measurement->preInfo());
+
+        emit resultReady(currentTest, intermediate);
+    }
+
     void measurementFinished()
     {
         measurement->disconnect(this, SLOT(measurementFinished()));
         measurement->disconnect(this, SLOT(measurementError(const QString &)));
+        measurement->disconnect(this, SLOT(measurementResultReady(const Result &)));
 
         LOG_INFO(QString("Finished execution of %1 (success)").arg(currentTest.name()));
 
@@ -117,6 +129,7 @@ public slots:
     {
         measurement->disconnect(this, SLOT(measurementFinished()));
         measurement->disconnect(this, SLOT(measurementError(const QString &)));
+        measurement->disconnect(this, SLOT(measurementResultReady(const Result &)));
 
         LOG_ERROR(QString("Finished execution of %1 (failed): %2").arg(currentTest.name()).arg(errorMsg));
 
@@ -135,6 +148,7 @@ public slots:
 signals:
     void started(const ScheduleDefinition &test);
     void finished(const ScheduleDefinition &test, const Result &result);
+    void resultReady(const ScheduleDefinition &test, const Result &result);
 };
 
 class TaskExecutor::Private : public QObject
@@ -157,6 +171,7 @@ public:
 
         connect(&executor, SIGNAL(started(ScheduleDefinition)), q, SIGNAL(started(ScheduleDefinition)));
         connect(&executor, SIGNAL(finished(ScheduleDefinition, Result)), q, SIGNAL(finished(ScheduleDefinition, Result)));
+        connect(&executor, SIGNAL(resultReady(ScheduleDefinition, Result)), q, SIGNAL(resultReady(ScheduleDefinition, Result)));
     }
 
     ~Private()
@@ -37,6 +37,8 @@ signals:
 
     void started(const ScheduleDefinition &test);
     void finished(const ScheduleDefinition &test, const Result &result);
+    // the measurement is still running, see Measurement::resultReady()
+    void resultReady(const ScheduleDefinition &test, const Result &result);
 
 protected:
     class Private;
@@ -19,6 +19,12 @@ class TrafficBudgetManager::Private : public QObject
 public:
     Private(TrafficBudgetManager *q)
         : q(q)
+        , settings(NULL)
+        , availableTraffic(0)
+        , usedTraffic(0)
+        , availableMobileTraffic(0)
+        , usedMobileTraffic(0)
+        , active(false)
         , resetTiming(new CalendarTiming(QDateTime(), QDateTime(), CalendarTiming::AllMonths, CalendarTiming::AllDaysOfWeek, QList<int>()<<1, QList<int>()<<0, QList<int>()<<1, QList<int>()<<0))
         , timer(resetTiming)
     {
@@ -85,6 +91,12 @@ void TrafficBudgetManager::init()
 
 void TrafficBudgetManager::saveTraffic()
 {
+    // nothing to save to before init()
+    if (!d->settings)
+    {
+        return;
+    }
+
     if (Client::instance()->networkManager()->onMobileConnection())
     {
         d->settings->setAvailableMobileTraffic(d->availableMobileTraffic);
@@ -5,6 +5,7 @@
 #include <QMetaEnum>
 #include <QHostAddress>
 #include <QList>
+#include <QVector>
 #include <QUuid>
 #include "export.h"
 
@@ -152,6 +153,20 @@ QVariantList listToVariant(const QList<T> &list)
     return lst;
 }
 
+template <typename T>
+QVariantList listToVariant(const QVector<T> &vector)
+{
+    QVariantList lst;
+    lst.reserve(vector.size());
+
+    foreach (T entry, vector)
+    {
+        lst.append(QVariant::fromValue(entry));
+    }
+
+    return lst;
+}
+
 template <typename T>
 QList<T> listFromVariant(const QVariant &variant)
 {
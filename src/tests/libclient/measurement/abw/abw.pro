@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_abw
+SOURCES = tst_abw.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
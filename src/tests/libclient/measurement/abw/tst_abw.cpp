@@ -0,0 +1,120 @@
+#include <QtTest>
+
+#include <measurement/abw/abw_trend.h>
+
+class TestAvailableBandwidth : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void increasingTrend()
+    {
+        // queueing delay builds up by 1 us per packet on top of noise
+        QVector<qint64> delays;
+
+        for (int i = 0; i < 100; i++)
+        {
+            delays.append(5000000 + i * 1000 + (i % 3) * 500);
+        }
+
+        QVector<qreal> medians = abw::groupMedians(delays);
+
+        QCOMPARE(medians.size(), 10);
+        QCOMPARE(abw::pct(medians), 1.0);
+        QCOMPARE(abw::pdt(medians), 1.0);
+        QCOMPARE(abw::trend(delays, 100), abw::Increasing);
+    }
+
+    void flatTrend()
+    {
+        // jitter without any trend
+        QVector<qint64> delays;
+
+        for (int i = 0; i < 100; i++)
+        {
+            delays.append(5000000 + (i * 7 % 10) * 1000);
+        }
+
+        QVector<qreal> medians = abw::groupMedians(delays);
+
+        QCOMPARE(abw::pct(medians), 0.0);
+        QCOMPARE(abw::pdt(medians), 0.0);
+        QCOMPARE(abw::trend(delays, 100), abw::NonIncreasing);
+    }
+
+    void lossyTrend()
+    {
+        QVector<qint64> delays(89, 5000000);
+
+        QCOMPARE(abw::trend(delays, 100), abw::Lossy);
+        QCOMPARE(abw::trend(QVector<qint64>(90, 5000000), 100), abw::NonIncreasing);
+        QCOMPARE(abw::trend(QVector<qint64>(10, 5000000), 10), abw::Grey);
+    }
+
+    void verdict()
+    {
+        QCOMPARE(abw::RateSearch::verdict(5, 1, 6), abw::RateSearch::Above);
+        QCOMPARE(abw::RateSearch::verdict(1, 5, 6), abw::RateSearch::Below);
+        QCOMPARE(abw::RateSearch::verdict(4, 2, 6), abw::RateSearch::Ambiguous);
+    }
+
+    void search_data()
+    {
+        QTest::addColumn<quint64>("available");
+        QTest::addColumn<quint64>("grey");
+
+        QTest::newRow("low") << Q_UINT64_C(1000000) << Q_UINT64_C(0);
+        QTest::newRow("high") << Q_UINT64_C(90000000) << Q_UINT64_C(0);
+        QTest::newRow("varying") << Q_UINT64_C(40000000) << Q_UINT64_C(3000000);
+    }
+
+    void search()
+    {
+        QFETCH(quint64, available);
+        QFETCH(quint64, grey);
+
+        abw::RateSearch search(125000, 125000000, 250000);
+        int fleets = 0;
+
+        while (!search.isConverged() && fleets < 50)
+        {
+            quint64 rate = search.rate();
+
+            // the available bandwidth varies by +-grey during a fleet
+            if (rate + grey < available)
+            {
+                search.update(abw::RateSearch::Below);
+            }
+            else if (rate > available + grey)
+            {
+                search.update(abw::RateSearch::Above);
+            }
+            else
+            {
+                search.update(abw::RateSearch::Ambiguous);
+            }
+
+            fleets++;
+        }
+
+        QVERIFY(search.isConverged());
+        QVERIFY(fleets <= 20);
+        QVERIFY(search.low() <= available);
+        QVERIFY(search.high() >= available);
+        QCOMPARE(search.hasGrey(), grey > 0);
+
+        if (grey == 0)
+        {
+            QVERIFY(search.high() - search.low() <= 250000);
+        }
+        else
+        {
+            QVERIFY(search.greyLow() >= available - grey);
+            QVERIFY(search.greyHigh() <= available + grey);
+        }
+    }
+};
+
+QTEST_MAIN(TestAvailableBandwidth)
+
+#include "tst_abw.moc"
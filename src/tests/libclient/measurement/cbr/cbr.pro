@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_cbr
+SOURCES = tst_cbr.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
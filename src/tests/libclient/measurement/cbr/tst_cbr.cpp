@@ -0,0 +1,64 @@
+#include <QtTest>
+
+#include <measurement/cbr/cbr_stats.h>
+
+class TestConstantBitrate : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void jitter()
+    {
+        cbr::JitterEstimator constant;
+
+        for (int i = 0; i < 10; i++)
+        {
+            constant.add(5000000);
+        }
+
+        QCOMPARE(constant.jitter(), 0.0);
+
+        // transit alternating by 1 ms converges to 1 ms
+        cbr::JitterEstimator alternating;
+
+        for (int i = 0; i < 1000; i++)
+        {
+            alternating.add(i % 2 ? 1000000 : 0);
+        }
+
+        QVERIFY(qAbs(alternating.jitter() - 1000000) < 1);
+        QVERIFY(alternating.maxJitter() >= alternating.jitter());
+    }
+
+    void burstLengths()
+    {
+        QVector<bool> received;
+        received << true << false << true << false << false << true << true << false << false << false;
+
+        QCOMPARE(cbr::burstLengths(received), QVector<int>() << 1 << 2 << 3);
+        QVERIFY(cbr::burstLengths(QVector<bool>(10, true)).isEmpty());
+    }
+
+    void mos()
+    {
+        // G.711 without impairments
+        QCOMPARE(cbr::rFactor(0, 0, 1), 93.2);
+        QVERIFY(qAbs(cbr::mos(93.2) - 4.41) < 0.01);
+
+        // loss, bursty loss and a long delay each lower the score
+        qreal clean = cbr::mos(cbr::rFactor(80, 0, 1));
+        qreal lossy = cbr::mos(cbr::rFactor(80, 0.01, 1));
+        qreal bursty = cbr::mos(cbr::rFactor(80, 0.01, 2));
+
+        QVERIFY(clean > lossy);
+        QVERIFY(lossy > bursty);
+        QVERIFY(cbr::mos(cbr::rFactor(400, 0, 1)) < 3.1);
+
+        QCOMPARE(cbr::mos(-5), 1.0);
+        QCOMPARE(cbr::mos(120), 4.5);
+    }
+};
+
+QTEST_MAIN(TestConstantBitrate)
+
+#include "tst_cbr.moc"
@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_httpresponseparser
+SOURCES = tst_httpresponseparser.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
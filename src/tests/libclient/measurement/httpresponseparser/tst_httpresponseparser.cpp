@@ -0,0 +1,96 @@
+#include <QtTest>
+
+#include <measurement/http/httpresponseparser.h>
+
+class TestHttpResponseParser : public QObject
+{
+    Q_OBJECT
+
+private:
+    // feeds the response one byte at a time to cover every split
+    static void feedBytewise(HttpResponseParser &parser, const QByteArray &data)
+    {
+        for (int i = 0; i < data.size(); i++)
+        {
+            parser.feed(data.constData() + i, 1);
+        }
+    }
+
+private slots:
+    void contentLength()
+    {
+        HttpResponseParser parser;
+        QByteArray header("HTTP/1.1 200 OK\r\nContent-Length: 10\r\nServer: test\r\n\r\n");
+
+        parser.feed(header.constData(), header.size());
+
+        QCOMPARE(parser.statusCode(), 200);
+        QVERIFY(parser.headersComplete());
+        QCOMPARE(parser.contentLength(), Q_INT64_C(10));
+        QCOMPARE(parser.skippable(), Q_INT64_C(10));
+
+        parser.skip(4);
+        QCOMPARE(parser.skippable(), Q_INT64_C(6));
+        QVERIFY(!parser.isComplete());
+
+        parser.feed("012345", 6);
+        QVERIFY(parser.isComplete());
+        QCOMPARE(parser.skippable(), Q_INT64_C(0));
+    }
+
+    void chunked()
+    {
+        HttpResponseParser parser;
+
+        feedBytewise(parser, "HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n"
+                             "5;ext=1\r\nhello\r\n"
+                             "6\r\n world\r\n");
+
+        QVERIFY(parser.isChunked());
+        QCOMPARE(parser.state(), HttpResponseParser::ChunkSize);
+
+        feedBytewise(parser, "a\r\n");
+        QCOMPARE(parser.skippable(), Q_INT64_C(10));
+        parser.skip(10);
+        QCOMPARE(parser.state(), HttpResponseParser::ChunkDataEnd);
+
+        feedBytewise(parser, "\r\n0\r\nTrailer: x\r\n\r\n");
+        QVERIFY(parser.isComplete());
+    }
+
+    void untilClose()
+    {
+        HttpResponseParser parser;
+        feedBytewise(parser, "HTTP/1.0 200 OK\r\n\r\nsome data");
+
+        QCOMPARE(parser.state(), HttpResponseParser::Body);
+        QCOMPARE(parser.skippable(), Q_INT64_C(-1));
+        QVERIFY(!parser.isComplete());
+    }
+
+    void interimResponse()
+    {
+        HttpResponseParser parser;
+        feedBytewise(parser, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+        QCOMPARE(parser.statusCode(), 404);
+        QVERIFY(parser.isComplete());
+    }
+
+    void malformed()
+    {
+        HttpResponseParser parser;
+        feedBytewise(parser, "SSH-2.0-OpenSSH\r\n");
+
+        QCOMPARE(parser.state(), HttpResponseParser::Error);
+
+        HttpResponseParser chunks;
+        feedBytewise(chunks, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n");
+
+        QCOMPARE(chunks.state(), HttpResponseParser::Error);
+    }
+};
+
+QTEST_MAIN(TestHttpResponseParser)
+
+#include "tst_httpresponseparser.moc"
@@ -0,0 +1,109 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <measurement/http/httpupload.h>
+#include <measurement/http/httpupload_definition.h>
+
+// accepts HTTP uploads on the loopback interface and throws the data away
+class Sink : public QObject
+{
+    Q_OBJECT
+
+public:
+    Sink()
+    : received(0)
+    {
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        server.listen(QHostAddress::LocalHost);
+    }
+
+    QTcpServer server;
+    qint64 received;
+    QByteArray head;
+
+private slots:
+    void newConnection()
+    {
+        while (server.hasPendingConnections())
+        {
+            QTcpSocket *socket = server.nextPendingConnection();
+            connect(socket, SIGNAL(readyRead()), this, SLOT(read()));
+        }
+    }
+
+    void read()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        QByteArray data = socket->readAll();
+
+        if (head.size() < 256)
+        {
+            head.append(data.left(256));
+        }
+
+        received += data.size();
+    }
+};
+
+class TestHTTPUpload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void definition()
+    {
+        HTTPUploadDefinition definition("http://localhost/upload", 4, 5000, 2000, 500);
+        HTTPUploadDefinitionPtr copy = HTTPUploadDefinition::fromVariant(definition.toVariant());
+
+        QCOMPARE(copy->url, QString("http://localhost/upload"));
+        QCOMPARE(copy->threads, 4);
+        QCOMPARE(copy->targetTime, 5000);
+        QCOMPARE(copy->rampUpTime, 2000);
+        QCOMPARE(copy->slotLength, 500);
+    }
+
+    void invalidDefinition()
+    {
+        HTTPUpload upload;
+
+        QVERIFY(!upload.prepare(NULL, HTTPUploadDefinitionPtr(
+                                    new HTTPUploadDefinition("http://localhost/upload", 65, 5000, 2000, 500))));
+        QVERIFY(!upload.prepare(NULL, HTTPUploadDefinitionPtr(
+                                    new HTTPUploadDefinition("http://localhost/upload", 1, 5000, 2000, 100))));
+    }
+
+    void uploadToSink()
+    {
+        Sink sink;
+        QVERIFY(sink.server.isListening());
+
+        QString url = QString("http://127.0.0.1:%1/upload").arg(sink.server.serverPort());
+
+        HTTPUpload upload;
+        QSignalSpy finished(&upload, SIGNAL(finished()));
+
+        QVERIFY(upload.prepare(NULL, HTTPUploadDefinitionPtr(new HTTPUploadDefinition(url, 2, 2000, 1000, 250))));
+        QVERIFY(upload.start());
+        QVERIFY(finished.wait(15000));
+
+        QVariantMap result = upload.result().probeResult();
+        QVariantList threads = result.value("bandwidth_bps_per_thread").toList();
+
+        QVERIFY(sink.head.startsWith("POST /upload HTTP/1.1\r\n"));
+        QVERIFY(sink.received > 0);
+        QCOMPARE(result.value("actual_num_threads").toInt(), 2);
+        QCOMPARE(threads.size(), 2);
+        QVERIFY(result.value("bandwidth_bps_avg").toDouble() > 0);
+
+        foreach (const QVariant &thread, threads)
+        {
+            QVERIFY(thread.toMap().value("avg").toDouble() > 0);
+            QVERIFY(!thread.toMap().value("slots").toList().isEmpty());
+        }
+    }
+};
+
+QTEST_MAIN(TestHTTPUpload)
+
+#include "tst_httpupload.moc"
@@ -0,0 +1,12 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        abw \
+        cbr \
+        httpresponseparser \
+        httpupload \
+        multipathtraceroute \
+        owd \
+        pingsweep \
+        statistics \
+        throughput
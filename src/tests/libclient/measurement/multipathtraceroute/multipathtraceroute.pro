@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_multipathtraceroute
+SOURCES = tst_multipathtraceroute.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
@@ -0,0 +1,46 @@
+#include <QtTest>
+
+#include <measurement/multipath_traceroute/multipath_traceroute.h>
+
+class TestMultipathTraceroute : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stoppingPoints()
+    {
+        // the table of the MDA paper for 95% confidence
+        QVector<quint32> points = mda::stoppingPoints(0.95, 64);
+
+        QCOMPARE(points, QVector<quint32>() << 1 << 6 << 11 << 16 << 21 << 27 << 33 << 38 << 44 << 51 << 57
+                                            << 63 << 70);
+    }
+
+    void bonferroni()
+    {
+        // 2 * 0.5^n <= 0.05 / 480 after 15 probes for the second next hop
+        QVector<quint32> points = mda::stoppingPoints(0.95, 64, 480);
+
+        QCOMPARE(points, QVector<quint32>() << 1 << 15 << 26 << 37 << 49 << 61 << 73);
+        QCOMPARE(mda::stoppingPoints(0.95, 64, 0), mda::stoppingPoints(0.95, 64, 1));
+    }
+
+    void bounded()
+    {
+        // only the last point is above the probes available
+        QVector<quint32> points = mda::stoppingPoints(0.99, 16);
+
+        QVERIFY(points.last() > 16);
+
+        for (int k = 1; k < points.size(); k++)
+        {
+            QVERIFY(points[k] > points[k - 1]);
+        }
+
+        QVERIFY(points[points.size() - 2] <= 16);
+    }
+};
+
+QTEST_MAIN(TestMultipathTraceroute)
+
+#include "tst_multipathtraceroute.moc"
@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_owd
+SOURCES = tst_owd.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
@@ -0,0 +1,50 @@
+#include <QtTest>
+
+#include <measurement/owd/owd_packet.h>
+
+class TestOneWayDelay : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void ntpTimestamp()
+    {
+        // 2014-01-01 00:00:00.25 UTC
+        qint64 time = Q_INT64_C(1388534400250000000);
+        quint64 ntp = owd::toNtp(time);
+
+        QCOMPARE(ntp >> 32, Q_UINT64_C(3597523200));
+        QCOMPARE(ntp & Q_UINT64_C(0xffffffff), Q_UINT64_C(0x40000000));
+        QCOMPARE(owd::fromNtp(ntp), time);
+
+        // the fraction resolves well below a ns
+        QCOMPARE(owd::fromNtp(owd::toNtp(time + 123456789)), time + 123456789);
+    }
+
+    void reflectedPacket()
+    {
+        QByteArray sender(64, 0);
+        QByteArray reflector(64, 0);
+
+        owd::writeSenderHeader(sender.data(), 42, Q_INT64_C(1388534400000000000), true);
+        owd::writeReflectorHeader(reflector.data(), 7, Q_INT64_C(1388534400000300000), false,
+                                  Q_INT64_C(1388534400000200000), sender.constData());
+
+        owd::ReflectorHeader header = owd::readReflectorHeader(reflector.constData());
+
+        QCOMPARE(header.seq, quint32(7));
+        QCOMPARE(header.time, Q_INT64_C(1388534400000300000));
+        QCOMPARE(header.synchronized, false);
+        QCOMPARE(header.receiveTime, Q_INT64_C(1388534400000200000));
+        QCOMPARE(header.senderSeq, quint32(42));
+        QCOMPARE(header.senderTime, Q_INT64_C(1388534400000000000));
+
+        // RFC 5357 layout: sender's error estimate with the S bit at 36
+        QCOMPARE((quint8)reflector.at(36), quint8(0x80));
+        QCOMPARE((quint8)reflector.at(40), quint8(255));
+    }
+};
+
+QTEST_MAIN(TestOneWayDelay)
+
+#include "tst_owd.moc"
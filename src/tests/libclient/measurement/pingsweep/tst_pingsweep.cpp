@@ -0,0 +1,61 @@
+#include <QtTest>
+
+#include <measurement/ping_sweep/ping_sweep.h>
+
+class TestPingSweep : public QObject
+{
+    Q_OBJECT
+
+private:
+    static PingSweepDefinitionPtr definition(const QStringList &hosts, quint32 rate = 100, quint16 port = 33434,
+                                             quint32 payload = 64, ping::PingType type = ping::Udp)
+    {
+        return PingSweepDefinitionPtr(new PingSweepDefinition(hosts, 3, rate, 1000, 64, port, 33434, payload, type));
+    }
+
+private slots:
+    void invalidDefinitions()
+    {
+        QStringList hosts("localhost");
+
+        QVERIFY(!PingSweep().prepare(NULL, definition(QStringList())));
+        QVERIFY(!PingSweep().prepare(NULL, definition(hosts, 0)));
+        QVERIFY(!PingSweep().prepare(NULL, definition(hosts, 100, 65535)));
+        QVERIFY(!PingSweep().prepare(NULL, definition(hosts, 100, 33434, 1401)));
+        QVERIFY(!PingSweep().prepare(NULL, definition(hosts, 100, 33434, 64, ping::Tcp)));
+    }
+
+#if defined(Q_OS_LINUX)
+    void validDefinition()
+    {
+        // nothing is resolved or sent before start()
+        QVERIFY(PingSweep().prepare(NULL, definition(QStringList() << "localhost" << "::1")));
+    }
+
+    void addresses()
+    {
+        sockaddr_any a, b, c;
+
+        QVERIFY(toSockaddr(QHostAddress("192.0.2.1"), &a));
+        QVERIFY(toSockaddr(QHostAddress("192.0.2.1"), &b));
+        QVERIFY(toSockaddr(QHostAddress("2001:db8::1"), &c));
+
+        // the reply matching only looks at the addresses
+        setPort(&a, 33434);
+        QCOMPARE(getPort(a), (quint16)33434);
+        QCOMPARE(getPort(b), (quint16)0);
+        QVERIFY(sameHost(a, b));
+        QVERIFY(!sameHost(a, c));
+
+        QCOMPARE(addressToString(a), QString("192.0.2.1"));
+        QCOMPARE(addressToString(c), QString("2001:db8::1"));
+        QCOMPARE(addressLength(c), (socklen_t)sizeof(c.sin6));
+
+        QVERIFY(!toSockaddr(QHostAddress(), &a));
+    }
+#endif
+};
+
+QTEST_MAIN(TestPingSweep)
+
+#include "tst_pingsweep.moc"
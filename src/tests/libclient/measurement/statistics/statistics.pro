@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib
+
+TARGET = tst_statistics
+SOURCES = tst_statistics.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
@@ -0,0 +1,100 @@
+#include <QtTest>
+
+#include <measurement/statistics.h>
+
+class TestStatistics : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void empty()
+    {
+        Statistics statistics;
+
+        QCOMPARE(statistics.count(), Q_UINT64_C(0));
+        QCOMPARE(statistics.mean(), 0.0);
+        QCOMPARE(statistics.stdev(), 0.0);
+        QCOMPARE(statistics.min(), 0.0);
+        QCOMPARE(statistics.max(), 0.0);
+        QCOMPARE(statistics.quantile(0.5), 0.0);
+    }
+
+    void moments()
+    {
+        Statistics statistics;
+
+        foreach (qreal value, QList<qreal>() << 2 << 4 << 4 << 4 << 5 << 5 << 7 << 9)
+        {
+            statistics.add(value);
+        }
+
+        QCOMPARE(statistics.count(), Q_UINT64_C(8));
+        QCOMPARE(statistics.mean(), 5.0);
+        QCOMPARE(statistics.variance(), 4.0);
+        QCOMPARE(statistics.stdev(), 2.0);
+        QCOMPARE(statistics.min(), 2.0);
+        QCOMPARE(statistics.max(), 9.0);
+    }
+
+    void quantiles()
+    {
+        Statistics statistics;
+
+        // values in reverse order so the sketch has to grow downwards
+        for (int i = 10000; i > 0; i--)
+        {
+            statistics.add(i / 10.0);
+        }
+
+        // the sketch guarantees 1% relative accuracy
+        QVERIFY(qAbs(statistics.quantile(0.5) - 500.0) <= 500.0 * 0.01 + 0.1);
+        QVERIFY(qAbs(statistics.quantile(0.9) - 900.0) <= 900.0 * 0.01 + 0.1);
+        QVERIFY(qAbs(statistics.quantile(0.99) - 990.0) <= 990.0 * 0.01 + 0.1);
+        QVERIFY(qAbs(statistics.quantile(0.0) - 0.1) <= 0.1 * 0.01);
+        QVERIFY(qAbs(statistics.quantile(1.0) - 1000.0) <= 1000.0 * 0.01);
+    }
+
+    void zeros()
+    {
+        Statistics statistics;
+
+        for (int i = 0; i < 10; i++)
+        {
+            statistics.add(i < 6 ? 0.0 : 100.0);
+        }
+
+        QCOMPARE(statistics.quantile(0.5), 0.0);
+        QVERIFY(qAbs(statistics.quantile(0.9) - 100.0) <= 1.0);
+    }
+
+    void merge()
+    {
+        Statistics all, even, odd;
+
+        for (int i = 1; i <= 1000; i++)
+        {
+            all.add(i);
+            (i % 2 ? odd : even).add(i);
+        }
+
+        even.merge(odd);
+
+        QCOMPARE(even.count(), all.count());
+        QCOMPARE(even.mean(), all.mean());
+        QVERIFY(qAbs(even.variance() - all.variance()) < 1e-6);
+        QCOMPARE(even.min(), all.min());
+        QCOMPARE(even.max(), all.max());
+        QCOMPARE(even.quantile(0.5), all.quantile(0.5));
+        QCOMPARE(even.quantile(0.99), all.quantile(0.99));
+
+        Statistics empty;
+        empty.merge(all);
+
+        QCOMPARE(empty.count(), all.count());
+        QCOMPARE(empty.quantile(0.9), all.quantile(0.9));
+    }
+};
+
+QTEST_MAIN(TestStatistics)
+
+#include "tst_statistics.moc"
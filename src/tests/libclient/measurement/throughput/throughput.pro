@@ -0,0 +1,8 @@
+CONFIG += testcase
+CONFIG -= app_bundle
+QT += testlib network
+
+TARGET = tst_throughput
+SOURCES = tst_throughput.cpp
+
+include($$SOURCE_DIRECTORY/src/libclient/libclient.pri)
@@ -0,0 +1,577 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <measurement/http/httpdownload.h>
+#include <measurement/http/httpdownload_definition.h>
+#include <measurement/btc/btc_ma.h>
+#include <measurement/btc/btc_mp.h>
+#include <measurement/btc/btc_definition.h>
+#include <network/networkmanager.h>
+
+#if defined(Q_OS_LINUX)
+#include <sys/resource.h>
+#endif
+
+/*
+ * Accuracy and cost of the throughput measurements on loopback. The peers
+ * (an HTTP server and a BulkTransportCapacityMP) run in their own thread
+ * behind a relay which shapes the traffic towards the client with a token
+ * bucket. The rate the relay actually delivered is the reference the
+ * measured throughput is compared against, so a relay which can not keep
+ * up with the configured rate does not fail the test.
+ */
+
+namespace
+{
+    char payload[65536];
+
+    // CPU time of the calling thread in ns, -1 if unknown
+    qint64 threadCpuTime()
+    {
+#if defined(Q_OS_LINUX)
+        struct rusage usage;
+
+        if (getrusage(RUSAGE_THREAD, &usage) == 0)
+        {
+            return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * Q_INT64_C(1000000000) +
+                   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * Q_INT64_C(1000);
+        }
+#endif
+
+        return -1;
+    }
+
+    quint16 freePort()
+    {
+        QTcpServer server;
+        server.listen(QHostAddress::LocalHost);
+        return server.serverPort();
+    }
+}
+
+// answers every GET with an endless body
+class HttpSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    HttpSource()
+    {
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        server.listen(QHostAddress::LocalHost);
+    }
+
+    QTcpServer server;
+
+private slots:
+    void newConnection()
+    {
+        while (server.hasPendingConnections())
+        {
+            QTcpSocket *socket = server.nextPendingConnection();
+            connect(socket, SIGNAL(readyRead()), this, SLOT(read()));
+            connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(fill()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void read()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+        socket->setProperty("request", request);
+
+        if (!socket->property("streaming").toBool() && request.contains("\r\n\r\n"))
+        {
+            socket->setProperty("streaming", true);
+            socket->write("HTTP/1.1 200 OK\r\nContent-Length: 1099511627776\r\n\r\n");
+            fillSocket(socket);
+        }
+    }
+
+    void fill()
+    {
+        fillSocket(qobject_cast<QTcpSocket *>(sender()));
+    }
+
+private:
+    void fillSocket(QTcpSocket *socket)
+    {
+        while (socket->property("streaming").toBool() && socket->bytesToWrite() < maxQueued)
+        {
+            socket->write(payload, sizeof(payload));
+        }
+    }
+
+    static const qint64 maxQueued = 1 << 20;
+};
+
+// forwards connections to a local port and shapes what comes back with a
+// token bucket shared by all connections, a rate of 0 forwards as fast as
+// the relay can
+class Relay : public QObject
+{
+    Q_OBJECT
+
+public:
+    Relay(quint16 targetPort, qint64 rate)
+    : targetPort(targetPort)
+    , rate(rate)
+    , tokens(0)
+    , lastTick(0)
+    , delivered(0)
+    , firstDelivery(-1)
+    , lastDelivery(-1)
+    {
+        connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        connect(&ticker, SIGNAL(timeout()), this, SLOT(tick()));
+        server.listen(QHostAddress::LocalHost);
+        clock.start();
+
+        ticker.setTimerType(Qt::PreciseTimer);
+        ticker.start(1);
+    }
+
+    // bps the relay delivered while it was busy
+    qreal deliveredRate() const
+    {
+        if (lastDelivery <= firstDelivery)
+        {
+            return 0.0;
+        }
+
+        return delivered * 8.0 * 1000000000 / (lastDelivery - firstDelivery);
+    }
+
+    QTcpServer server;
+
+private slots:
+    void newConnection()
+    {
+        while (server.hasPendingConnections())
+        {
+            QTcpSocket *client = server.nextPendingConnection();
+            QTcpSocket *upstream = new QTcpSocket(client);
+
+            // the bucket decides how fast the peer may send
+            upstream->setReadBufferSize(maxQueued);
+            upstream->connectToHost(QHostAddress::LocalHost, targetPort);
+
+            client->setProperty("upstream", QVariant::fromValue<QObject *>(upstream));
+            upstream->setProperty("client", QVariant::fromValue<QObject *>(client));
+
+            connect(client, SIGNAL(readyRead()), this, SLOT(forwardRequest()));
+            connect(client, SIGNAL(bytesWritten(qint64)), this, SLOT(bytesDelivered(qint64)));
+            connect(client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+            connect(upstream, SIGNAL(readyRead()), this, SLOT(forwardResponse()));
+            connect(upstream, SIGNAL(disconnected()), this, SLOT(forwardResponse()));
+
+            clients.append(client);
+        }
+    }
+
+    void forwardRequest()
+    {
+        QTcpSocket *client = qobject_cast<QTcpSocket *>(sender());
+        QTcpSocket *upstream = qobject_cast<QTcpSocket *>(client->property("upstream").value<QObject *>());
+        upstream->write(client->readAll());
+    }
+
+    void forwardResponse()
+    {
+        if (rate == 0)
+        {
+            forward();
+        }
+    }
+
+    void bytesDelivered(qint64 bytes)
+    {
+        qint64 now = clock.nsecsElapsed();
+
+        if (firstDelivery < 0)
+        {
+            firstDelivery = now;
+        }
+
+        lastDelivery = now;
+        delivered += bytes;
+
+        if (rate == 0)
+        {
+            forward();
+        }
+    }
+
+    void tick()
+    {
+        qint64 now = clock.nsecsElapsed();
+
+        if (rate > 0)
+        {
+            // a bucket of 2 ms, a late timer may not cause a burst
+            tokens = qMin(tokens + (now - lastTick) * rate / 8 / 1000000000, qMax(rate / 8 / 500, (qint64)65536));
+        }
+
+        lastTick = now;
+        forward();
+    }
+
+private:
+    void forward()
+    {
+        for (int i = 0; i < clients.size(); i++)
+        {
+            QTcpSocket *client = clients[i];
+
+            if (!client)
+            {
+                clients.removeAt(i--);
+                continue;
+            }
+
+            QTcpSocket *upstream = qobject_cast<QTcpSocket *>(client->property("upstream").value<QObject *>());
+            qint64 n = qMin(upstream->bytesAvailable(), maxQueued - client->bytesToWrite());
+
+            if (rate > 0)
+            {
+                n = qMin(n, tokens);
+            }
+
+            if (n > 0)
+            {
+                client->write(upstream->read(n));
+
+                if (rate > 0)
+                {
+                    tokens -= n;
+                }
+            }
+
+            if (upstream->state() == QAbstractSocket::UnconnectedState && upstream->bytesAvailable() == 0)
+            {
+                client->disconnectFromHost();
+            }
+        }
+    }
+
+    static const qint64 maxQueued = 1 << 20;
+
+    quint16 targetPort;
+    qint64 rate;
+    qint64 tokens;
+    QTimer ticker;
+    QElapsedTimer clock;
+    qint64 lastTick;
+    QList<QPointer<QTcpSocket> > clients;
+
+    qint64 delivered;
+    qint64 firstDelivery;
+    qint64 lastDelivery;
+};
+
+// everything on the far side of the link, lives in the peer thread
+class Peer : public QObject
+{
+    Q_OBJECT
+
+public:
+    Peer()
+    : httpSource(NULL)
+    , httpRelay(NULL)
+    , btcRelay(NULL)
+    , btcPort(0)
+    {
+    }
+
+    HttpSource *httpSource;
+    Relay *httpRelay;
+    Relay *btcRelay;
+    quint16 btcPort;
+    QScopedPointer<NetworkManager> networkManager;
+    QScopedPointer<BulkTransportCapacityMP> btcMp;
+
+public slots:
+    // the relays are only read in this thread
+    qreal httpRate() const
+    {
+        return httpRelay->deliveredRate();
+    }
+
+    qreal btcRate() const
+    {
+        return btcRelay->deliveredRate();
+    }
+
+    void setUp(qint64 rate)
+    {
+        networkManager.reset(new NetworkManager);
+
+        httpSource = new HttpSource;
+        httpSource->setParent(this);
+        httpRelay = new Relay(httpSource->server.serverPort(), rate);
+        httpRelay->setParent(this);
+
+        btcPort = freePort();
+        btcMp.reset(new BulkTransportCapacityMP);
+        btcMp->prepare(networkManager.data(), BulkTransportCapacityDefinitionPtr(
+                           new BulkTransportCapacityDefinition("127.0.0.1", btcPort, 1024 * 1024, 10, 0, 1,
+                                                                           btc::Down, btc::uploadProtocol)));
+        btcMp->start();
+        btcRelay = new Relay(btcPort, rate);
+        btcRelay->setParent(this);
+    }
+
+    void tearDown()
+    {
+        delete httpRelay;
+        delete httpSource;
+        delete btcRelay;
+        btcMp.reset();
+        networkManager.reset();
+    }
+};
+
+class TestThroughput : public QObject
+{
+    Q_OBJECT
+
+private:
+    void startPeer(qint64 rate)
+    {
+        peer = new Peer;
+        peer->moveToThread(&peerThread);
+        peerThread.start();
+        QMetaObject::invokeMethod(peer, "setUp", Qt::BlockingQueuedConnection, Q_ARG(qint64, rate));
+    }
+
+    void stopPeer()
+    {
+        QMetaObject::invokeMethod(peer, "tearDown", Qt::BlockingQueuedConnection);
+        peerThread.quit();
+        peerThread.wait();
+        delete peer;
+        peer = NULL;
+    }
+
+    void report(const char *engine, qint64 rate, qreal reference, qreal measured, qint64 cpuTime, qint64 wallTime)
+    {
+        qreal error = qAbs(measured - reference) / reference;
+        qreal cores = cpuTime < 0 ? -1 : (qreal)cpuTime / wallTime;
+
+        qDebug("%s at %s: reference %.1f Mbit/s, measured %.1f Mbit/s, error %.2f%%, client %.3f cores per Gbit/s",
+               engine, rate ? qPrintable(QString("%1 Mbit/s").arg(rate / 1000000)) : "full speed", reference / 1e6,
+               measured / 1e6, error * 100, cores < 0 ? -1 : cores / (measured / 1e9));
+    }
+
+    static void rates()
+    {
+        QTest::addColumn<qint64>("rate");
+        QTest::addColumn<int>("connections");
+        QTest::addColumn<qreal>("maxError");
+
+        QTest::newRow("10 Mbit/s") << Q_INT64_C(10000000) << 1 << 0.1;
+        QTest::newRow("100 Mbit/s") << Q_INT64_C(100000000) << 1 << 0.1;
+        QTest::newRow("1 Gbit/s") << Q_INT64_C(1000000000) << 1 << 0.1;
+        QTest::newRow("full speed") << Q_INT64_C(0) << 4 << 0.2;
+    }
+
+    QThread peerThread;
+    Peer *peer;
+
+private slots:
+    void init()
+    {
+        memset(payload, 'x', sizeof(payload));
+        peer = NULL;
+    }
+
+    void cleanup()
+    {
+        if (peer)
+        {
+            stopPeer();
+        }
+    }
+
+    void httpDownload_data()
+    {
+        rates();
+    }
+
+    void httpDownload()
+    {
+        QFETCH(qint64, rate);
+        QFETCH(int, connections);
+        QFETCH(qreal, maxError);
+
+        startPeer(rate);
+
+        QString url = QString("http://127.0.0.1:%1/").arg(peer->httpRelay->server.serverPort());
+
+        HTTPDownload download;
+        QSignalSpy finished(&download, SIGNAL(finished()));
+
+        QVERIFY(download.prepare(NULL, HTTPDownloadDefinitionPtr(
+                                     new HTTPDownloadDefinition(url, false, connections, 2000, 1000, 250))));
+
+        QElapsedTimer wallTime;
+        wallTime.start();
+        qint64 cpuTime = threadCpuTime();
+
+        QVERIFY(download.start());
+        QVERIFY(finished.wait(20000));
+
+        cpuTime = cpuTime < 0 ? -1 : threadCpuTime() - cpuTime;
+
+        QVariantMap result = download.result().probeResult();
+        qreal measured = result.value("bandwidth_bps_avg").toDouble();
+        qreal reference = 0.0;
+        QMetaObject::invokeMethod(peer, "httpRate", Qt::BlockingQueuedConnection, Q_RETURN_ARG(qreal, reference));
+
+        QCOMPARE(result.value("actual_num_threads").toInt(), connections);
+        QVERIFY(reference > 0);
+
+        report("httpdownload", rate, reference, measured, cpuTime, wallTime.nsecsElapsed());
+        QVERIFY2(qAbs(measured - reference) / reference <= maxError,
+                 qPrintable(QString("measured %1 bps, delivered %2 bps").arg(measured).arg(reference)));
+    }
+
+    void btc_data()
+    {
+        rates();
+    }
+
+    void btc()
+    {
+        QFETCH(qint64, rate);
+        QFETCH(qreal, maxError);
+
+        startPeer(rate);
+
+        NetworkManager networkManager;
+        BulkTransportCapacityMA btc;
+        QSignalSpy finished(&btc, SIGNAL(finished()));
+
+        QVERIFY(btc.prepare(&networkManager, BulkTransportCapacityDefinitionPtr(
+                                new BulkTransportCapacityDefinition("127.0.0.1", peer->btcRelay->server.serverPort(),
+                                                                    1024 * 1024, 10))));
+
+        QElapsedTimer wallTime;
+        wallTime.start();
+        qint64 cpuTime = threadCpuTime();
+
+        QVERIFY(btc.start());
+        QVERIFY(finished.wait(20000));
+
+        cpuTime = cpuTime < 0 ? -1 : threadCpuTime() - cpuTime;
+
+        // KiB/s
+        qreal measured = btc.result().probeResult().value("kBs_avg").toDouble() * 1024 * 8;
+        qreal reference = 0.0;
+        QMetaObject::invokeMethod(peer, "btcRate", Qt::BlockingQueuedConnection, Q_RETURN_ARG(qreal, reference));
+
+        btc.stop();
+
+        QVERIFY(reference > 0);
+
+        report("btc", rate, reference, measured, cpuTime, wallTime.nsecsElapsed());
+        QVERIFY2(qAbs(measured - reference) / reference <= maxError,
+                 qPrintable(QString("measured %1 bps, delivered %2 bps").arg(measured).arg(reference)));
+    }
+
+    void btcStreams()
+    {
+        startPeer(0);
+
+        NetworkManager networkManager;
+        BulkTransportCapacityMA btc;
+        QSignalSpy finished(&btc, SIGNAL(finished()));
+
+        QVERIFY(btc.prepare(&networkManager, BulkTransportCapacityDefinitionPtr(
+                                new BulkTransportCapacityDefinition("127.0.0.1", peer->btcPort, 1024 * 1024, 5, 0, 4,
+                                                                    btc::Both, btc::uploadProtocol))));
+        QVERIFY(btc.start());
+        QVERIFY(finished.wait(30000));
+
+        QVariantMap result = btc.result().probeResult();
+        btc.stop();
+
+        QCOMPARE(result.value("direction").toString(), QString("both"));
+        QCOMPARE(result.value("streams").toInt(), 4);
+
+        foreach (const QString &direction, QStringList() << "download" << "upload")
+        {
+            QVariantMap map = result.value(direction).toMap();
+            QVariantList streams = map.value("streams").toList();
+
+            QVERIFY2(map.value("kBs_avg").toDouble() > 0, qPrintable(direction));
+            QCOMPARE(streams.size(), 4);
+
+            foreach (const QVariant &stream, streams)
+            {
+                QVERIFY(stream.toMap().value("kBs_avg").toDouble() > 0);
+                QVERIFY(!stream.toMap().value("kBs").toList().isEmpty());
+            }
+        }
+    }
+
+    void btcConcurrentClients()
+    {
+        const int clients = 8;
+        const quint64 bytes = 8 * 1024 * 1024;
+
+        startPeer(0);
+
+        QList<QTcpSocket *> sockets;
+        QList<qint64> received;
+
+        for (int i = 0; i < clients; i++)
+        {
+            QTcpSocket *socket = new QTcpSocket(this);
+            socket->connectToHost(QHostAddress::LocalHost, peer->btcPort);
+            QVERIFY(socket->waitForConnected(5000));
+
+            QDataStream out(socket);
+            out << bytes;
+
+            sockets.append(socket);
+            received.append(0);
+        }
+
+        QElapsedTimer timeout;
+        timeout.start();
+
+        while (timeout.elapsed() < 20000)
+        {
+            bool done = true;
+
+            for (int i = 0; i < clients; i++)
+            {
+                received[i] += sockets[i]->readAll().size();
+                done = done && received[i] >= (qint64)bytes;
+            }
+
+            if (done)
+            {
+                break;
+            }
+
+            sockets.first()->waitForReadyRead(10);
+            QCoreApplication::processEvents();
+        }
+
+        for (int i = 0; i < clients; i++)
+        {
+            QCOMPARE(received[i], (qint64)bytes);
+        }
+
+        qDeleteAll(sockets);
+    }
+};
+
+QTEST_MAIN(TestThroughput)
+
+#include "tst_throughput.moc"